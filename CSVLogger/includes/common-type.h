@@ -27,11 +27,15 @@
 
 #include <stdint.h>
 
+/** @brief The maximum absolute exponent of a fixed-point value */
+#define COMMON_TYPE_FIXED_MAX_EXPONENT 9
+
 /**
  * @brief Enumeration describing the encapsulated data type
  */
 typedef enum {
-	COMMON_TYPE_LONG, COMMON_TYPE_DOUBLE, COMMON_TYPE_STRING, COMMON_TYPE_ERROR
+	COMMON_TYPE_LONG, COMMON_TYPE_DOUBLE, COMMON_TYPE_STRING, COMMON_TYPE_ERROR,
+	COMMON_TYPE_FIXED
 } common_type_type_t;
 
 /**
@@ -63,6 +67,19 @@ typedef struct {
 		char* strVal;
 		/** @brief An error code specifying the status of an operation */
 		common_type_error_t errVal;
+		/**
+		 * @brief Decimal fixed-point representation
+		 * @details The value is mantissa * 10^exponent, e.g. 215 and -1 encode
+		 * 21.5. The absolute exponent is at most COMMON_TYPE_FIXED_MAX_EXPONENT.
+		 * Values read as integer multiples of a decimal step should use this
+		 * representation, so they are stored exactly.
+		 */
+		struct {
+			/** @brief The signed integer multiple of the step */
+			int32_t mantissa;
+			/** @brief The decimal exponent of the step */
+			int32_t exponent;
+		} fixedVal;
 	} data;
 
 	/** @brief The type of the value stored in data */
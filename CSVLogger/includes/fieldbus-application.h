@@ -5,6 +5,17 @@
  * values remotely. Addressing will be provided by passing generic configuration
  * snippets. The communication interface used to access underlying fieldbus
  * layers is not specified by the main application.</p>
+ * <p>Optionally, a module may compile each address into an opaque handle once
+ * and fetch values using the handle afterwards. Thus, parsing and validating
+ * the configuration snippet isn't repeated on every fetch. A module supporting
+ * compiled addresses has to provide both, the
+ * fieldbus_application_compileAddress and the
+ * fieldbus_application_fetchCompiled function. Such a module may additionally
+ * provide fieldbus_application_fetchValues which fetches every compiled
+ * address of a single sample at once.</p>
+ * <p>Alternatively, a module may export the context variant of the interface
+ * which keeps the module's state within an opaque context and guarantees that
+ * values can be fetched by several threads concurrently.</p>
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -28,9 +39,13 @@
 #define FIELDBUS_APPLICATION_H_
 
 #include "common-type.h"
+#include "fieldbus-mac.h"
 
 #include <libconfig.h>
 
+/** @brief The opaque handle of a compiled address */
+typedef void * fieldbus_application_handle_t;
+
 /**
  * @brief Initializes the module.
  * @details <p>The init function will be called once before using any other
@@ -69,7 +84,7 @@ typedef common_type_error_t (*fieldbus_application_sync_t)(void);
  * must be represented using the the corresponding SI unit. On returning string
  * references the buffer must be valid until the next function of the module is
  * called. The error type must only be used if the value can not be fetched.</p>
- * <p>The given address will be directly passed from the read configuration
+ * <p>The given address is a copy of the snippet read from the configuration
  * file. It encapsulates every information entered but may not be complete.</p>
  * @param address The configuration snippet specifying the address
  * @return The value read or an appropriate error.
@@ -83,6 +98,74 @@ typedef common_type_t (*fieldbus_application_fetchValue_t)(
 /** @brief The name of the fieldbus_application_fetchValue function */
 #define FIELDBUS_APPLICATION_FETCH_VALUE_NAME "fieldbus_application_fetchValue"
 
+/**
+ * @brief Compiles the given address into an opaque handle (optional)
+ * @details <p>The function is called once for each channel after the module
+ * was initialized. It has to parse and validate the address as far as possible
+ * without accessing the device. The handle has to remain valid until the
+ * module's free function is called. The address configuration snippet may not
+ * be accessed by the module after returning.</p>
+ * <p>The function is optional but has to be provided together with
+ * fieldbus_application_fetchCompiled.</p>
+ * @param address The configuration snippet specifying the address
+ * @param handle The location to store the compiled handle
+ * @return The status of the operation
+ */
+common_type_error_t fieldbus_application_compileAddress(
+		config_setting_t *address, fieldbus_application_handle_t *handle);
+
+/**
+ * @brief The pointer type of the fieldbus_application_compileAddress function
+ */
+typedef common_type_error_t (*fieldbus_application_compileAddress_t)(
+		config_setting_t *address, fieldbus_application_handle_t *handle);
+
+/** @brief The name of the fieldbus_application_compileAddress function */
+#define FIELDBUS_APPLICATION_COMPILE_ADDRESS_NAME \
+		"fieldbus_application_compileAddress"
+
+/**
+ * @brief Retrieves a measured value addressed by a compiled handle (optional)
+ * @details The function behaves like fieldbus_application_fetchValue but uses
+ * the handle previously returned by fieldbus_application_compileAddress.
+ * @param handle The compiled address
+ * @return The value read or an appropriate error.
+ */
+common_type_t fieldbus_application_fetchCompiled(
+		fieldbus_application_handle_t handle);
+
+/** @brief The pointer type of the fieldbus_application_fetchCompiled function */
+typedef common_type_t (*fieldbus_application_fetchCompiled_t)(
+		fieldbus_application_handle_t handle);
+
+/** @brief The name of the fieldbus_application_fetchCompiled function */
+#define FIELDBUS_APPLICATION_FETCH_COMPILED_NAME \
+		"fieldbus_application_fetchCompiled"
+
+/**
+ * @brief Retrieves several values addressed by compiled handles (optional)
+ * @details The function behaves like calling fieldbus_application_fetchCompiled
+ * for each handle, but the module may share common work such as looking up the
+ * current data of a device among all handles. The function may only be
+ * provided by modules supporting compiled addresses. A failing value is
+ * reported by its result only and doesn't affect other values.
+ * @param handles The vector of compiled addresses
+ * @param results The vector receiving the values read or appropriate errors
+ * @param count The number of elements within both vectors
+ */
+void fieldbus_application_fetchValues(
+		const fieldbus_application_handle_t *handles, common_type_t *results,
+		unsigned int count);
+
+/** @brief The pointer type of the fieldbus_application_fetchValues function */
+typedef void (*fieldbus_application_fetchValues_t)(
+		const fieldbus_application_handle_t *handles, common_type_t *results,
+		unsigned int count);
+
+/** @brief The name of the fieldbus_application_fetchValues function */
+#define FIELDBUS_APPLICATION_FETCH_VALUES_NAME \
+		"fieldbus_application_fetchValues"
+
 /**
  * @brief Frees used resources.
  * @details After calling the function only init, reconfiguring the module, may
@@ -97,4 +180,169 @@ typedef common_type_error_t (*fieldbus_application_free_t)(void);
 /** @brief The name of the fieldbus_application_free function */
 #define FIELDBUS_APPLICATION_FREE_NAME "fieldbus_application_free"
 
+/* ************************************************************************** */
+/* Context variant                                                            */
+/* ************************************************************************** */
+
+/**
+ * @brief The opaque handle of a module's state
+ * @details <p>Modules may export the context variant of the interface instead
+ * of the plain functions above. If a module exports
+ * fieldbus_application_initContext, the plain functions aren't used. Every
+ * function of the variant except fieldbus_application_fetchValuesContext and
+ * fieldbus_application_getMacContext is mandatory.</p>
+ * <p>The variant gives the following thread-safety guarantees. The init, sync,
+ * compile and free functions are never called concurrently with any other
+ * function of the same context. Between two sync calls, the fetch functions may
+ * be called by several threads at once, using the same context and any
+ * compiled handles. Hence, they must not modify the context or any other state
+ * shared by the handles. String references returned have to remain valid until
+ * the next sync call. The module's MAC layer is never synchronized while values
+ * are fetched.</p>
+ */
+typedef void * fieldbus_application_context_t;
+
+/**
+ * @brief Initializes the module and creates it's context
+ * @details See fieldbus_application_init for more details. If the function
+ * fails, it has to free every resource allocated so far.
+ * @param context The location receiving the module's context
+ * @return The status of the initialization
+ */
+common_type_error_t fieldbus_application_initContext(
+		fieldbus_application_context_t *context);
+
+/** @brief The pointer type of fieldbus_application_initContext */
+typedef common_type_error_t (*fieldbus_application_initContext_t)(
+		fieldbus_application_context_t *context);
+
+/** @brief The name of fieldbus_application_initContext */
+#define FIELDBUS_APPLICATION_INIT_CONTEXT_NAME \
+		"fieldbus_application_initContext"
+
+/**
+ * @brief Issues a synchronization command
+ * @details See fieldbus_application_sync for more details.
+ * @param context The context returned by fieldbus_application_initContext
+ * @return The status of the synchronization
+ */
+common_type_error_t fieldbus_application_syncContext(
+		fieldbus_application_context_t context);
+
+/** @brief The pointer type of fieldbus_application_syncContext */
+typedef common_type_error_t (*fieldbus_application_syncContext_t)(
+		fieldbus_application_context_t context);
+
+/** @brief The name of fieldbus_application_syncContext */
+#define FIELDBUS_APPLICATION_SYNC_CONTEXT_NAME \
+		"fieldbus_application_syncContext"
+
+/**
+ * @brief Compiles the given address into an opaque handle
+ * @details See fieldbus_application_compileAddress for more details.
+ * @param context The context returned by fieldbus_application_initContext
+ * @param address The configuration snippet specifying the address
+ * @param handle The location to store the compiled handle
+ * @return The status of the operation
+ */
+common_type_error_t fieldbus_application_compileContext(
+		fieldbus_application_context_t context, config_setting_t *address,
+		fieldbus_application_handle_t *handle);
+
+/** @brief The pointer type of fieldbus_application_compileContext */
+typedef common_type_error_t (*fieldbus_application_compileContext_t)(
+		fieldbus_application_context_t context, config_setting_t *address,
+		fieldbus_application_handle_t *handle);
+
+/** @brief The name of fieldbus_application_compileContext */
+#define FIELDBUS_APPLICATION_COMPILE_CONTEXT_NAME \
+		"fieldbus_application_compileContext"
+
+/**
+ * @brief Retrieves a measured value addressed by a compiled handle
+ * @details See fieldbus_application_fetchValue for more details. The function
+ * has to be re-entrant as stated by fieldbus_application_context_t.
+ * @param context The context returned by fieldbus_application_initContext
+ * @param handle The compiled address
+ * @return The value read or an appropriate error.
+ */
+common_type_t fieldbus_application_fetchContext(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle);
+
+/** @brief The pointer type of fieldbus_application_fetchContext */
+typedef common_type_t (*fieldbus_application_fetchContext_t)(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle);
+
+/** @brief The name of fieldbus_application_fetchContext */
+#define FIELDBUS_APPLICATION_FETCH_CONTEXT_NAME \
+		"fieldbus_application_fetchContext"
+
+/**
+ * @brief Retrieves several values addressed by compiled handles (optional)
+ * @details See fieldbus_application_fetchValues for more details. The function
+ * has to be re-entrant as stated by fieldbus_application_context_t.
+ * @param context The context returned by fieldbus_application_initContext
+ * @param handles The vector of compiled addresses
+ * @param results The vector receiving the values read or appropriate errors
+ * @param count The number of elements within both vectors
+ */
+void fieldbus_application_fetchValuesContext(
+		fieldbus_application_context_t context,
+		const fieldbus_application_handle_t *handles, common_type_t *results,
+		unsigned int count);
+
+/** @brief The pointer type of fieldbus_application_fetchValuesContext */
+typedef void (*fieldbus_application_fetchValuesContext_t)(
+		fieldbus_application_context_t context,
+		const fieldbus_application_handle_t *handles, common_type_t *results,
+		unsigned int count);
+
+/** @brief The name of fieldbus_application_fetchValuesContext */
+#define FIELDBUS_APPLICATION_FETCH_VALUES_CONTEXT_NAME \
+		"fieldbus_application_fetchValuesContext"
+
+/**
+ * @brief Reports the MAC instance a compiled address depends on (optional)
+ * @details The function is called once after compiling the address of a
+ * channel which doesn't name its MAC module. If the module is able to tell the
+ * single MAC instance serving the address, only this instance has to be
+ * synchronized before reading the channel. Otherwise, every MAC module is
+ * synchronized.
+ * @param context The context returned by fieldbus_application_initContext
+ * @param handle The compiled address
+ * @return The context of the serving MAC instance or NULL, if it is unknown
+ */
+fieldbus_mac_context_t fieldbus_application_getMacContext(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle);
+
+/** @brief The pointer type of fieldbus_application_getMacContext */
+typedef fieldbus_mac_context_t (*fieldbus_application_getMacContext_t)(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle);
+
+/** @brief The name of fieldbus_application_getMacContext */
+#define FIELDBUS_APPLICATION_GET_MAC_CONTEXT_NAME \
+		"fieldbus_application_getMacContext"
+
+/**
+ * @brief Frees the module's context
+ * @details See fieldbus_application_free for more details. The context and
+ * every compiled handle mustn't be used anymore afterwards.
+ * @param context The context returned by fieldbus_application_initContext
+ * @return The status of the operation.
+ */
+common_type_error_t fieldbus_application_freeContext(
+		fieldbus_application_context_t context);
+
+/** @brief The pointer type of fieldbus_application_freeContext */
+typedef common_type_error_t (*fieldbus_application_freeContext_t)(
+		fieldbus_application_context_t context);
+
+/** @brief The name of fieldbus_application_freeContext */
+#define FIELDBUS_APPLICATION_FREE_CONTEXT_NAME \
+		"fieldbus_application_freeContext"
+
 #endif /* FIELDBUS_APPLICATION_H_ */
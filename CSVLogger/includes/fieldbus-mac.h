@@ -35,7 +35,8 @@
  * @details The logging facility will be properly initialized before calling.
  * The function will be called exactly once before using any other function of
  * the module. Only after calling the free-function the init function may be
- * called again.
+ * called again. The configuration is freed after startup, so it may not be
+ * accessed after returning.
  * @param configuration The module's configuration.
  * @return The status of the operation.
  */
@@ -79,4 +80,72 @@ typedef common_type_error_t (*fieldbus_mac_free_t)(void);
 /** @brief The name of fieldbus_mac_free */
 #define FIELDBUS_MAC_FREE_NAME "fieldbus_mac_free"
 
+/* ************************************************************************** */
+/* Context variant                                                            */
+/* ************************************************************************** */
+
+/**
+ * @brief The opaque handle of a single module instance
+ * @details Modules may export the context variant of the interface instead of
+ * the plain functions above. In this case, every MAC directive naming the
+ * module gets its own instance, so a single module may drive several
+ * independent buses. Different instances are synchronized concurrently, hence
+ * the module has to keep every instance's state within its context. A single
+ * context is never used by two threads at once. If a module exports
+ * fieldbus_mac_initContext, the plain functions aren't used.
+ */
+typedef void * fieldbus_mac_context_t;
+
+/**
+ * @brief Creates a new module instance according to the given configuration
+ * @details The logging facility will be properly initialized before calling.
+ * The function is called once per MAC directive naming the module. If the
+ * function fails, it has to free every resource allocated so far. The context
+ * isn't used afterwards. The configuration is freed after startup, so it may
+ * not be accessed after returning.
+ * @param configuration The instance's configuration.
+ * @param context The location receiving the instance's context
+ * @return The status of the operation.
+ */
+common_type_error_t fieldbus_mac_initContext(config_setting_t* configuration,
+		fieldbus_mac_context_t *context);
+
+/** @brief The pointer type of fieldbus_mac_initContext */
+typedef common_type_error_t (*fieldbus_mac_initContext_t)(
+		config_setting_t* configuration, fieldbus_mac_context_t *context);
+
+/** @brief The name of fieldbus_mac_initContext */
+#define FIELDBUS_MAC_INIT_CONTEXT_NAME "fieldbus_mac_initContext"
+
+/**
+ * @brief Indicates a global sync event to a single instance
+ * @details See fieldbus_mac_sync for more details.
+ * @param context The context returned by fieldbus_mac_initContext
+ * @return The status of the sync operation
+ */
+common_type_error_t fieldbus_mac_syncContext(fieldbus_mac_context_t context);
+
+/** @brief The pointer type of fieldbus_mac_syncContext */
+typedef common_type_error_t (*fieldbus_mac_syncContext_t)(
+		fieldbus_mac_context_t context);
+
+/** @brief The name of fieldbus_mac_syncContext */
+#define FIELDBUS_MAC_SYNC_CONTEXT_NAME "fieldbus_mac_syncContext"
+
+/**
+ * @brief Frees the resources of a single instance
+ * @details See fieldbus_mac_free for more details. The context mustn't be used
+ * anymore afterwards.
+ * @param context The context returned by fieldbus_mac_initContext
+ * @return The status of the operation
+ */
+common_type_error_t fieldbus_mac_freeContext(fieldbus_mac_context_t context);
+
+/** @brief The pointer type of fieldbus_mac_freeContext */
+typedef common_type_error_t (*fieldbus_mac_freeContext_t)(
+		fieldbus_mac_context_t context);
+
+/** @brief The name of fieldbus_mac_freeContext */
+#define FIELDBUS_MAC_FREE_CONTEXT_NAME "fieldbus_mac_freeContext"
+
 #endif /* FIELDBUS_MAC_H_ */
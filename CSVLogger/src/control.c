@@ -0,0 +1,328 @@
+/**
+ * @file control.c
+ * @brief Implements the control socket
+ * @details Connections are non-blocking and served by the reactor. Every
+ * connection buffers a partial command line until the newline arrives. The
+ * number of connections is limited, further connections are refused.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "control.h"
+#include "reactor.h"
+
+#include <logging-adapter.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/** @brief The maximum length of a command line including the newline */
+#define CONTROL_LINE_SIZE 64
+/** @brief The maximum size of a reply including the newline */
+#define CONTROL_REPLY_SIZE 256
+/** @brief The maximum number of connections open at once */
+#define CONTROL_MAX_CONNECTIONS 8
+
+/** @brief Structure holding the state of a single connection */
+typedef struct control_connection {
+	/** @brief The reactor source of the connection */
+	reactor_source_t source;
+	/** @brief The next open connection */
+	struct control_connection *next;
+	/** @brief The command line received so far */
+	char line[CONTROL_LINE_SIZE];
+	/** @brief The number of bytes within the line buffer */
+	size_t length;
+} control_connection_t;
+
+/** @brief Structure containing the module's state */
+static struct {
+	/** @brief The reactor source of the listening socket */
+	reactor_source_t listener;
+	/** @brief The list of open connections */
+	control_connection_t *connections;
+	/** @brief The number of open connections */
+	unsigned int connectionCount;
+	/** @brief The vector of commands */
+	const control_command_t *commands;
+	/** @brief The number of commands */
+	unsigned int commandCount;
+	/** @brief The file name of the socket or NULL if it isn't initialized */
+	char *path;
+} control_cData = { .listener.fd = -1 };
+
+/* Function prototypes */
+static inline common_type_error_t control_setNonBlocking(int fd);
+static void control_accept(reactor_source_t *source, uint32_t events);
+static void control_receive(reactor_source_t *source, uint32_t events);
+static void control_execute(control_connection_t *connection, char *line);
+static void control_close(control_connection_t *connection);
+
+common_type_error_t control_init(const char *path,
+		const control_command_t *commands, unsigned int commandCount) {
+	struct sockaddr_un address;
+	int fd;
+
+	assert(path != NULL);
+	assert(commands != NULL || commandCount == 0);
+	assert(control_cData.path == NULL);
+
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		logging_adapter_info("The control socket's name \"%s\" is too long",
+				path);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	control_cData.path = malloc(strlen(path) + 1);
+	if (control_cData.path == NULL) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+	strcpy(control_cData.path, path);
+	control_cData.commands = commands;
+	control_cData.commandCount = commandCount;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		logging_adapter_info("Can't create the control socket: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+	control_cData.listener.fd = fd;
+
+	(void) unlink(path);
+	if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0
+			|| listen(fd, CONTROL_MAX_CONNECTIONS) != 0) {
+		logging_adapter_info("Can't listen on the control socket \"%s\": %s",
+				path, strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+	if (control_setNonBlocking(fd) != COMMON_TYPE_SUCCESS)
+		return COMMON_TYPE_ERR_IO;
+
+	control_cData.listener.handler = control_accept;
+	control_cData.listener.data = NULL;
+	if (reactor_add(&control_cData.listener, EPOLLIN) != COMMON_TYPE_SUCCESS)
+		return COMMON_TYPE_ERR_IO;
+
+	logging_adapter_debug("Listening on the control socket \"%s\"", path);
+	return COMMON_TYPE_SUCCESS;
+}
+
+void control_free(void) {
+	while (control_cData.connections != NULL) {
+		control_close(control_cData.connections);
+	}
+
+	if (control_cData.listener.fd >= 0) {
+		reactor_remove(&control_cData.listener);
+		(void) close(control_cData.listener.fd);
+		control_cData.listener.fd = -1;
+	}
+	if (control_cData.path != NULL) {
+		(void) unlink(control_cData.path);
+		free(control_cData.path);
+		control_cData.path = NULL;
+	}
+}
+
+/**
+ * @brief Switches the file descriptor to non-blocking mode and sets the
+ * close-on-exec flag
+ * @param fd The valid file descriptor
+ * @return The status of the operation
+ */
+static inline common_type_error_t control_setNonBlocking(int fd) {
+	int flags;
+
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0
+			|| fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+		logging_adapter_info("Can't configure the control socket: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Accepts a pending connection
+ * @param source The listener's source
+ * @param events The events received
+ */
+static void control_accept(reactor_source_t *source, uint32_t events) {
+	control_connection_t *connection;
+	int fd;
+
+	(void) events;
+
+	fd = accept(source->fd, NULL, NULL);
+	if (fd < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			logging_adapter_info("Can't accept a control connection: %s",
+					strerror(errno));
+		}
+		return;
+	}
+
+	if (control_cData.connectionCount >= CONTROL_MAX_CONNECTIONS) {
+		logging_adapter_info("Too many control connections, refuse another one");
+		(void) close(fd);
+		return;
+	}
+
+	connection = calloc(1, sizeof(*connection));
+	if (connection == NULL) {
+		logging_adapter_info("Not enough memory available");
+		(void) close(fd);
+		return;
+	}
+	connection->source.fd = fd;
+	connection->source.handler = control_receive;
+	connection->source.data = connection;
+
+	if (control_setNonBlocking(fd) != COMMON_TYPE_SUCCESS
+			|| reactor_add(&connection->source, EPOLLIN) != COMMON_TYPE_SUCCESS) {
+		(void) close(fd);
+		free(connection);
+		return;
+	}
+
+	connection->next = control_cData.connections;
+	control_cData.connections = connection;
+	control_cData.connectionCount++;
+}
+
+/**
+ * @brief Reads the bytes available on a connection and executes every command
+ * line completed
+ * @details The connection is closed on end of file, on error and if a command
+ * line exceeds the buffer.
+ * @param source The connection's source
+ * @param events The events received
+ */
+static void control_receive(reactor_source_t *source, uint32_t events) {
+	control_connection_t *connection = source->data;
+	ssize_t retVal;
+	char *newline;
+
+	(void) events;
+	assert(connection != NULL);
+
+	retVal = read(source->fd, &connection->line[connection->length],
+			sizeof(connection->line) - connection->length);
+	if (retVal < 0 && (errno == EAGAIN || errno == EWOULDBLOCK
+			|| errno == EINTR)) {
+		return;
+	} else if (retVal <= 0) {
+		control_close(connection);
+		return;
+	}
+	connection->length += retVal;
+
+	while ((newline = memchr(connection->line, '\n', connection->length))
+			!= NULL) {
+		*newline = '\0';
+		control_execute(connection, connection->line);
+
+		connection->length -= newline + 1 - connection->line;
+		memmove(connection->line, newline + 1, connection->length);
+	}
+
+	if (connection->length == sizeof(connection->line)) {
+		logging_adapter_info("Control command too long, close the connection");
+		control_close(connection);
+	}
+}
+
+/**
+ * @brief Executes a single command line and sends the reply
+ * @details Trailing white-spaces of the line are ignored.
+ * @param connection The connection which received the line
+ * @param line The zero terminated line without newline
+ */
+static void control_execute(control_connection_t *connection, char *line) {
+	char reply[CONTROL_REPLY_SIZE];
+	size_t length;
+	unsigned int i;
+
+	length = strlen(line);
+	while (length > 0 && (line[length - 1] == '\r' || line[length - 1] == ' '
+			|| line[length - 1] == '\t')) {
+		line[--length] = '\0';
+	}
+	if (length == 0)
+		return;
+
+	logging_adapter_debug("Received control command \"%s\"", line);
+
+	reply[0] = '\0';
+	for (i = 0; i < control_cData.commandCount; i++) {
+		if (strcmp(control_cData.commands[i].name, line) == 0) {
+			control_cData.commands[i].handler(reply, sizeof(reply) - 1);
+			break;
+		}
+	}
+	if (i == control_cData.commandCount) {
+		(void) snprintf(reply, sizeof(reply) - 1, "ERR unknown command \"%s\"",
+				line);
+	}
+
+	length = strlen(reply);
+	reply[length++] = '\n';
+	if (send(connection->source.fd, reply, length, MSG_NOSIGNAL | MSG_DONTWAIT)
+			!= (ssize_t) length) {
+		logging_adapter_debug("Can't send the control reply completely");
+	}
+}
+
+/**
+ * @brief Closes the connection and frees it's resources
+ * @param connection The open connection
+ */
+static void control_close(control_connection_t *connection) {
+	control_connection_t *previous;
+
+	assert(connection != NULL);
+
+	if (control_cData.connections == connection) {
+		control_cData.connections = connection->next;
+	} else {
+		previous = control_cData.connections;
+		while (previous != NULL && previous->next != connection) {
+			previous = previous->next;
+		}
+		assert(previous != NULL);
+		previous->next = connection->next;
+	}
+	control_cData.connectionCount--;
+
+	reactor_remove(&connection->source);
+	(void) close(connection->source.fd);
+	free(connection);
+}
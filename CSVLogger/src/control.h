@@ -0,0 +1,68 @@
+/**
+ * @file control.h
+ * @brief Local control socket of the daemon
+ * @details The module listens on a unix domain stream socket registered at the
+ * reactor. Each line received on a connection is a command name. The command's
+ * handler fills in a single line reply which is sent back. Several connections
+ * may be open at once, each command is answered before the next one is read.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CONTROL_H_
+#define CONTROL_H_
+
+#include <common-type.h>
+#include <stddef.h>
+
+/**
+ * @brief Handler executing a control command
+ * @param reply The buffer receiving the zero terminated reply without newline
+ * @param size The size of the reply buffer in bytes
+ */
+typedef void (*control_handler_t)(char *reply, size_t size);
+
+/** @brief Structure defining a control command */
+typedef struct {
+	/** @brief The name of the command */
+	const char *name;
+	/** @brief The handler executing the command */
+	control_handler_t handler;
+} control_command_t;
+
+/**
+ * @brief Creates the control socket and registers it at the reactor
+ * @details The reactor has to be initialized before. A stale socket file of
+ * the same name is replaced.
+ * @param path The file name of the socket
+ * @param commands The vector of commands which must remain valid until the
+ * module is freed
+ * @param commandCount The number of commands
+ * @return The status of the operation
+ */
+common_type_error_t control_init(const char *path,
+		const control_command_t *commands, unsigned int commandCount);
+
+/**
+ * @brief Closes every connection and removes the control socket
+ * @details It's safe to call the function even if the module wasn't
+ * initialized.
+ */
+void control_free(void);
+
+#endif /* CONTROL_H_ */
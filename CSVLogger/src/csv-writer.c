@@ -0,0 +1,1611 @@
+/**
+ * @file csv-writer.c
+ * @brief Implements the CSV writer thread
+ * @details Each slot of the ring holds a row header followed by the vector of
+ * values, the vector of flags marking the columns set and the string arena.
+ * The writer thread sleeps on a semaphore posted for every row committed and
+ * for every request. It copies the rows available out of the ring and formats
+ * them back to back into the batch buffer, which is then written by a single
+ * system call using plain file descriptors. Hence, the number of bytes written
+ * is known exactly even if a write fails. A batch failing is kept by the
+ * writer thread, which then stops taking rows from the ring and retries
+ * periodically. Using the spill policy, the rest of the batch and every
+ * following batch is appended to the spool file instead, until the spool file
+ * was drained into the recovered CSV file.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "csv-writer.h"
+#include "fast-format.h"
+#include "local-time.h"
+#include "ring-buffer.h"
+
+#include <logging-adapter.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** @brief The string terminating a row */
+#define CSV_WRITER_NEWLINE "\n"
+/** @brief The string written if a value couldn't be fetched */
+#define CSV_WRITER_ERR "NaN"
+/** @brief The size of the buffer holding the formatted time-stamp */
+#define CSV_WRITER_TIMESTAMP_BUFFER_SIZE 40
+/** @brief The number of seconds of a minute covered by a cached time-stamp */
+#define CSV_WRITER_SECONDS_PER_MINUTE 60
+/** @brief The size of each row's string arena per value column */
+#define CSV_WRITER_ARENA_PER_COLUMN 64
+/** @brief The maximum length of a formatted number of any type */
+#define CSV_WRITER_NUMBER_SIZE FAST_FORMAT_DOUBLE_SIZE
+/** @brief The number of seconds between attempts to recover the CSV file */
+#define CSV_WRITER_RETRY_INTERVAL 1
+/** @brief The minimum size of the buffer collecting formatted rows */
+#define CSV_WRITER_BATCH_SIZE 16384
+/** @brief The size of the buffer used to drain the spool file */
+#define CSV_WRITER_DRAIN_BUFFER_SIZE 4096
+/** @brief The permissions of files created, the umask still applies */
+#define CSV_WRITER_FILE_MODE 0666
+
+/** @brief The powers of ten fitting into a signed 64-bit integer */
+static const int64_t csv_writer_pow10[] = { 1LL, 10LL, 100LL, 1000LL, 10000LL,
+		100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL,
+		10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+		100000000000000LL, 1000000000000000LL, 10000000000000000LL,
+		100000000000000000LL, 1000000000000000000LL };
+
+struct csv_writer_column;
+
+/**
+ * @brief Function printing a value of a single type
+ * @param buffer The buffer receiving at most CSV_WRITER_NUMBER_SIZE characters
+ * or the escaped string
+ * @param value The value to print
+ * @param column The column the value belongs to
+ * @return The position after the last character written
+ */
+typedef char * (*csv_writer_formatter_t)(char *buffer,
+		const common_type_t *value, const struct csv_writer_column *column);
+
+/**
+ * @brief The formatting of a value column resolved at startup
+ * @details The formatter printing a value is looked up by the value's type
+ * within the column's formatter table, which is chosen by the column's
+ * encoding.
+ */
+typedef struct csv_writer_column {
+	/** @brief The formatters indexed by the value's type */
+	const csv_writer_formatter_t *formatters;
+	/** @brief The factor each value is multiplied with */
+	double scale;
+	/** @brief The decimal exponent of the scale if it is a power of ten */
+	int scaleExponent;
+	/** @brief The number of fractional digits or CSV_WRITER_NO_PRECISION */
+	int precision;
+} csv_writer_column_t;
+
+/** @brief The header of a row record */
+struct csv_writer_row {
+	/** @brief The time-stamp of the row */
+	struct timeval timestamp;
+	/** @brief The number of bytes used within the string arena */
+	size_t arenaUsed;
+};
+
+/** @brief Structure containing the writer's state */
+static struct {
+	/**
+	 * @brief The copy of the writer's parameters
+	 * @details The strings refer to the writer's own copies. The titles and the
+	 * time-stamp header are only used to format the headline and reset
+	 * afterwards.
+	 */
+	csv_writer_config_t config;
+	/** @brief The block holding the copies of the configuration's strings */
+	char *strings;
+	/** @brief The vector of the value columns' formatting */
+	csv_writer_column_t *columns;
+	/** @brief The ring passing the rows to the writer thread */
+	ring_buffer_t ring;
+	/** @brief The writer thread's copy of the row taken from the ring */
+	csv_writer_row_t *copy;
+	/** @brief The formatted headline */
+	char *header;
+	/** @brief The length of the formatted headline */
+	size_t headerLength;
+	/** @brief The maximum length of a formatted row */
+	size_t rowCapacity;
+	/** @brief The length of the separator */
+	size_t separatorLength;
+	/** @brief The buffer holding the formatted rows pending */
+	char *batchBuffer;
+	/** @brief The size of the batch buffer */
+	size_t batchCapacity;
+	/** @brief The length of the formatted rows pending */
+	size_t batchLength;
+	/** @brief The number of bytes of the pending rows already written */
+	size_t batchWritten;
+	/** @brief The number of rows pending */
+	unsigned int batchRows;
+	/** @brief The file descriptor of the CSV file or -1 if it isn't open */
+	int sinkFd;
+	/** @brief The file descriptor of the spool file or -1 if it isn't used */
+	int spoolFd;
+	/** @brief The size of the spool file */
+	off_t spoolSize;
+	/** @brief The number of bytes of the spool file already drained */
+	off_t spoolDrained;
+	/** @brief The offset of the flags vector within a row record */
+	size_t flagsOffset;
+	/** @brief The offset of the string arena within a row record */
+	size_t arenaOffset;
+	/** @brief The size of the string arena of a row */
+	size_t arenaSize;
+	/** @brief The statistics counted by the acquisition thread */
+	csv_writer_statistics_t stats;
+	/** @brief The local time-stamp last rendered */
+	char timeCache[CSV_WRITER_TIMESTAMP_BUFFER_SIZE];
+	/** @brief The length of the local time-stamp last rendered */
+	size_t timeCacheLength;
+	/** @brief The first second the cached calendar fields are valid */
+	time_t timeWindowStart;
+	/** @brief The number of seconds the cached calendar fields are valid */
+	unsigned int timeWindowLength;
+	/** @brief The second within the window the time cache holds */
+	unsigned int timeCachedSecond;
+	/** @brief The offset of the two seconds digits within the time cache */
+	size_t timeSecondsOffset;
+	/** @brief Flag indicating that the time cache is valid */
+	unsigned int timeCached :1;
+	/** @brief Flag indicating that the seconds digits may be patched */
+	unsigned int timeSecondsPatchable :1;
+	/** @brief The errno value of the last failure of the CSV file */
+	int sinkErrno;
+	/** @brief Flag indicating that the wakeup semaphore is initialized */
+	unsigned int wakeupValid :1;
+	/** @brief Flag indicating that the space semaphore is initialized */
+	unsigned int spaceValid :1;
+	/** @brief Flag indicating that the writer thread is running */
+	unsigned int threadRunning :1;
+	/** @brief Flag indicating that the CSV file failed and isn't recovered */
+	unsigned int sinkFailed :1;
+	/** @brief Flag indicating that appending the spool file failed */
+	unsigned int spoolFailed :1;
+} csv_writer_cData = { .sinkFd = -1, .spoolFd = -1 };
+
+/*
+ * The synchronization primitives and the variables shared with the writer
+ * thread are kept outside of the packed state structure to ensure their
+ * alignment.
+ */
+/** @brief The writer thread */
+static pthread_t csv_writer_thread;
+/** @brief The semaphore waking up the writer thread */
+static sem_t csv_writer_wakeup;
+/** @brief The semaphore waking up the acquisition thread waiting for room */
+static sem_t csv_writer_space;
+/** @brief Flag requesting the writer thread to exit after draining the ring */
+static int csv_writer_stopRequested = 0;
+/** @brief Flag requesting the writer thread to reopen the file */
+static int csv_writer_reopenRequested = 0;
+/** @brief Flag indicating that the acquisition thread waits for room */
+static int csv_writer_waitingForSpace = 0;
+/** @brief Flag mirroring the sinkFailed state for the statistics */
+static int csv_writer_sinkFailed = 0;
+/** @brief The number of rows moved to the spool file */
+static uint64_t csv_writer_spilledRows = 0;
+/** @brief The number of bytes within the spool file not yet drained */
+static uint64_t csv_writer_spooledBytes = 0;
+/** @brief The number of times writing the CSV file failed */
+static uint64_t csv_writer_sinkFailures = 0;
+/** @brief The number of rows formatted */
+static uint64_t csv_writer_formattedRows = 0;
+/** @brief The nanoseconds spent copying and formatting rows */
+static uint64_t csv_writer_formatNanos = 0;
+/** @brief The number of batches delivered */
+static uint64_t csv_writer_batches = 0;
+
+/* Function prototypes */
+static void * csv_writer_run(void *arg);
+static inline void csv_writer_sleep(void);
+static void csv_writer_process(void);
+static csv_writer_row_t * csv_writer_waitForSpace(void);
+static int csv_writer_fillBatch(void);
+static int csv_writer_takeRow(void);
+static int csv_writer_deliverBatch(void);
+static common_type_error_t csv_writer_openSink(void);
+static void csv_writer_failSink(int errorNumber);
+static inline void csv_writer_recoverSink(void);
+static void csv_writer_drainSpool(void);
+static common_type_error_t csv_writer_spill(const char *buffer, size_t length,
+		size_t *written);
+static common_type_error_t csv_writer_writeAll(int fd, const char *buffer,
+		size_t length, size_t *written);
+static inline void csv_writer_updateSpooledBytes(void);
+static common_type_error_t csv_writer_initHeader(void);
+static common_type_error_t csv_writer_copyStrings(void);
+static inline size_t csv_writer_stringSize(const char *str);
+static inline const char * csv_writer_copyString(char **pos, const char *str);
+static common_type_error_t csv_writer_initColumns(void);
+static size_t csv_writer_formatRow(csv_writer_row_t *row, char *buffer);
+static inline size_t csv_writer_formatTimestamp(const struct timeval *tv,
+		char *buffer);
+static size_t csv_writer_formatLocalTime(time_t seconds, char *buffer);
+static common_type_error_t csv_writer_renderTimeWindow(time_t seconds);
+static inline char * csv_writer_formatString(char *buffer, const char *str);
+static char * csv_writer_formatLong(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column);
+static char * csv_writer_formatDouble(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column);
+static char * csv_writer_formatFixed(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column);
+static char * csv_writer_formatStringValue(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column);
+static char * csv_writer_formatError(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column);
+static char * csv_writer_formatScaledLong(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column);
+static char * csv_writer_formatScaledDouble(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column);
+static char * csv_writer_formatScaledFixed(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column);
+static char * csv_writer_formatDecimalFixed(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column);
+static char * csv_writer_formatScaled(char *buffer, double value,
+		const csv_writer_column_t *column);
+static char * csv_writer_formatDecimal(char *buffer, int64_t mantissa,
+		int exponent, int precision);
+static double csv_writer_fixedToDouble(int64_t mantissa, int exponent);
+static inline common_type_t * csv_writer_getValues(csv_writer_row_t *row);
+static inline uint8_t * csv_writer_getFlags(csv_writer_row_t *row);
+static inline char * csv_writer_getArena(csv_writer_row_t *row);
+
+common_type_error_t csv_writer_init(const csv_writer_config_t *config) {
+	common_type_error_t err;
+	sigset_t allSignals, oldSignals;
+	struct timeval now;
+	int retCode;
+
+	assert(config != NULL);
+	assert(config->fileName != NULL);
+	assert(config->timeMode != CSV_WRITER_TIME_LOCAL
+			|| config->timeFormat != NULL);
+	assert(config->timeHeader != NULL && config->separator != NULL);
+	assert(config->titles != NULL || config->columnCount == 0);
+	assert(config->queueLength > 0);
+	assert(config->policy != CSV_WRITER_POLICY_SPILL
+			|| config->spoolFileName != NULL);
+	assert(!csv_writer_cData.threadRunning);
+
+	memset(&csv_writer_cData, 0, sizeof(csv_writer_cData));
+	csv_writer_cData.config = *config;
+	csv_writer_cData.sinkFd = -1;
+	csv_writer_cData.spoolFd = -1;
+	csv_writer_cData.sinkErrno = 0;
+	if (csv_writer_copyStrings() != COMMON_TYPE_SUCCESS) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_stopRequested = 0;
+	csv_writer_reopenRequested = 0;
+	csv_writer_waitingForSpace = 0;
+	csv_writer_sinkFailed = 0;
+	csv_writer_spilledRows = 0;
+	csv_writer_spooledBytes = 0;
+	csv_writer_sinkFailures = 0;
+	csv_writer_formattedRows = 0;
+	csv_writer_formatNanos = 0;
+	csv_writer_batches = 0;
+
+	csv_writer_cData.flagsOffset = sizeof(csv_writer_row_t)
+			+ config->columnCount * sizeof(common_type_t);
+	csv_writer_cData.arenaOffset = csv_writer_cData.flagsOffset
+			+ config->columnCount;
+	csv_writer_cData.arenaSize = config->columnCount
+			* CSV_WRITER_ARENA_PER_COLUMN;
+	if (ring_buffer_init(&csv_writer_cData.ring, config->queueLength,
+			csv_writer_cData.arenaOffset + csv_writer_cData.arenaSize)
+			!= COMMON_TYPE_SUCCESS) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_cData.stats.capacity = config->queueLength;
+
+	// Every string of a row is limited by the arena and escaped at most twice
+	csv_writer_cData.rowCapacity = CSV_WRITER_TIMESTAMP_BUFFER_SIZE
+			+ config->columnCount * (strlen(config->separator)
+					+ CSV_WRITER_NUMBER_SIZE + 2) + 2 * csv_writer_cData.arenaSize
+			+ strlen(CSV_WRITER_NEWLINE) + 1;
+	csv_writer_cData.separatorLength = strlen(config->separator);
+	csv_writer_cData.batchCapacity = csv_writer_cData.rowCapacity;
+	if (csv_writer_cData.batchCapacity < CSV_WRITER_BATCH_SIZE) {
+		csv_writer_cData.batchCapacity = CSV_WRITER_BATCH_SIZE;
+	}
+	csv_writer_cData.batchBuffer = malloc(csv_writer_cData.batchCapacity);
+	csv_writer_cData.copy = malloc(csv_writer_cData.ring.slotSize);
+	if (csv_writer_cData.batchBuffer == NULL || csv_writer_cData.copy == NULL) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+	err = csv_writer_initHeader();
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+	if (csv_writer_initColumns() != COMMON_TYPE_SUCCESS) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_cData.config.titles = NULL;
+	csv_writer_cData.config.timeHeader = NULL;
+	csv_writer_cData.config.encodings = NULL;
+
+	if (config->timeMode == CSV_WRITER_TIME_LOCAL && (gettimeofday(&now, NULL)
+			!= 0 || csv_writer_formatTimestamp(&now, csv_writer_cData.batchBuffer)
+			== 0)) {
+		logging_adapter_info("Can't successfully create the time string \"%s\"",
+				config->timeFormat);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	if (config->policy == CSV_WRITER_POLICY_SPILL) {
+		csv_writer_cData.spoolFd = open(config->spoolFileName,
+				O_RDWR | O_APPEND | O_CREAT, CSV_WRITER_FILE_MODE);
+		if (csv_writer_cData.spoolFd < 0) {
+			logging_adapter_info("Can't open the spool file \"%s\": %s",
+					config->spoolFileName, strerror(errno));
+			return COMMON_TYPE_ERR_IO;
+		}
+		(void) fcntl(csv_writer_cData.spoolFd, F_SETFD, FD_CLOEXEC);
+		csv_writer_cData.spoolSize = lseek(csv_writer_cData.spoolFd, 0,
+				SEEK_END);
+		if (csv_writer_cData.spoolSize < 0) {
+			logging_adapter_info("Can't determine the size of the spool file: %s",
+					strerror(errno));
+			return COMMON_TYPE_ERR_IO;
+		} else if (csv_writer_cData.spoolSize > 0) {
+			logging_adapter_info("Found %lld spooled byte(s), append them to the "
+					"CSV file", (long long) csv_writer_cData.spoolSize);
+		}
+		csv_writer_updateSpooledBytes();
+	}
+
+	err = csv_writer_openSink();
+	if (err != COMMON_TYPE_SUCCESS) {
+		logging_adapter_info("Can't open the file \"%s\" to append data: %s",
+				config->fileName, strerror(errno));
+		if (config->policy != CSV_WRITER_POLICY_SPILL)
+			return err;
+		csv_writer_failSink(errno);
+	}
+
+	if (sem_init(&csv_writer_wakeup, 0, 0) != 0) {
+		logging_adapter_info("Can't create the writer's semaphore: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_cData.wakeupValid = 1;
+	if (sem_init(&csv_writer_space, 0, 0) != 0) {
+		logging_adapter_info("Can't create the writer's semaphore: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_cData.spaceValid = 1;
+
+	// Signals are handled by the acquisition thread only
+	(void) sigfillset(&allSignals);
+	(void) pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+	retCode = pthread_create(&csv_writer_thread, NULL, &csv_writer_run, NULL);
+	(void) pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+	if (retCode != 0) {
+		logging_adapter_info("Can't start the writer thread: %s",
+				strerror(retCode));
+		return COMMON_TYPE_ERR;
+	}
+	csv_writer_cData.threadRunning = 1;
+
+	logging_adapter_debug("Started the writer thread queueing up to %u rows",
+			config->queueLength);
+	return COMMON_TYPE_SUCCESS;
+}
+
+csv_writer_row_t * csv_writer_beginRow(const struct timeval *timestamp) {
+	csv_writer_row_t *row;
+
+	assert(timestamp != NULL);
+	assert(csv_writer_cData.threadRunning);
+
+	row = ring_buffer_reserve(&csv_writer_cData.ring);
+	if (row == NULL && csv_writer_cData.config.policy
+			== CSV_WRITER_POLICY_BLOCK) {
+		csv_writer_cData.stats.blockedRows++;
+		logging_adapter_debug("The CSV file can't keep up, wait for room");
+		row = csv_writer_waitForSpace();
+		while (row == NULL) {
+			if (csv_writer_cData.config.waitHandler != NULL
+					&& csv_writer_cData.config.waitHandler()
+							!= COMMON_TYPE_SUCCESS) {
+				logging_adapter_debug("Stop waiting for room in the queue");
+				return NULL;
+			}
+			row = csv_writer_waitForSpace();
+		}
+	}
+	while (row == NULL) {
+		if (ring_buffer_dropOldest(&csv_writer_cData.ring)) {
+			csv_writer_cData.stats.droppedRows++;
+			logging_adapter_info("The CSV file can't keep up, drop the oldest row "
+					"(%llu row(s) dropped in total)",
+					(unsigned long long) csv_writer_cData.stats.droppedRows);
+		}
+		row = ring_buffer_reserve(&csv_writer_cData.ring);
+	}
+
+	row->timestamp = *timestamp;
+	row->arenaUsed = 0;
+	memset(csv_writer_getFlags(row), 0, csv_writer_cData.config.columnCount);
+
+	return row;
+}
+
+/**
+ * @brief Waits until the writer thread made room for the next row
+ * @details The wait is bounded by the retry interval.
+ * @return The row reserved or NULL if the ring is still full
+ */
+static csv_writer_row_t * csv_writer_waitForSpace(void) {
+	csv_writer_row_t *row;
+	struct timespec deadline;
+
+	if (clock_gettime(CLOCK_REALTIME, &deadline) != 0)
+		return NULL;
+	deadline.tv_sec += CSV_WRITER_RETRY_INTERVAL;
+
+	do {
+		// Announce waiting before checking again, so no wakeup is missed
+		__atomic_store_n(&csv_writer_waitingForSpace, 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		row = ring_buffer_reserve(&csv_writer_cData.ring);
+		if (row != NULL)
+			break;
+		if (sem_timedwait(&csv_writer_space, &deadline) != 0 && errno
+				== ETIMEDOUT) {
+			row = ring_buffer_reserve(&csv_writer_cData.ring);
+			break;
+		}
+	} while (row == NULL);
+
+	__atomic_store_n(&csv_writer_waitingForSpace, 0, __ATOMIC_RELAXED);
+	return row;
+}
+
+void csv_writer_setValue(csv_writer_row_t *row, unsigned int column,
+		const common_type_t *value) {
+	common_type_t *target;
+	char *arena;
+	size_t length, available;
+
+	assert(row != NULL);
+	assert(value != NULL);
+	assert(column < csv_writer_cData.config.columnCount);
+
+	target = &csv_writer_getValues(row)[column];
+	*target = *value;
+	csv_writer_getFlags(row)[column] = 1;
+
+	if (value->type != COMMON_TYPE_STRING)
+		return;
+
+	assert(value->data.strVal != NULL);
+	assert(row->arenaUsed <= csv_writer_cData.arenaSize);
+	arena = &csv_writer_getArena(row)[row->arenaUsed];
+	available = csv_writer_cData.arenaSize - row->arenaUsed;
+	if (available == 0) {
+		// Not even the terminating '\0' fits, so the field is left empty
+		csv_writer_getFlags(row)[column] = 0;
+		csv_writer_cData.stats.truncatedStrings++;
+		logging_adapter_debug("Leave the string of column %u empty since the "
+				"row's arena is full", column);
+		return;
+	}
+	length = strlen(value->data.strVal);
+	if (length >= available) {
+		csv_writer_cData.stats.truncatedStrings++;
+		logging_adapter_debug("Truncate the string of column %u to %u "
+				"character(s)", column, (unsigned) (available - 1));
+		length = available - 1;
+	}
+	memcpy(arena, value->data.strVal, length);
+	arena[length] = '\0';
+	target->data.strVal = arena;
+	row->arenaUsed += length + 1;
+}
+
+void csv_writer_commitRow(csv_writer_row_t *row) {
+	assert(row != NULL);
+	assert(csv_writer_cData.threadRunning);
+
+	ring_buffer_publish(&csv_writer_cData.ring);
+	csv_writer_cData.stats.rows++;
+	(void) sem_post(&csv_writer_wakeup);
+}
+
+void csv_writer_reopen(void) {
+	assert(csv_writer_cData.threadRunning);
+
+	__atomic_store_n(&csv_writer_reopenRequested, 1, __ATOMIC_RELEASE);
+	(void) sem_post(&csv_writer_wakeup);
+}
+
+void csv_writer_getStatistics(csv_writer_statistics_t *stats) {
+	assert(stats != NULL);
+
+	*stats = csv_writer_cData.stats;
+	if (csv_writer_cData.ring.slots != NULL) {
+		stats->occupancy = ring_buffer_getOccupancy(&csv_writer_cData.ring);
+		stats->maxOccupancy = csv_writer_cData.ring.maxOccupancy;
+	}
+	stats->spilledRows = __atomic_load_n(&csv_writer_spilledRows,
+			__ATOMIC_RELAXED);
+	stats->spooledBytes = __atomic_load_n(&csv_writer_spooledBytes,
+			__ATOMIC_RELAXED);
+	stats->sinkFailures = __atomic_load_n(&csv_writer_sinkFailures,
+			__ATOMIC_RELAXED);
+	stats->formattedRows = __atomic_load_n(&csv_writer_formattedRows,
+			__ATOMIC_RELAXED);
+	stats->formatNanos = __atomic_load_n(&csv_writer_formatNanos,
+			__ATOMIC_RELAXED);
+	stats->batches = __atomic_load_n(&csv_writer_batches, __ATOMIC_RELAXED);
+	stats->sinkFailed = __atomic_load_n(&csv_writer_sinkFailed,
+			__ATOMIC_RELAXED) != 0;
+}
+
+common_type_error_t csv_writer_free(void) {
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+	unsigned int lost = 0;
+	int errorNumber = 0;
+
+	if (csv_writer_cData.threadRunning) {
+		__atomic_store_n(&csv_writer_stopRequested, 1, __ATOMIC_RELEASE);
+		(void) sem_post(&csv_writer_wakeup);
+		(void) pthread_join(csv_writer_thread, NULL);
+		csv_writer_cData.threadRunning = 0;
+
+		lost = ring_buffer_getOccupancy(&csv_writer_cData.ring)
+				+ csv_writer_cData.batchRows;
+		if (lost > 0) {
+			logging_adapter_info("Lost %u row(s) since the CSV file still fails",
+					lost);
+			errorNumber = csv_writer_cData.sinkErrno != 0 ?
+					csv_writer_cData.sinkErrno : EIO;
+			err = COMMON_TYPE_ERR_IO;
+		}
+	}
+	if (csv_writer_cData.wakeupValid) {
+		(void) sem_destroy(&csv_writer_wakeup);
+		csv_writer_cData.wakeupValid = 0;
+	}
+	if (csv_writer_cData.spaceValid) {
+		(void) sem_destroy(&csv_writer_space);
+		csv_writer_cData.spaceValid = 0;
+	}
+
+	if (csv_writer_cData.sinkFd >= 0) {
+		if (close(csv_writer_cData.sinkFd) != 0) {
+			errorNumber = errno;
+			logging_adapter_info("Can't close the CSV file: %s",
+					strerror(errorNumber));
+			err = COMMON_TYPE_ERR_IO;
+		}
+		csv_writer_cData.sinkFd = -1;
+	}
+	if (csv_writer_cData.spoolFd >= 0) {
+		if (csv_writer_cData.spoolSize > csv_writer_cData.spoolDrained) {
+			logging_adapter_info("Keep %lld byte(s) within the spool file until "
+					"the next start", (long long) (csv_writer_cData.spoolSize
+							- csv_writer_cData.spoolDrained));
+		}
+		(void) close(csv_writer_cData.spoolFd);
+		csv_writer_cData.spoolFd = -1;
+	}
+
+	free(csv_writer_cData.batchBuffer);
+	free(csv_writer_cData.copy);
+	free(csv_writer_cData.header);
+	free(csv_writer_cData.strings);
+	free(csv_writer_cData.columns);
+	csv_writer_cData.batchBuffer = NULL;
+	csv_writer_cData.copy = NULL;
+	csv_writer_cData.header = NULL;
+	csv_writer_cData.strings = NULL;
+	csv_writer_cData.columns = NULL;
+	if (csv_writer_cData.ring.slots != NULL) {
+		// Keep the statistics available after freeing the writer
+		csv_writer_cData.stats.maxOccupancy = csv_writer_cData.ring.maxOccupancy;
+		ring_buffer_free(&csv_writer_cData.ring);
+	}
+
+	errno = errorNumber;
+	return err;
+}
+
+/**
+ * @brief The writer thread's main loop
+ * @details The loop processes the rows on every wakeup and exits after the stop
+ * was requested and every row was processed once more.
+ * @param arg Unused
+ * @return Always NULL
+ */
+static void * csv_writer_run(void *arg) {
+	int stop;
+
+	(void) arg;
+
+	do {
+		csv_writer_sleep();
+		stop = __atomic_load_n(&csv_writer_stopRequested, __ATOMIC_ACQUIRE);
+
+		if (__atomic_exchange_n(&csv_writer_reopenRequested, 0,
+				__ATOMIC_ACQ_REL) && csv_writer_cData.sinkFd >= 0) {
+			logging_adapter_debug("Reopen the CSV file");
+			(void) close(csv_writer_cData.sinkFd);
+			csv_writer_cData.sinkFd = -1;
+		}
+
+		csv_writer_process();
+	} while (!stop);
+
+	return NULL;
+}
+
+/**
+ * @brief Waits for the next wakeup
+ * @details If data is held back because the CSV file failed, the wait is
+ * limited to the retry interval.
+ */
+static inline void csv_writer_sleep(void) {
+	struct timespec deadline;
+
+	if (csv_writer_cData.sinkFailed || csv_writer_cData.batchRows > 0) {
+		if (clock_gettime(CLOCK_REALTIME, &deadline) == 0) {
+			deadline.tv_sec += CSV_WRITER_RETRY_INTERVAL;
+			while (sem_timedwait(&csv_writer_wakeup, &deadline) != 0
+					&& errno == EINTR)
+				;
+			return;
+		}
+	}
+
+	while (sem_wait(&csv_writer_wakeup) != 0 && errno == EINTR)
+		;
+}
+
+/**
+ * @brief Writes the spooled data and every row available
+ * @details If the CSV file isn't open, it is opened first. The function
+ * returns as soon as a batch can be neither written nor spilled.
+ */
+static void csv_writer_process(void) {
+	if (csv_writer_cData.sinkFd < 0) {
+		if (csv_writer_openSink() != COMMON_TYPE_SUCCESS) {
+			csv_writer_failSink(errno);
+		}
+	}
+	if (csv_writer_cData.sinkFd >= 0) {
+		csv_writer_drainSpool();
+	}
+
+	while (csv_writer_cData.batchRows > 0 || csv_writer_fillBatch()) {
+		if (!csv_writer_deliverBatch())
+			return;
+	}
+}
+
+/**
+ * @brief Formats the rows available into the batch buffer
+ * @details Rows are taken as long as the buffer is able to hold a row of
+ * maximum length. The time spent is accounted for the statistics.
+ * @return Non-zero if rows are pending afterwards
+ */
+static int csv_writer_fillBatch(void) {
+	struct timespec start, end;
+
+	assert(csv_writer_cData.batchRows == 0);
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	csv_writer_cData.batchLength = 0;
+	csv_writer_cData.batchWritten = 0;
+	while (csv_writer_cData.batchCapacity - csv_writer_cData.batchLength
+			>= csv_writer_cData.rowCapacity && csv_writer_takeRow()) {
+		csv_writer_cData.batchLength += csv_writer_formatRow(
+				csv_writer_cData.copy,
+				&csv_writer_cData.batchBuffer[csv_writer_cData.batchLength]);
+		csv_writer_cData.batchRows++;
+	}
+	if (csv_writer_cData.batchRows == 0)
+		return 0;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &end);
+	__atomic_add_fetch(&csv_writer_formatNanos, (uint64_t) ((end.tv_sec
+			- start.tv_sec) * 1000000000LL + end.tv_nsec - start.tv_nsec),
+			__ATOMIC_RELAXED);
+	__atomic_add_fetch(&csv_writer_formattedRows, csv_writer_cData.batchRows,
+			__ATOMIC_RELAXED);
+	return 1;
+}
+
+/**
+ * @brief Copies the oldest row out of the ring
+ * @details The row is copied before it is released, so the producer may drop
+ * it meanwhile. In this case, the copy is discarded and the next row is taken.
+ * @return Non-zero if the copy holds a row afterwards
+ */
+static int csv_writer_takeRow(void) {
+	csv_writer_row_t *slot, *copy = csv_writer_cData.copy;
+	common_type_t *values;
+	uint8_t *flags;
+	unsigned int i;
+	int released;
+
+	do {
+		slot = ring_buffer_peek(&csv_writer_cData.ring);
+		if (slot == NULL)
+			return 0;
+
+		memcpy(copy, slot, csv_writer_cData.ring.slotSize);
+		released = ring_buffer_release(&csv_writer_cData.ring);
+		if (released) {
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (__atomic_exchange_n(&csv_writer_waitingForSpace, 0,
+					__ATOMIC_SEQ_CST)) {
+				(void) sem_post(&csv_writer_space);
+			}
+		}
+	} while (!released);
+
+	// The strings still reference the slot's arena
+	values = csv_writer_getValues(copy);
+	flags = csv_writer_getFlags(copy);
+	for (i = 0; i < csv_writer_cData.config.columnCount; i++) {
+		if (flags[i] && values[i].type == COMMON_TYPE_STRING) {
+			values[i].data.strVal = (char *) copy
+					+ (values[i].data.strVal - (char *) slot);
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * @brief Writes the rest of the pending batch to the CSV file or the spool
+ * file
+ * @details The CSV file is only written if no spooled data is left, so the
+ * order of the rows is kept.
+ * @return Non-zero if the batch was delivered completely
+ */
+static int csv_writer_deliverBatch(void) {
+	size_t written;
+
+	assert(csv_writer_cData.batchRows > 0);
+
+	if (csv_writer_cData.sinkFd >= 0
+			&& csv_writer_cData.spoolDrained == csv_writer_cData.spoolSize) {
+		if (csv_writer_writeAll(csv_writer_cData.sinkFd,
+				&csv_writer_cData.batchBuffer[csv_writer_cData.batchWritten],
+				csv_writer_cData.batchLength - csv_writer_cData.batchWritten,
+				&written) == COMMON_TYPE_SUCCESS) {
+			csv_writer_recoverSink();
+			__atomic_add_fetch(&csv_writer_batches, 1, __ATOMIC_RELAXED);
+			csv_writer_cData.batchRows = 0;
+			return 1;
+		}
+		csv_writer_cData.batchWritten += written;
+		csv_writer_failSink(errno);
+	}
+
+	if (csv_writer_cData.spoolFd >= 0) {
+		if (csv_writer_spill(
+				&csv_writer_cData.batchBuffer[csv_writer_cData.batchWritten],
+				csv_writer_cData.batchLength - csv_writer_cData.batchWritten,
+				&written) == COMMON_TYPE_SUCCESS) {
+			__atomic_add_fetch(&csv_writer_spilledRows,
+					csv_writer_cData.batchRows, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&csv_writer_batches, 1, __ATOMIC_RELAXED);
+			csv_writer_cData.batchRows = 0;
+			return 1;
+		}
+		csv_writer_cData.batchWritten += written;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Opens the CSV file to append data and eventually writes the headline
+ * @return The status of the operation, errno is set on failure
+ */
+static common_type_error_t csv_writer_openSink(void) {
+	size_t written;
+	int writeHeader, fd, savedErrno;
+
+	assert(csv_writer_cData.sinkFd < 0);
+
+	writeHeader = access(csv_writer_cData.config.fileName, F_OK);
+
+	fd = open(csv_writer_cData.config.fileName, O_WRONLY | O_APPEND | O_CREAT,
+			CSV_WRITER_FILE_MODE);
+	if (fd < 0)
+		return COMMON_TYPE_ERR_IO;
+	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (writeHeader) {
+		logging_adapter_debug("File \"%s\" doesn't exist. Try to create it and "
+				"write a headline", csv_writer_cData.config.fileName);
+		if (csv_writer_writeAll(fd, csv_writer_cData.header,
+				csv_writer_cData.headerLength, &written) != COMMON_TYPE_SUCCESS) {
+			savedErrno = errno;
+			(void) close(fd);
+			errno = savedErrno;
+			return COMMON_TYPE_ERR_IO;
+		}
+	}
+
+	csv_writer_cData.sinkFd = fd;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Closes the failing CSV file
+ * @details The failure is only reported once until the file recovers.
+ * @param errorNumber The errno value describing the failure
+ */
+static void csv_writer_failSink(int errorNumber) {
+	if (csv_writer_cData.sinkFd >= 0) {
+		(void) close(csv_writer_cData.sinkFd);
+		csv_writer_cData.sinkFd = -1;
+	}
+	csv_writer_cData.sinkErrno = errorNumber;
+	if (csv_writer_cData.sinkFailed)
+		return;
+
+	logging_adapter_info("Can't write to the CSV file: %s, %s until it recovers",
+			strerror(errorNumber), csv_writer_cData.spoolFd >= 0 ?
+					"spool the rows" : "keep the rows");
+	csv_writer_cData.sinkFailed = 1;
+	__atomic_store_n(&csv_writer_sinkFailed, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&csv_writer_sinkFailures, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Marks the CSV file as recovered after it was written successfully
+ */
+static inline void csv_writer_recoverSink(void) {
+	if (!csv_writer_cData.sinkFailed)
+		return;
+
+	logging_adapter_info("The CSV file recovered");
+	csv_writer_cData.sinkFailed = 0;
+	__atomic_store_n(&csv_writer_sinkFailed, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Appends the data left within the spool file to the CSV file
+ * @details The spool file is truncated once it was drained completely. If
+ * the spool file can't be read, the data left is discarded.
+ */
+static void csv_writer_drainSpool(void) {
+	char buffer[CSV_WRITER_DRAIN_BUFFER_SIZE];
+	size_t length, written;
+	ssize_t retVal;
+
+	assert(csv_writer_cData.sinkFd >= 0);
+
+	if (csv_writer_cData.spoolSize == 0)
+		return;
+
+	while (csv_writer_cData.spoolDrained < csv_writer_cData.spoolSize) {
+		length = csv_writer_cData.spoolSize - csv_writer_cData.spoolDrained;
+		if (length > sizeof(buffer)) {
+			length = sizeof(buffer);
+		}
+
+		retVal = pread(csv_writer_cData.spoolFd, buffer, length,
+				csv_writer_cData.spoolDrained);
+		if (retVal < 0 && errno == EINTR) {
+			continue;
+		} else if (retVal <= 0) {
+			logging_adapter_info("Can't read the spool file, discard %lld "
+					"byte(s)", (long long) (csv_writer_cData.spoolSize
+							- csv_writer_cData.spoolDrained));
+			break;
+		}
+
+		if (csv_writer_writeAll(csv_writer_cData.sinkFd, buffer, retVal,
+				&written) != COMMON_TYPE_SUCCESS) {
+			csv_writer_cData.spoolDrained += written;
+			csv_writer_updateSpooledBytes();
+			csv_writer_failSink(errno);
+			return;
+		}
+		csv_writer_cData.spoolDrained += written;
+		csv_writer_recoverSink();
+	}
+
+	if (ftruncate(csv_writer_cData.spoolFd, 0) != 0) {
+		logging_adapter_info("Can't truncate the spool file: %s",
+				strerror(errno));
+	}
+	logging_adapter_info("Appended %lld spooled byte(s) to the CSV file",
+			(long long) csv_writer_cData.spoolDrained);
+	csv_writer_cData.spoolSize = 0;
+	csv_writer_cData.spoolDrained = 0;
+	csv_writer_updateSpooledBytes();
+}
+
+/**
+ * @brief Appends data to the spool file
+ * @details A failure is only reported once until the spool file succeeds
+ * again.
+ * @param buffer The data to append
+ * @param length The number of bytes to append
+ * @param written The location to store the number of bytes appended
+ * @return The status of the operation
+ */
+static common_type_error_t csv_writer_spill(const char *buffer, size_t length,
+		size_t *written) {
+	common_type_error_t err;
+
+	assert(csv_writer_cData.spoolFd >= 0);
+
+	err = csv_writer_writeAll(csv_writer_cData.spoolFd, buffer, length,
+			written);
+	csv_writer_cData.spoolSize += *written;
+	csv_writer_updateSpooledBytes();
+
+	if (err != COMMON_TYPE_SUCCESS && !csv_writer_cData.spoolFailed) {
+		logging_adapter_info("Can't append to the spool file: %s",
+				strerror(errno));
+	}
+	csv_writer_cData.spoolFailed = err != COMMON_TYPE_SUCCESS;
+	return err;
+}
+
+/**
+ * @brief Writes the whole buffer to the file descriptor
+ * @param fd The file descriptor to write
+ * @param buffer The data to write
+ * @param length The number of bytes to write
+ * @param written The location to store the number of bytes written
+ * @return The status of the operation, errno is set on failure
+ */
+static common_type_error_t csv_writer_writeAll(int fd, const char *buffer,
+		size_t length, size_t *written) {
+	ssize_t retVal;
+
+	assert(buffer != NULL || length == 0);
+	assert(written != NULL);
+
+	*written = 0;
+	while (*written < length) {
+		retVal = write(fd, &buffer[*written], length - *written);
+		if (retVal < 0 && errno == EINTR) {
+			continue;
+		} else if (retVal <= 0) {
+			if (retVal == 0) {
+				errno = EIO;
+			}
+			return COMMON_TYPE_ERR_IO;
+		}
+		*written += retVal;
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Publishes the number of spooled bytes for the statistics
+ */
+static inline void csv_writer_updateSpooledBytes(void) {
+	__atomic_store_n(&csv_writer_spooledBytes, (uint64_t) (
+			csv_writer_cData.spoolSize - csv_writer_cData.spoolDrained),
+			__ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Copies the strings used after initialization
+ * @details The file names, the time format and the separator are copied into
+ * a single block, so the caller's configuration may be freed afterwards.
+ * @return The status of the operation
+ */
+static common_type_error_t csv_writer_copyStrings(void) {
+	csv_writer_config_t *config = &csv_writer_cData.config;
+	char *pos;
+
+	csv_writer_cData.strings = malloc(csv_writer_stringSize(config->fileName)
+			+ csv_writer_stringSize(config->timeFormat)
+			+ csv_writer_stringSize(config->separator)
+			+ csv_writer_stringSize(config->spoolFileName));
+	if (csv_writer_cData.strings == NULL)
+		return COMMON_TYPE_ERR;
+
+	pos = csv_writer_cData.strings;
+	config->fileName = csv_writer_copyString(&pos, config->fileName);
+	config->timeFormat = csv_writer_copyString(&pos, config->timeFormat);
+	config->separator = csv_writer_copyString(&pos, config->separator);
+	config->spoolFileName = csv_writer_copyString(&pos, config->spoolFileName);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Returns the size of the given string's copy
+ * @param str The string or NULL
+ * @return The size including the terminating '\0' or 0 if str is NULL
+ */
+static inline size_t csv_writer_stringSize(const char *str) {
+	return str != NULL ? strlen(str) + 1 : 0;
+}
+
+/**
+ * @brief Copies the given string to the given position
+ * @details NULL references are kept.
+ * @param pos The position receiving the copy, which is advanced behind it
+ * @param str The string to copy or NULL
+ * @return The copy or NULL
+ */
+static inline const char * csv_writer_copyString(char **pos, const char *str) {
+	char *copy = *pos;
+	size_t size = csv_writer_stringSize(str);
+
+	if (str == NULL)
+		return NULL;
+
+	memcpy(copy, str, size);
+	*pos += size;
+	return copy;
+}
+
+/**
+ * @brief Formats the CSV header
+ * @details The first column will be the time stamp header followed by the
+ * title of every value column.
+ * @return The status of the operation
+ */
+static common_type_error_t csv_writer_initHeader(void) {
+	const csv_writer_config_t *config = &csv_writer_cData.config;
+	size_t size, separatorLength = strlen(config->separator);
+	unsigned int i;
+	char *pos;
+
+	size = 2 + 2 * strlen(config->timeHeader) + strlen(CSV_WRITER_NEWLINE) + 1;
+	for (i = 0; i < config->columnCount; i++) {
+		size += separatorLength + 2 + 2 * strlen(config->titles[i]);
+	}
+
+	csv_writer_cData.header = malloc(size);
+	if (csv_writer_cData.header == NULL) {
+		logging_adapter_info("Not enough memory available");
+		return COMMON_TYPE_ERR;
+	}
+
+	pos = csv_writer_formatString(csv_writer_cData.header, config->timeHeader);
+	for (i = 0; i < config->columnCount; i++) {
+		memcpy(pos, config->separator, separatorLength);
+		pos = csv_writer_formatString(pos + separatorLength, config->titles[i]);
+	}
+	memcpy(pos, CSV_WRITER_NEWLINE, strlen(CSV_WRITER_NEWLINE));
+	pos += strlen(CSV_WRITER_NEWLINE);
+
+	csv_writer_cData.headerLength = pos - csv_writer_cData.header;
+	assert(csv_writer_cData.headerLength < size);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Resolves the formatting of every value column
+ * @details Columns printing the values as delivered use the plain formatters.
+ * Columns scaled by a power of ten rescale fixed-point values exactly, any
+ * other encoded column converts every number to double.
+ * @return The status of the operation
+ */
+static common_type_error_t csv_writer_initColumns(void) {
+	/** @brief The formatters printing the values as delivered */
+	static const csv_writer_formatter_t plain[] = {
+			[COMMON_TYPE_LONG] = csv_writer_formatLong,
+			[COMMON_TYPE_DOUBLE] = csv_writer_formatDouble,
+			[COMMON_TYPE_STRING] = csv_writer_formatStringValue,
+			[COMMON_TYPE_ERROR] = csv_writer_formatError,
+			[COMMON_TYPE_FIXED] = csv_writer_formatFixed };
+	/** @brief The formatters of columns scaled by a power of ten */
+	static const csv_writer_formatter_t decimal[] = {
+			[COMMON_TYPE_LONG] = csv_writer_formatScaledLong,
+			[COMMON_TYPE_DOUBLE] = csv_writer_formatScaledDouble,
+			[COMMON_TYPE_STRING] = csv_writer_formatStringValue,
+			[COMMON_TYPE_ERROR] = csv_writer_formatError,
+			[COMMON_TYPE_FIXED] = csv_writer_formatDecimalFixed };
+	/** @brief The formatters of any other encoded column */
+	static const csv_writer_formatter_t scaled[] = {
+			[COMMON_TYPE_LONG] = csv_writer_formatScaledLong,
+			[COMMON_TYPE_DOUBLE] = csv_writer_formatScaledDouble,
+			[COMMON_TYPE_STRING] = csv_writer_formatStringValue,
+			[COMMON_TYPE_ERROR] = csv_writer_formatError,
+			[COMMON_TYPE_FIXED] = csv_writer_formatScaledFixed };
+	const csv_writer_encoding_t *encoding;
+	csv_writer_column_t *column;
+	unsigned int i;
+	int exponent;
+
+	csv_writer_cData.columns = malloc(csv_writer_cData.config.columnCount
+			* sizeof(csv_writer_cData.columns[0]) + 1);
+	if (csv_writer_cData.columns == NULL)
+		return COMMON_TYPE_ERR;
+
+	for (i = 0; i < csv_writer_cData.config.columnCount; i++) {
+		column = &csv_writer_cData.columns[i];
+		column->formatters = plain;
+		column->scale = 1.0;
+		column->scaleExponent = 0;
+		column->precision = CSV_WRITER_NO_PRECISION;
+		if (csv_writer_cData.config.encodings == NULL)
+			continue;
+
+		encoding = &csv_writer_cData.config.encodings[i];
+		assert(isfinite(encoding->scale) && encoding->scale != 0.0);
+		assert(encoding->precision == CSV_WRITER_NO_PRECISION
+				|| (encoding->precision >= 0
+						&& encoding->precision <= COMMON_TYPE_FIXED_MAX_EXPONENT));
+		if (encoding->scale == 1.0
+				&& encoding->precision == CSV_WRITER_NO_PRECISION)
+			continue;
+
+		column->scale = encoding->scale;
+		column->precision = encoding->precision;
+		column->formatters = scaled;
+		for (exponent = -COMMON_TYPE_FIXED_MAX_EXPONENT;
+				exponent <= COMMON_TYPE_FIXED_MAX_EXPONENT; exponent++) {
+			if (encoding->scale == csv_writer_fixedToDouble(1, exponent)) {
+				column->scaleExponent = exponent;
+				column->formatters = decimal;
+				break;
+			}
+		}
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Formats a row
+ * @details Columns which weren't set are left empty. Each value is printed by
+ * the formatter of its column and type.
+ * @param row The row to format
+ * @param buffer The buffer of the row buffer's capacity receiving the row
+ * @return The length of the formatted row
+ */
+static size_t csv_writer_formatRow(csv_writer_row_t *row, char *buffer) {
+	const csv_writer_config_t *config = &csv_writer_cData.config;
+	common_type_t *values = csv_writer_getValues(row);
+	uint8_t *flags = csv_writer_getFlags(row);
+	size_t separatorLength = csv_writer_cData.separatorLength;
+	const csv_writer_column_t *column;
+	unsigned int i;
+	char *pos = buffer;
+
+	pos += csv_writer_formatTimestamp(&row->timestamp, pos);
+
+	for (i = 0; i < config->columnCount; i++) {
+		memcpy(pos, config->separator, separatorLength);
+		pos += separatorLength;
+		if (!flags[i])
+			continue;
+
+		assert(values[i].type <= COMMON_TYPE_FIXED);
+		column = &csv_writer_cData.columns[i];
+		pos = column->formatters[values[i].type](pos, &values[i], column);
+	}
+
+	memcpy(pos, CSV_WRITER_NEWLINE, strlen(CSV_WRITER_NEWLINE));
+	pos += strlen(CSV_WRITER_NEWLINE);
+
+	assert(pos - buffer < csv_writer_cData.rowCapacity);
+	return pos - buffer;
+}
+
+/**
+ * @brief Formats the given time-stamp
+ * @details The time-stamp is printed in the configured mode. If it can't be
+ * formatted, the field is left empty.
+ * @param tv The time stamp to print
+ * @param buffer The buffer receiving at most CSV_WRITER_TIMESTAMP_BUFFER_SIZE
+ * bytes
+ * @return The length of the time-stamp
+ */
+static inline size_t csv_writer_formatTimestamp(const struct timeval *tv,
+		char *buffer) {
+	assert(tv != NULL);
+
+	switch (csv_writer_cData.config.timeMode) {
+	case CSV_WRITER_TIME_EPOCH:
+		return fast_format_long(buffer, (int64_t) tv->tv_sec) - buffer;
+	case CSV_WRITER_TIME_EPOCH_MS:
+		return fast_format_long(buffer, (int64_t) tv->tv_sec * 1000
+				+ tv->tv_usec / 1000) - buffer;
+	default:
+		return csv_writer_formatLocalTime(tv->tv_sec, buffer);
+	}
+}
+
+/**
+ * @brief Formats the given second as local time
+ * @details The rendered time-stamp is cached. Within the minute of the cached
+ * time-stamp, the calendar fields can't change, since time zones change their
+ * offset on whole minutes only. Hence, only the seconds digits are patched,
+ * if the format contains them exactly once. Otherwise, the cached calendar
+ * fields are printed again without converting the time. The time is converted
+ * each time the minute changes, which picks up any daylight saving time
+ * transition.
+ * @param seconds The seconds since the epoch to print
+ * @param buffer The buffer receiving at most CSV_WRITER_TIMESTAMP_BUFFER_SIZE
+ * bytes
+ * @return The length of the time-stamp or zero if it can't be formatted
+ */
+static size_t csv_writer_formatLocalTime(time_t seconds, char *buffer) {
+	unsigned int second;
+	char *digits;
+
+	if (!csv_writer_cData.timeCached
+			|| seconds < csv_writer_cData.timeWindowStart
+			|| seconds - csv_writer_cData.timeWindowStart
+					>= csv_writer_cData.timeWindowLength) {
+		if (csv_writer_renderTimeWindow(seconds) != COMMON_TYPE_SUCCESS)
+			return 0;
+	}
+
+	second = (unsigned int) (seconds - csv_writer_cData.timeWindowStart);
+	if (second != csv_writer_cData.timeCachedSecond) {
+		if (csv_writer_cData.timeSecondsPatchable) {
+			digits = csv_writer_cData.timeCache + csv_writer_cData.timeSecondsOffset;
+			digits[0] = (char) ('0' + second / 10);
+			digits[1] = (char) ('0' + second % 10);
+		} else {
+			csv_writer_cData.timeCacheLength = local_time_format(
+					csv_writer_cData.timeCache, CSV_WRITER_TIMESTAMP_BUFFER_SIZE,
+					csv_writer_cData.config.timeFormat, second);
+			if (csv_writer_cData.timeCacheLength == 0) {
+				csv_writer_cData.timeCached = 0;
+				return 0;
+			}
+		}
+		csv_writer_cData.timeCachedSecond = second;
+	}
+
+	memcpy(buffer, csv_writer_cData.timeCache, csv_writer_cData.timeCacheLength);
+	return csv_writer_cData.timeCacheLength;
+}
+
+/**
+ * @brief Converts the given second and renders the first second of its window
+ * @details The seconds digits may be patched if the window spans the whole
+ * minute and rendering the first and the last second of the minute only
+ * differs in the two digits of the seconds.
+ * @param seconds The seconds since the epoch within the window
+ * @return The status of the operation
+ */
+static common_type_error_t csv_writer_renderTimeWindow(time_t seconds) {
+	char probe[CSV_WRITER_TIMESTAMP_BUFFER_SIZE];
+	size_t length, offset;
+	time_t windowStart;
+	unsigned int windowLength;
+
+	csv_writer_cData.timeCached = 0;
+	csv_writer_cData.timeSecondsPatchable = 0;
+	if (local_time_convert(seconds, &windowStart, &windowLength)
+			!= COMMON_TYPE_SUCCESS)
+		return COMMON_TYPE_ERR;
+	csv_writer_cData.timeWindowStart = windowStart;
+	csv_writer_cData.timeWindowLength = windowLength;
+	csv_writer_cData.timeCachedSecond = 0;
+
+	csv_writer_cData.timeCacheLength = local_time_format(
+			csv_writer_cData.timeCache, CSV_WRITER_TIMESTAMP_BUFFER_SIZE,
+			csv_writer_cData.config.timeFormat, 0);
+	if (csv_writer_cData.timeCacheLength == 0)
+		return COMMON_TYPE_ERR;
+	csv_writer_cData.timeCached = 1;
+
+	if (csv_writer_cData.timeWindowLength == CSV_WRITER_SECONDS_PER_MINUTE) {
+		length = local_time_format(probe, CSV_WRITER_TIMESTAMP_BUFFER_SIZE,
+				csv_writer_cData.config.timeFormat,
+				CSV_WRITER_SECONDS_PER_MINUTE - 1);
+		for (offset = 0; offset < length
+				&& probe[offset] == csv_writer_cData.timeCache[offset]; offset++)
+			;
+		csv_writer_cData.timeSecondsPatchable = length
+				== csv_writer_cData.timeCacheLength && offset + 2 <= length
+				&& memcmp(csv_writer_cData.timeCache + offset, "00", 2) == 0
+				&& memcmp(probe + offset, "59", 2) == 0
+				&& memcmp(probe + offset + 2,
+						csv_writer_cData.timeCache + offset + 2, length - offset - 2)
+						== 0;
+		csv_writer_cData.timeSecondsOffset = offset;
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Formats the given string
+ * @details The string is enclosed within double quotes and any double quote
+ * character will be escaped using two double quotes. The terminating '\0'
+ * character won't be written. The buffer has to hold twice the string's length
+ * plus two bytes.
+ * @param buffer The buffer receiving the string
+ * @param str The string to format
+ * @return The position after the formatted string
+ */
+static inline char * csv_writer_formatString(char *buffer, const char *str) {
+	size_t length, segment;
+	const char *quote;
+
+	assert(buffer != NULL);
+	assert(str != NULL);
+
+	// Copy the segments up to and including each quote at once
+	length = strlen(str);
+	*buffer++ = '"';
+	while ((quote = memchr(str, '"', length)) != NULL) {
+		segment = quote - str + 1;
+		memcpy(buffer, str, segment);
+		buffer += segment;
+		*buffer++ = '"';
+		str += segment;
+		length -= segment;
+	}
+	memcpy(buffer, str, length);
+	buffer += length;
+	*buffer++ = '"';
+
+	return buffer;
+}
+
+/**
+ * @brief Prints a signed integer as delivered
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatLong(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column) {
+	return fast_format_long(buffer, (int64_t) value->data.longVal);
+}
+
+/**
+ * @brief Prints a double as delivered
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatDouble(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column) {
+	return fast_format_double(buffer, value->data.doubleVal);
+}
+
+/**
+ * @brief Prints a fixed-point value as delivered
+ * @details Values exceeding the exponent's range are printed as double.
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatFixed(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column) {
+	char *pos;
+
+	pos = csv_writer_formatDecimal(buffer, value->data.fixedVal.mantissa,
+			value->data.fixedVal.exponent, CSV_WRITER_NO_PRECISION);
+	if (pos != NULL)
+		return pos;
+	return fast_format_double(buffer, csv_writer_fixedToDouble(
+			value->data.fixedVal.mantissa, value->data.fixedVal.exponent));
+}
+
+/**
+ * @brief Prints a string within double quotes
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatStringValue(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column) {
+	return csv_writer_formatString(buffer, value->data.strVal);
+}
+
+/**
+ * @brief Prints the place holder of a value which couldn't be fetched
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatError(char *buffer, const common_type_t *value,
+		const csv_writer_column_t *column) {
+	memcpy(buffer, CSV_WRITER_ERR, strlen(CSV_WRITER_ERR));
+	return buffer + strlen(CSV_WRITER_ERR);
+}
+
+/**
+ * @brief Prints an encoded signed integer
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatScaledLong(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column) {
+	return csv_writer_formatScaled(buffer,
+			(double) (int64_t) value->data.longVal, column);
+}
+
+/**
+ * @brief Prints an encoded double
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatScaledDouble(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column) {
+	return csv_writer_formatScaled(buffer, value->data.doubleVal, column);
+}
+
+/**
+ * @brief Prints an encoded fixed-point value converted to double
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatScaledFixed(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column) {
+	return csv_writer_formatScaled(buffer, csv_writer_fixedToDouble(
+			value->data.fixedVal.mantissa, value->data.fixedVal.exponent), column);
+}
+
+/**
+ * @brief Prints a fixed-point value of a column scaled by a power of ten
+ * @details The exponent is shifted without floating-point arithmetic. The
+ * value is converted to double if the result doesn't fit.
+ * @see csv_writer_formatter_t
+ */
+static char * csv_writer_formatDecimalFixed(char *buffer,
+		const common_type_t *value, const csv_writer_column_t *column) {
+	char *pos;
+
+	pos = csv_writer_formatDecimal(buffer, value->data.fixedVal.mantissa,
+			value->data.fixedVal.exponent + column->scaleExponent,
+			column->precision);
+	if (pos != NULL)
+		return pos;
+	return csv_writer_formatScaledFixed(buffer, value, column);
+}
+
+/**
+ * @brief Applies the column's scale and precision to the given number
+ * @details If a precision is set, the result is rounded half away from zero
+ * and printed as fixed-point number, if it fits into the fixed-point
+ * representation. Otherwise, the double is printed.
+ * @param buffer The buffer receiving at most CSV_WRITER_NUMBER_SIZE characters
+ * @param value The number to print
+ * @param column The column the number belongs to
+ * @return The position after the last character written
+ */
+static char * csv_writer_formatScaled(char *buffer, double value,
+		const csv_writer_column_t *column) {
+	double scaled;
+
+	value *= column->scale;
+	if (column->precision != CSV_WRITER_NO_PRECISION && isfinite(value)) {
+		scaled = value * csv_writer_pow10[column->precision];
+		scaled += scaled < 0.0 ? -0.5 : 0.5;
+		if (scaled > INT32_MIN && scaled < INT32_MAX) {
+			return fast_format_fixed(buffer, (int32_t) scaled, -column->precision);
+		}
+	}
+
+	return fast_format_double(buffer, value);
+}
+
+/**
+ * @brief Prints the given decimal number as fixed-point number
+ * @details If a precision is given, the number is rounded half away from
+ * zero or padded to the given number of fractional digits. Nothing is printed
+ * if the result doesn't fit into the fixed-point representation.
+ * @param buffer The buffer receiving at most CSV_WRITER_NUMBER_SIZE characters
+ * @param mantissa The mantissa of the number
+ * @param exponent The decimal exponent of the number
+ * @param precision The number of fractional digits or CSV_WRITER_NO_PRECISION
+ * @return The position after the last character written or NULL if the number
+ * wasn't printed
+ */
+static char * csv_writer_formatDecimal(char *buffer, int64_t mantissa,
+		int exponent, int precision) {
+	const int maxExponent = sizeof(csv_writer_pow10)
+			/ sizeof(csv_writer_pow10[0]) - 1;
+	int64_t divisor, rest;
+
+	if (precision != CSV_WRITER_NO_PRECISION && -exponent > precision) {
+		if (-exponent - precision > maxExponent)
+			return NULL;
+		divisor = csv_writer_pow10[-exponent - precision];
+		rest = mantissa % divisor;
+		mantissa /= divisor;
+		if (2 * (rest < 0 ? -rest : rest) >= divisor) {
+			mantissa += rest < 0 ? -1 : 1;
+		}
+		exponent = -precision;
+	} else if (precision != CSV_WRITER_NO_PRECISION && -exponent < precision) {
+		if (exponent + precision > COMMON_TYPE_FIXED_MAX_EXPONENT)
+			return NULL;
+		mantissa *= csv_writer_pow10[exponent + precision];
+		exponent = -precision;
+	}
+
+	if (exponent < -COMMON_TYPE_FIXED_MAX_EXPONENT
+			|| exponent > COMMON_TYPE_FIXED_MAX_EXPONENT || mantissa < INT32_MIN
+			|| mantissa > INT32_MAX) {
+		return NULL;
+	}
+	return fast_format_fixed(buffer, (int32_t) mantissa, exponent);
+}
+
+/**
+ * @brief Converts the given decimal number to the nearest double
+ * @details Powers of ten up to 10^18 are exact, so a single rounding occurs
+ * for exponents within that range.
+ * @param mantissa The mantissa of the number
+ * @param exponent The decimal exponent of the number
+ * @return The converted number
+ */
+static double csv_writer_fixedToDouble(int64_t mantissa, int exponent) {
+	const int maxExponent = sizeof(csv_writer_pow10)
+			/ sizeof(csv_writer_pow10[0]) - 1;
+	double result = (double) mantissa;
+
+	for (; exponent > maxExponent; exponent -= maxExponent) {
+		result *= csv_writer_pow10[maxExponent];
+	}
+	for (; exponent < -maxExponent; exponent += maxExponent) {
+		result /= csv_writer_pow10[maxExponent];
+	}
+
+	if (exponent >= 0)
+		return result * csv_writer_pow10[exponent];
+	return result / csv_writer_pow10[-exponent];
+}
+
+/**
+ * @brief Returns the vector of values of a row record
+ * @param row The row record
+ * @return The vector holding a value per column
+ */
+static inline common_type_t * csv_writer_getValues(csv_writer_row_t *row) {
+	return (common_type_t *) ((uint8_t *) row + sizeof(*row));
+}
+
+/**
+ * @brief Returns the vector of flags marking the columns set
+ * @param row The row record
+ * @return The vector holding a flag per column
+ */
+static inline uint8_t * csv_writer_getFlags(csv_writer_row_t *row) {
+	return (uint8_t *) row + csv_writer_cData.flagsOffset;
+}
+
+/**
+ * @brief Returns the string arena of a row record
+ * @param row The row record
+ * @return The arena
+ */
+static inline char * csv_writer_getArena(csv_writer_row_t *row) {
+	return (char *) row + csv_writer_cData.arenaOffset;
+}
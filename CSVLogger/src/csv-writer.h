@@ -0,0 +1,235 @@
+/**
+ * @file csv-writer.h
+ * @brief Writes the CSV file in a separate thread
+ * @details The acquisition thread fills fixed-size row records and passes them
+ * to the writer thread using a lock-free single-producer single-consumer ring.
+ * The writer thread formats the rows queued into one batch and writes it to
+ * the CSV file at once, so the storage latency doesn't delay the next sample. String values are copied
+ * into an arena of the row, hence they don't need to remain valid after the
+ * row was filled. Every function except the writer thread itself has to be
+ * called by the same thread.
+ *
+ * Failing to write the file isn't fatal. The writer keeps the rows and tries
+ * to reopen the file periodically. Once the file accepts data again, every row
+ * kept is written in order. Memory is bounded by the ring, the policy decides
+ * what happens if it is full.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CSV_WRITER_H_
+#define CSV_WRITER_H_
+
+#include <common-type.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/** @brief The precision denoting that the fractional digits are kept */
+#define CSV_WRITER_NO_PRECISION (-1)
+
+/** @brief The policies applied if a row is added to the full ring */
+typedef enum {
+	/**
+	 * @brief Wait until the writer thread made room
+	 * @details No row is dropped. The wait handler is called once per retry
+	 * interval, so the acquisition thread can still serve other events while
+	 * the CSV file fails.
+	 */
+	CSV_WRITER_POLICY_BLOCK = 0,
+	/** @brief Drop the oldest row queued */
+	CSV_WRITER_POLICY_DROP_OLDEST,
+	/**
+	 * @brief Drop the oldest row queued, but move the rows to a spool file
+	 * while the CSV file fails
+	 * @details The spool file is appended while the CSV file fails and drained
+	 * into the CSV file once it recovers. A spool file left over is drained on
+	 * startup. Hence, the ring only fills if a write blocks.
+	 */
+	CSV_WRITER_POLICY_SPILL
+} csv_writer_policy_t;
+
+/** @brief The representations of the time-stamp column */
+typedef enum {
+	/**
+	 * @brief The local time printed by the strftime format
+	 * @details The rendered time-stamp is cached, so the calendar conversion is
+	 * done at most once a minute. Only the seconds are updated in between.
+	 */
+	CSV_WRITER_TIME_LOCAL = 0,
+	/** @brief The seconds since the epoch */
+	CSV_WRITER_TIME_EPOCH,
+	/** @brief The milliseconds since the epoch */
+	CSV_WRITER_TIME_EPOCH_MS
+} csv_writer_time_mode_t;
+
+/**
+ * @brief Handler called periodically while waiting for room in the ring
+ * @return COMMON_TYPE_SUCCESS to keep waiting, an error code to give up
+ */
+typedef common_type_error_t (*csv_writer_wait_handler_t)(void);
+
+/**
+ * @brief The encoding applied to the values of a column
+ * @details Fixed-point values scaled by a power of ten are rescaled without
+ * floating-point arithmetic. Any other numeric value is scaled as double. If a
+ * precision is set, the result is rounded half away from zero to the given
+ * number of fractional digits and printed as fixed-point value. If it doesn't
+ * fit into the fixed-point representation, the double is printed.
+ */
+typedef struct {
+	/** @brief The finite, non-zero factor each value is multiplied with */
+	double scale;
+	/**
+	 * @brief The number of fractional digits written
+	 * @details CSV_WRITER_NO_PRECISION keeps the digits delivered, otherwise
+	 * it's at most COMMON_TYPE_FIXED_MAX_EXPONENT.
+	 */
+	int precision;
+} csv_writer_encoding_t;
+
+/** @brief Opaque row record passed to the writer thread */
+typedef struct csv_writer_row csv_writer_row_t;
+
+/** @brief Structure defining the writer's parameters */
+typedef struct {
+	/** @brief The name of the file to append the rows */
+	const char *fileName;
+	/** @brief The representation of the time-stamp column */
+	csv_writer_time_mode_t timeMode;
+	/** @brief The strftime format of the time-stamp column in local mode */
+	const char *timeFormat;
+	/** @brief The title of the time-stamp column */
+	const char *timeHeader;
+	/** @brief The string separating two fields */
+	const char *separator;
+	/** @brief The vector of titles of the value columns */
+	const char * const *titles;
+	/**
+	 * @brief The vector of encodings of the value columns
+	 * @details NULL prints every value as delivered.
+	 */
+	const csv_writer_encoding_t *encodings;
+	/** @brief The number of value columns */
+	unsigned int columnCount;
+	/** @brief The number of rows the ring holds, greater than zero */
+	unsigned int queueLength;
+	/** @brief The policy applied if the ring is full */
+	csv_writer_policy_t policy;
+	/** @brief The name of the spool file, required by the spill policy only */
+	const char *spoolFileName;
+	/** @brief The handler called while blocking or NULL to wait silently */
+	csv_writer_wait_handler_t waitHandler;
+} csv_writer_config_t;
+
+/** @brief Structure holding the writer's statistics */
+typedef struct {
+	/** @brief The number of rows passed to the writer thread */
+	uint64_t rows;
+	/** @brief The number of rows dropped because the ring was full */
+	uint64_t droppedRows;
+	/** @brief The number of times a row had to wait for room in the ring */
+	uint64_t blockedRows;
+	/** @brief The number of rows moved to the spool file */
+	uint64_t spilledRows;
+	/** @brief The number of bytes within the spool file not yet drained */
+	uint64_t spooledBytes;
+	/** @brief The number of times writing the CSV file failed */
+	uint64_t sinkFailures;
+	/** @brief The number of rows formatted by the writer thread */
+	uint64_t formattedRows;
+	/** @brief The nanoseconds the writer thread spent formatting rows */
+	uint64_t formatNanos;
+	/** @brief The number of batches of rows delivered by a single write */
+	uint64_t batches;
+	/** @brief The number of strings truncated because the row's arena was full */
+	uint64_t truncatedStrings;
+	/** @brief The number of rows currently waiting to be written */
+	unsigned int occupancy;
+	/** @brief The maximum number of rows waiting at once */
+	unsigned int maxOccupancy;
+	/** @brief The number of rows the ring holds */
+	unsigned int capacity;
+	/** @brief Flag indicating that the CSV file currently fails */
+	unsigned int sinkFailed :1;
+} csv_writer_statistics_t;
+
+/**
+ * @brief Opens the CSV file and starts the writer thread
+ * @details If the file doesn't exist, it is created and the headline is
+ * written. Failing to open the CSV file initially is an error, unless the
+ * spill policy is used. The strings and encodings referenced by the
+ * configuration are copied, so they may be freed after returning. The
+ * formatting of each column is resolved once.
+ * @param config The writer's parameters
+ * @return The status of the operation
+ */
+common_type_error_t csv_writer_init(const csv_writer_config_t *config);
+
+/**
+ * @brief Reserves the next row record
+ * @details Every value column of the row is left empty until it is set. If
+ * the ring is full, the configured policy is applied. Hence, the function may
+ * block until the writer thread made room. A blocking call is abandoned if the
+ * wait handler gives up.
+ * @param timestamp The time-stamp of the row
+ * @return The row to fill or NULL if the wait handler gave up
+ */
+csv_writer_row_t * csv_writer_beginRow(const struct timeval *timestamp);
+
+/**
+ * @brief Stores a value into the row reserved
+ * @details Strings are copied into the row's arena. If the arena is full, the
+ * string is truncated. If nothing is left of the arena, the column stays
+ * empty.
+ * @param row The row returned by csv_writer_beginRow
+ * @param column The index of the value column
+ * @param value The value to store
+ */
+void csv_writer_setValue(csv_writer_row_t *row, unsigned int column,
+		const common_type_t *value);
+
+/**
+ * @brief Passes the row to the writer thread
+ * @param row The row returned by csv_writer_beginRow
+ */
+void csv_writer_commitRow(csv_writer_row_t *row);
+
+/**
+ * @brief Requests the writer thread to close and reopen the CSV file
+ * @details The request is processed asynchronously before the next row is
+ * written. Failing to reopen the file is handled like any write failure.
+ */
+void csv_writer_reopen(void);
+
+/**
+ * @brief Returns the statistics collected so far
+ * @param stats The location to store the statistics
+ */
+void csv_writer_getStatistics(csv_writer_statistics_t *stats);
+
+/**
+ * @brief Writes every row pending, stops the writer thread and closes the file
+ * @details If the CSV file still fails, the rows pending are spilled or lost.
+ * It's safe to call the function even if the writer wasn't initialized or was
+ * freed before.
+ * @return COMMON_TYPE_SUCCESS if no row was lost, an error code otherwise. On
+ * failure, errno describes the last failure of the CSV file.
+ */
+common_type_error_t csv_writer_free(void);
+
+#endif /* CSV_WRITER_H_ */
@@ -0,0 +1,523 @@
+/**
+ * @file fast-format.c
+ * @brief Implements the number formatting
+ * @details Doubles are printed by the Grisu2 algorithm following Florian
+ * Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+ * Integers" (PLDI 2010). The value and its rounding boundaries are scaled by a
+ * cached power of ten into a fixed range, so the digits can be generated by
+ * 64-bit integer arithmetic. Every cached power is the rounded 64-bit
+ * significand of 10^(-348 + 8 * i) for the i-th entry. Integers and the
+ * mantissas of fixed-point numbers are converted two digits at a time.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "fast-format.h"
+
+#include <assert.h>
+#include <string.h>
+
+/** @brief The number of explicitly stored significand bits of a double */
+#define FAST_FORMAT_SIGNIFICAND_SIZE 52
+/** @brief The exponent bias of a double including the significand's size */
+#define FAST_FORMAT_EXPONENT_BIAS (0x3FF + FAST_FORMAT_SIGNIFICAND_SIZE)
+/** @brief The mask selecting the exponent bits of a double */
+#define FAST_FORMAT_EXPONENT_MASK 0x7FF0000000000000ULL
+/** @brief The mask selecting the significand bits of a double */
+#define FAST_FORMAT_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+/** @brief The implicit leading bit of normalized doubles */
+#define FAST_FORMAT_HIDDEN_BIT 0x0010000000000000ULL
+/** @brief The mask selecting the sign bit of a double */
+#define FAST_FORMAT_SIGN_MASK 0x8000000000000000ULL
+/** @brief The maximum number of integer digits printed in plain notation */
+#define FAST_FORMAT_MAX_PLAIN_DIGITS 17
+/** @brief The maximum number of leading zeros printed in plain notation */
+#define FAST_FORMAT_MAX_LEADING_ZEROS 4
+
+/** @brief A floating-point number of a 64-bit significand f times 2^e */
+typedef struct {
+	/** @brief The significand */
+	uint64_t f;
+	/** @brief The binary exponent */
+	int e;
+} fast_format_fp_t;
+
+/** @brief The significands of the cached powers of ten */
+static const uint64_t fast_format_cachedPowersF[] = {
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+	0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+	0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+	0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+	0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+	0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+	0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+	0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+	0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+	0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+	0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+	0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+	0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+	0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+	0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+	0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+	0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+	0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+	0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+	0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+	0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+	0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+/** @brief The binary exponents of the cached powers of ten */
+static const int16_t fast_format_cachedPowersE[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066
+};
+
+/** @brief The powers of ten fitting into 64 bits */
+static const uint64_t fast_format_pow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL,
+		10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+		10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+		100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+		100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL };
+
+/** @brief The two-digit strings of 0 to 99 */
+static const char fast_format_digitPairs[] =
+		"0001020304050607080910111213141516171819202122232425262728293031323334"
+		"3536373839404142434445464748495051525354555657585960616263646566676869"
+		"707172737475767778798081828384858687888990919293949596979899";
+
+/* Function prototypes */
+static inline fast_format_fp_t fast_format_multiply(fast_format_fp_t x,
+		fast_format_fp_t y);
+static inline fast_format_fp_t fast_format_normalize(fast_format_fp_t x);
+static inline void fast_format_getBoundaries(fast_format_fp_t v,
+		fast_format_fp_t *minus, fast_format_fp_t *plus);
+static inline fast_format_fp_t fast_format_getCachedPower(int e, int *k);
+static inline void fast_format_round(char *digits, int length, uint64_t delta,
+		uint64_t rest, uint64_t tenKappa, uint64_t distance);
+static inline int fast_format_countDigits(uint32_t n);
+static int fast_format_generateDigits(fast_format_fp_t w, fast_format_fp_t mp,
+		uint64_t delta, char *digits, int *k);
+static int fast_format_grisu2(uint64_t bits, char *digits, int *k);
+static char * fast_format_prettify(char *buffer, const char *digits,
+		int length, int k);
+static inline char * fast_format_exponent(char *buffer, int exponent);
+
+char * fast_format_double(char *buffer, double value) {
+	char digits[18];
+	uint64_t bits;
+	int length, k;
+
+	assert(buffer != NULL);
+
+	memcpy(&bits, &value, sizeof(bits));
+	if ((bits & FAST_FORMAT_EXPONENT_MASK) == FAST_FORMAT_EXPONENT_MASK) {
+		if (bits & FAST_FORMAT_SIGNIFICAND_MASK) {
+			memcpy(buffer, "nan", 3);
+			return buffer + 3;
+		} else if (bits & FAST_FORMAT_SIGN_MASK) {
+			memcpy(buffer, "-inf", 4);
+			return buffer + 4;
+		}
+		memcpy(buffer, "inf", 3);
+		return buffer + 3;
+	}
+
+	if (bits & FAST_FORMAT_SIGN_MASK) {
+		*buffer++ = '-';
+		bits &= ~FAST_FORMAT_SIGN_MASK;
+	}
+	if (bits == 0) {
+		*buffer++ = '0';
+		return buffer;
+	}
+
+	length = fast_format_grisu2(bits, digits, &k);
+	return fast_format_prettify(buffer, digits, length, k);
+}
+
+char * fast_format_long(char *buffer, int64_t value) {
+	char digits[FAST_FORMAT_LONG_SIZE];
+	char *pos = &digits[sizeof(digits)];
+	uint64_t magnitude;
+	unsigned int pair;
+	size_t length;
+
+	assert(buffer != NULL);
+
+	// Negate unsigned, so the minimum value doesn't overflow
+	magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+	while (magnitude >= 100) {
+		pair = (unsigned int) (magnitude % 100) * 2;
+		magnitude /= 100;
+		*--pos = fast_format_digitPairs[pair + 1];
+		*--pos = fast_format_digitPairs[pair];
+	}
+	if (magnitude >= 10) {
+		pair = (unsigned int) magnitude * 2;
+		*--pos = fast_format_digitPairs[pair + 1];
+		*--pos = fast_format_digitPairs[pair];
+	} else {
+		*--pos = (char) ('0' + magnitude);
+	}
+
+	if (value < 0) {
+		*buffer++ = '-';
+	}
+	length = &digits[sizeof(digits)] - pos;
+	memcpy(buffer, pos, length);
+	return buffer + length;
+}
+
+char * fast_format_fixed(char *buffer, int32_t mantissa, int exponent) {
+	char digits[FAST_FORMAT_LONG_SIZE];
+	uint32_t magnitude;
+	int length, point;
+
+	assert(buffer != NULL);
+	assert(-FAST_FORMAT_MAX_FIXED_EXPONENT <= exponent
+			&& exponent <= FAST_FORMAT_MAX_FIXED_EXPONENT);
+
+	// Negate unsigned, so the minimum value doesn't overflow
+	magnitude = mantissa < 0 ? 0 - (uint32_t) mantissa : (uint32_t) mantissa;
+	if (mantissa < 0) {
+		*buffer++ = '-';
+	}
+	length = fast_format_long(digits, magnitude) - digits;
+
+	if (exponent >= 0) {
+		// Integer, e.g. 300
+		memcpy(buffer, digits, length);
+		memset(buffer + length, '0', exponent);
+		return buffer + length + exponent;
+	}
+
+	point = length + exponent;
+	if (point > 0) {
+		// Decimal point within the digits, e.g. 21.5
+		memcpy(buffer, digits, point);
+		buffer[point] = '.';
+		memcpy(buffer + point + 1, digits + point, -exponent);
+		return buffer + length + 1;
+	}
+
+	// Leading zeros, e.g. 0.05
+	buffer[0] = '0';
+	buffer[1] = '.';
+	memset(buffer + 2, '0', -point);
+	memcpy(buffer + 2 - point, digits, length);
+	return buffer + 2 - point + length;
+}
+
+/**
+ * @brief Multiplies two numbers rounding the 128-bit product to 64 bits
+ * @param x The first factor
+ * @param y The second factor
+ * @return The rounded product
+ */
+static inline fast_format_fp_t fast_format_multiply(fast_format_fp_t x,
+		fast_format_fp_t y) {
+	const uint64_t mask32 = 0xFFFFFFFFULL;
+	uint64_t a = x.f >> 32, b = x.f & mask32, c = y.f >> 32, d = y.f & mask32;
+	uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d, tmp;
+	fast_format_fp_t result;
+
+	tmp = (bd >> 32) + (ad & mask32) + (bc & mask32);
+	tmp += 1ULL << 31; // Round
+	result.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	result.e = x.e + y.e + 64;
+	return result;
+}
+
+/**
+ * @brief Shifts the significand until its most significant bit is set
+ * @param x The number to normalize, not zero
+ * @return The normalized number
+ */
+static inline fast_format_fp_t fast_format_normalize(fast_format_fp_t x) {
+	int shift;
+
+	assert(x.f != 0);
+
+	shift = __builtin_clzll(x.f);
+	x.f <<= shift;
+	x.e -= shift;
+	return x;
+}
+
+/**
+ * @brief Calculates the boundaries of the interval rounding to the value
+ * @details Both boundaries share the exponent of the normalized upper one.
+ * @param v The unnormalized value
+ * @param minus The location receiving the lower boundary
+ * @param plus The location receiving the upper boundary
+ */
+static inline void fast_format_getBoundaries(fast_format_fp_t v,
+		fast_format_fp_t *minus, fast_format_fp_t *plus) {
+	fast_format_fp_t upper, lower;
+
+	upper.f = (v.f << 1) + 1;
+	upper.e = v.e - 1;
+	upper = fast_format_normalize(upper);
+
+	// The lower boundary is closer if the value is a power of two
+	if (v.f == FAST_FORMAT_HIDDEN_BIT) {
+		lower.f = (v.f << 2) - 1;
+		lower.e = v.e - 2;
+	} else {
+		lower.f = (v.f << 1) - 1;
+		lower.e = v.e - 1;
+	}
+	lower.f <<= lower.e - upper.e;
+	lower.e = upper.e;
+
+	*minus = lower;
+	*plus = upper;
+}
+
+/**
+ * @brief Selects the cached power of ten scaling the binary exponent
+ * @details The power is chosen such that the scaled exponent is within
+ * [-60, -32].
+ * @param e The binary exponent of the normalized upper boundary
+ * @param k The location receiving the negated decimal exponent of the power
+ * @return The cached power of ten
+ */
+static inline fast_format_fp_t fast_format_getCachedPower(int e, int *k) {
+	fast_format_fp_t power;
+	double dk = (-61 - e) * 0.30102999566398114 + 347; // 1 / log2(10)
+	int ceilK = (int) dk;
+	unsigned int index;
+
+	if (dk - ceilK > 0.0) {
+		ceilK++;
+	}
+	index = (unsigned int) ((ceilK >> 3) + 1);
+	assert(index < sizeof(fast_format_cachedPowersF)
+			/ sizeof(fast_format_cachedPowersF[0]));
+
+	*k = -(-348 + (int) index * 8);
+	power.f = fast_format_cachedPowersF[index];
+	power.e = fast_format_cachedPowersE[index];
+	return power;
+}
+
+/**
+ * @brief Moves the last digit closer to the exact value if it remains within
+ * the rounding interval
+ * @param digits The digits generated
+ * @param length The number of digits generated
+ * @param delta The width of the rounding interval
+ * @param rest The distance of the digits to the upper boundary
+ * @param tenKappa The weight of the last digit
+ * @param distance The distance of the exact value to the upper boundary
+ */
+static inline void fast_format_round(char *digits, int length, uint64_t delta,
+		uint64_t rest, uint64_t tenKappa, uint64_t distance) {
+	while (rest < distance && delta - rest >= tenKappa && (rest + tenKappa
+			< distance || distance - rest > rest + tenKappa - distance)) {
+		digits[length - 1]--;
+		rest += tenKappa;
+	}
+}
+
+/**
+ * @brief Counts the decimal digits of the given number
+ * @param n The number
+ * @return The number of digits, at least one
+ */
+static inline int fast_format_countDigits(uint32_t n) {
+	int count = 1;
+
+	while (count < 10 && n >= fast_format_pow10[count]) {
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @brief Generates the shortest digits within the scaled rounding interval
+ * @param w The scaled value
+ * @param mp The scaled upper boundary
+ * @param delta The width of the scaled rounding interval
+ * @param digits The buffer receiving at most 17 digits
+ * @param k The decimal exponent which is adjusted by the digits' position
+ * @return The number of digits generated
+ */
+static int fast_format_generateDigits(fast_format_fp_t w, fast_format_fp_t mp,
+		uint64_t delta, char *digits, int *k) {
+	const int shift = -mp.e;
+	const uint64_t one = 1ULL << shift, distance = mp.f - w.f;
+	uint32_t integral = (uint32_t) (mp.f >> shift), digit;
+	uint64_t fraction = mp.f & (one - 1), rest;
+	int kappa = fast_format_countDigits(integral), length = 0;
+
+	// Integral part
+	while (kappa > 0) {
+		digit = integral / (uint32_t) fast_format_pow10[kappa - 1];
+		integral %= (uint32_t) fast_format_pow10[kappa - 1];
+		if (digit || length) {
+			digits[length++] = (char) ('0' + digit);
+		}
+		kappa--;
+
+		rest = ((uint64_t) integral << shift) + fraction;
+		if (rest <= delta) {
+			*k += kappa;
+			fast_format_round(digits, length, delta, rest,
+					(uint64_t) fast_format_pow10[kappa] << shift, distance);
+			return length;
+		}
+	}
+
+	// Fractional part
+	for (;;) {
+		fraction *= 10;
+		delta *= 10;
+		digit = (uint32_t) (fraction >> shift);
+		if (digit || length) {
+			digits[length++] = (char) ('0' + digit);
+		}
+		fraction &= one - 1;
+		kappa--;
+
+		if (fraction < delta) {
+			*k += kappa;
+			fast_format_round(digits, length, delta, fraction, one, -kappa
+					< (int) (sizeof(fast_format_pow10) / sizeof(fast_format_pow10[0]))
+					? distance * fast_format_pow10[-kappa] : 0);
+			return length;
+		}
+	}
+}
+
+/**
+ * @brief Generates the digits of a positive finite double
+ * @param bits The bits of the value, not zero
+ * @param digits The buffer receiving at most 17 digits
+ * @param k The location receiving the decimal exponent of the last digit
+ * @return The number of digits generated
+ */
+static int fast_format_grisu2(uint64_t bits, char *digits, int *k) {
+	fast_format_fp_t v, w, minus, plus, power;
+	int biasedExponent = (int) ((bits & FAST_FORMAT_EXPONENT_MASK)
+			>> FAST_FORMAT_SIGNIFICAND_SIZE);
+
+	if (biasedExponent != 0) {
+		v.f = (bits & FAST_FORMAT_SIGNIFICAND_MASK) + FAST_FORMAT_HIDDEN_BIT;
+		v.e = biasedExponent - FAST_FORMAT_EXPONENT_BIAS;
+	} else {
+		// Subnormal value
+		v.f = bits & FAST_FORMAT_SIGNIFICAND_MASK;
+		v.e = 1 - FAST_FORMAT_EXPONENT_BIAS;
+	}
+
+	fast_format_getBoundaries(v, &minus, &plus);
+	power = fast_format_getCachedPower(plus.e, k);
+	w = fast_format_multiply(fast_format_normalize(v), power);
+	plus = fast_format_multiply(plus, power);
+	minus = fast_format_multiply(minus, power);
+
+	// Shrink the interval to compensate for the rounding errors
+	plus.f--;
+	minus.f++;
+	return fast_format_generateDigits(w, plus, plus.f - minus.f, digits, k);
+}
+
+/**
+ * @brief Writes the digits in plain or exponential notation
+ * @param buffer The buffer receiving the number
+ * @param digits The significant digits
+ * @param length The number of digits
+ * @param k The decimal exponent of the last digit
+ * @return The position after the last character written
+ */
+static char * fast_format_prettify(char *buffer, const char *digits,
+		int length, int k) {
+	// The position of the decimal point relative to the first digit
+	const int point = length + k;
+
+	if (length <= point && point <= FAST_FORMAT_MAX_PLAIN_DIGITS) {
+		// Integer, e.g. 1200
+		memcpy(buffer, digits, length);
+		memset(buffer + length, '0', point - length);
+		return buffer + point;
+	} else if (0 < point && point <= FAST_FORMAT_MAX_PLAIN_DIGITS) {
+		// Decimal point within the digits, e.g. 12.34
+		memcpy(buffer, digits, point);
+		buffer[point] = '.';
+		memcpy(buffer + point + 1, digits + point, length - point);
+		return buffer + length + 1;
+	} else if (-FAST_FORMAT_MAX_LEADING_ZEROS <= point && point <= 0) {
+		// Leading zeros, e.g. 0.001234
+		buffer[0] = '0';
+		buffer[1] = '.';
+		memset(buffer + 2, '0', -point);
+		memcpy(buffer + 2 - point, digits, length);
+		return buffer + 2 - point + length;
+	}
+
+	// Exponential notation, e.g. 1.234e-07
+	*buffer++ = digits[0];
+	if (length > 1) {
+		*buffer++ = '.';
+		memcpy(buffer, digits + 1, length - 1);
+		buffer += length - 1;
+	}
+	return fast_format_exponent(buffer, point - 1);
+}
+
+/**
+ * @brief Writes the exponent of the exponential notation
+ * @details The exponent is signed and has at least two digits.
+ * @param buffer The buffer receiving the exponent
+ * @param exponent The decimal exponent
+ * @return The position after the last character written
+ */
+static inline char * fast_format_exponent(char *buffer, int exponent) {
+	*buffer++ = 'e';
+	if (exponent < 0) {
+		*buffer++ = '-';
+		exponent = -exponent;
+	} else {
+		*buffer++ = '+';
+	}
+
+	if (exponent >= 100) {
+		*buffer++ = (char) ('0' + exponent / 100);
+		exponent %= 100;
+	}
+	*buffer++ = fast_format_digitPairs[exponent * 2];
+	*buffer++ = fast_format_digitPairs[exponent * 2 + 1];
+	return buffer;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file fast-format.h
+ * @brief Locale-independent formatting of numbers into a caller's buffer
+ * @details The functions write the textual representation of a number
+ * straight into the given buffer without allocating memory and without
+ * terminating the string. Doubles are printed by the Grisu2 algorithm, which
+ * produces the shortest or a nearly shortest digit string that reads back
+ * to exactly the same double. Hence, 21.5 is printed as "21.5". Small
+ * magnitudes are printed in plain decimal notation, large and tiny ones in
+ * exponential notation, e.g. "1.5e+20". Decimal fixed-point numbers are
+ * printed exactly with a fixed number of fractional digits. The decimal
+ * separator is always '.'.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FAST_FORMAT_H_
+#define FAST_FORMAT_H_
+
+#include <stdint.h>
+
+/** @brief The maximum number of characters written for a double */
+#define FAST_FORMAT_DOUBLE_SIZE 24
+/** @brief The maximum number of characters written for a 64-bit integer */
+#define FAST_FORMAT_LONG_SIZE 20
+/** @brief The maximum absolute exponent of a fixed-point number */
+#define FAST_FORMAT_MAX_FIXED_EXPONENT 9
+/** @brief The maximum number of characters written for a fixed-point number */
+#define FAST_FORMAT_FIXED_SIZE 20
+
+/**
+ * @brief Formats the given double
+ * @details Non-finite values are printed as "nan", "inf" and "-inf".
+ * @param buffer The buffer receiving at most FAST_FORMAT_DOUBLE_SIZE
+ * characters
+ * @param value The value to format
+ * @return The position after the last character written
+ */
+char * fast_format_double(char *buffer, double value);
+
+/**
+ * @brief Formats the given signed integer
+ * @param buffer The buffer receiving at most FAST_FORMAT_LONG_SIZE characters
+ * @param value The value to format
+ * @return The position after the last character written
+ */
+char * fast_format_long(char *buffer, int64_t value);
+
+/**
+ * @brief Formats the given decimal fixed-point number
+ * @details The number is printed in plain notation with exactly -exponent
+ * fractional digits, e.g. 215 and -1 as "21.5", 5 and -2 as "0.05" and 3 and 2
+ * as "300". No floating-point arithmetic is involved.
+ * @param buffer The buffer receiving at most FAST_FORMAT_FIXED_SIZE characters
+ * @param mantissa The signed integer multiple of the step
+ * @param exponent The decimal exponent of the step, its absolute value is at
+ * most FAST_FORMAT_MAX_FIXED_EXPONENT
+ * @return The position after the last character written
+ */
+char * fast_format_fixed(char *buffer, int32_t mantissa, int exponent);
+
+#endif /* FAST_FORMAT_H_ */
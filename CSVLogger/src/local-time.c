@@ -0,0 +1,79 @@
+/**
+ * @file local-time.c
+ * @brief Implements the conversion to local time
+ * @details The calendar fields of the window's first second are kept. A second
+ * within the window is printed by adding its offset to the seconds field.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "local-time.h"
+
+#include <logging-adapter.h>
+#include <assert.h>
+
+/** @brief The number of seconds of a regular minute */
+#define LOCAL_TIME_SECONDS_PER_MINUTE 60
+
+/** @brief The calendar fields of the window's first second */
+static struct tm local_time_window;
+
+common_type_error_t local_time_convert(time_t seconds, time_t *windowStart,
+		unsigned int *windowLength) {
+	struct tm brokentime, lastSecond;
+	time_t last;
+
+	assert(windowStart != NULL);
+	assert(windowLength != NULL);
+
+	if (localtime_r(&seconds, &brokentime) != &brokentime) {
+		logging_adapter_debug("Can't convert to local time");
+		return COMMON_TYPE_ERR;
+	}
+
+	last = seconds - brokentime.tm_sec + (LOCAL_TIME_SECONDS_PER_MINUTE - 1);
+	if (brokentime.tm_sec < LOCAL_TIME_SECONDS_PER_MINUTE
+			&& localtime_r(&last, &lastSecond) == &lastSecond
+			&& lastSecond.tm_sec == LOCAL_TIME_SECONDS_PER_MINUTE - 1
+			&& lastSecond.tm_min == brokentime.tm_min
+			&& lastSecond.tm_hour == brokentime.tm_hour
+			&& lastSecond.tm_mday == brokentime.tm_mday
+			&& lastSecond.tm_isdst == brokentime.tm_isdst) {
+		*windowStart = seconds - brokentime.tm_sec;
+		*windowLength = LOCAL_TIME_SECONDS_PER_MINUTE;
+		brokentime.tm_sec = 0;
+	} else {
+		*windowStart = seconds;
+		*windowLength = 1;
+	}
+	local_time_window = brokentime;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+size_t local_time_format(char *buffer, size_t size, const char *format,
+		unsigned int second) {
+	struct tm brokentime;
+
+	assert(buffer != NULL);
+	assert(format != NULL);
+
+	brokentime = local_time_window;
+	brokentime.tm_sec += second;
+	return strftime(buffer, size, format, &brokentime);
+}
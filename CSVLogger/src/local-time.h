@@ -0,0 +1,62 @@
+/**
+ * @file local-time.h
+ * @brief Converts time-stamps to local time and prints them
+ * @details The module keeps the calendar fields of a single window of
+ * seconds, usually a whole minute. Within the window, any second can be
+ * printed without converting the time again. The module is compiled without
+ * packed structures since the C library reads and writes struct tm in its
+ * natural layout. Hence, struct tm must not be part of the interface. The
+ * functions aren't thread-safe and are meant to be called by a single thread.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef LOCAL_TIME_H_
+#define LOCAL_TIME_H_
+
+#include <common-type.h>
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * @brief Converts the given second and keeps the calendar fields of its window
+ * @details The window normally spans the whole minute, since time zones change
+ * their offset on whole minutes only. If the offset changes within the minute,
+ * or the second is a leap second, the window is reduced to the given second.
+ * @param seconds The seconds since the epoch to convert
+ * @param windowStart Receives the first second of the window
+ * @param windowLength Receives the number of seconds within the window
+ * @return The status of the operation
+ */
+common_type_error_t local_time_convert(time_t seconds, time_t *windowStart,
+		unsigned int *windowLength);
+
+/**
+ * @brief Prints a second of the window converted last
+ * @details local_time_convert has to be called successfully before.
+ * @param buffer The buffer receiving the time-stamp and the terminating '\0'
+ * @param size The size of the buffer in bytes
+ * @param format The strftime format to use
+ * @param second The offset of the second to print from the window's start,
+ * less than the window's length
+ * @return The length of the time-stamp or zero if it doesn't fit
+ */
+size_t local_time_format(char *buffer, size_t size, const char *format,
+		unsigned int second);
+
+#endif /* LOCAL_TIME_H_ */
@@ -3,7 +3,9 @@
  * @brief Parses the configuration file and generates the logging output
  * @details First it parses the program arguments and loads the main
  * configuration. After loading the configuration it instantiates needed modules
- * and conducts fetching the data. Afterwards the output will be written.
+ * and conducts fetching the data. Afterwards the output will be written. In
+ * daemon mode fetching and writing the data is repeated periodically until the
+ * program is terminated.
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -23,17 +25,28 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include "control.h"
+#include "csv-writer.h"
 #include "pluggable-fieldbus-manager.h"
+#include "reactor.h"
+#include "scheduler.h"
+#include "timer-wheel.h"
 #include <logging-adapter.h>
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <libconfig.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <time.h>
 
 #ifndef DEF_CONFIG
@@ -62,33 +75,84 @@
 #define MAIN_CONFIG_CSV_SEP "fieldDelimiter"
 #define MAIN_CONFIG_TIME_FORMAT "timeFormat"
 #define MAIN_CONFIG_TIME_HEADER "timeHeader"
+#define MAIN_CONFIG_TIME_MODE "timeMode"
+#define MAIN_CONFIG_INTERVAL "interval"
+#define MAIN_CONFIG_CONTROL_SOCKET "controlSocket"
+#define MAIN_CONFIG_WRITE_QUEUE "writeQueueLength"
+#define MAIN_CONFIG_QUEUE_POLICY "queuePolicy"
+#define MAIN_CONFIG_SPOOL_FILE "spoolFile"
+#define MAIN_CONFIG_SCALE "scale"
+#define MAIN_CONFIG_PRECISION "precision"
 
 /** @brief The default column separator used within the CSV file */
 #define MAIN_CSV_SEP ";"
-/** @brief The newline sequence used within the CSV file */
-#define MAIN_CSV_NEWLINE "\n"
-/** @brief The error sequence used if a value can't be obtained */
-#define MAIN_CSV_ERR "NaN"
-
-/** @brief The size of the buffer used to store time stamps */
-#define MAIN_TIMESTAMP_BUFFER_SIZE 40
-
-/** @brief List entry used to form the list of channels to query */
+/** @brief The default format of the time-stamp column */
+#define MAIN_TIME_FORMAT "%Y-%m-%d %H:%M:%S"
+/** @brief The default title of the time-stamp column */
+#define MAIN_TIME_HEADER "Current Time/Date"
+/** @brief The default number of rows queued for the writer thread */
+#define MAIN_DEF_WRITE_QUEUE 64
+
+/** @brief The names of the writer's queue policies indexed by the policy */
+static const char * const main_queuePolicies[] = {
+	[CSV_WRITER_POLICY_BLOCK] = "block",
+	[CSV_WRITER_POLICY_DROP_OLDEST] = "drop-oldest",
+	[CSV_WRITER_POLICY_SPILL] = "spill"
+};
+
+/** @brief The names of the time-stamp column's modes indexed by the mode */
+static const char * const main_timeModes[] = {
+	[CSV_WRITER_TIME_LOCAL] = "local",
+	[CSV_WRITER_TIME_EPOCH] = "epoch",
+	[CSV_WRITER_TIME_EPOCH_MS] = "epoch-ms"
+};
+
+/** @brief The default sampling interval in seconds used in daemon mode */
+#define MAIN_DEF_INTERVAL (60.0)
+
+/** @brief The number of slots of the timer wheel triggering channel samples */
+#define MAIN_TIMER_WHEEL_SLOTS 256
+
+/** @brief The timing of a channel sampled in daemon mode */
 typedef struct {
-	/** @brief The identifier given by the network stack */
-	int channelID;
 	/**
-	 * @brief The title describing the channel.
-	 * @details The reference points to a location inside the configuration
-	 * structure. No manual deallocation of the used memory is needed.
+	 * @brief The channel's sampling interval in seconds
+	 * @details Zero denotes that the channel is sampled on every tick.
 	 */
-	const char* title;
-} main_channels_t;
-
-/** @brief The list of channels to query */
-static main_channels_t *main_channelVector;
+	double interval;
+	/** @brief The channel's sampling interval in scheduler ticks */
+	uint64_t intervalTicks;
+	/** @brief The timer triggering the channel within the timer wheel */
+	timer_wheel_timer_t timer;
+} main_schedule_t;
+
+/*
+ * The vectors sampling the channels extend the network stack's channel table.
+ * They are indexed by the channel's identifier, which is the channel's
+ * position after the network stack ordered its channels by module. The
+ * vectors handed to the writer are indexed by the channel's column instead.
+ */
+/** @brief The copies of the titles describing the channels, by column */
+static char **main_channelTitles;
+/** @brief The encoding of every channel applied by the writer, by column */
+static csv_writer_encoding_t *main_channelEncodings;
+/** @brief The column of every channel */
+static unsigned int *main_channelColumns;
+/** @brief The flags indicating that a channel is sampled in the current cycle */
+static unsigned char *main_channelDue;
+/** @brief The timing of every channel */
+static main_schedule_t *main_channelSchedules;
 /** @brief The number of channels to query */
 static int main_channelVectorLength;
+/** @brief Buffer holding the identifiers of channels due in the current cycle*/
+static int *main_dueIDs;
+/** @brief Buffer holding the values fetched from the due channels */
+static common_type_t *main_dueResults;
+
+/** @brief The timer wheel deciding which channels are due in daemon mode */
+static timer_wheel_t main_timerWheel;
+/** @brief The index of the last tick processed or -1 before the first tick */
+static int64_t main_lastTickIndex = -1;
 
 /**
  * @brief The parsed program options
@@ -100,17 +164,25 @@ struct {
 	unsigned int configNameSet :1;
 	/** @brief Flag indicating that the help switch was given */
 	unsigned int help :1;
+	/** @brief Flag indicating that the program keeps sampling until terminated*/
+	unsigned int daemon :1;
 	/** @brief The name of the configuration file */
 	char* configName;
 	/** @brief The program's name */
 	char* progname;
 } main_progOpt = { .configName = DEF_CONFIG, .progname = "log2csv" };
 
-/** @brief The global configuration */
+/** @brief The global configuration, which is freed after startup */
 config_t main_config;
+/** @brief Flag indicating that main_config holds a configuration */
+static int main_configValid = 0;
 
-/** @brief The file handler of the stream writing the CSV file */
-FILE* main_csvOut = NULL;
+/** @brief The reactor source of the timer triggering the samples */
+static reactor_source_t main_timerSource = { .fd = -1 };
+/** @brief The reactor source receiving the signals handled by the daemon */
+static reactor_source_t main_signalSource = { .fd = -1 };
+/** @brief The set of signals handled by the daemon loop */
+static sigset_t main_signalMask;
 
 /* Function prototypes */
 static void main_bailOut(const int err, const char* formatString, ...);
@@ -118,14 +190,36 @@ static void main_parseProgOpts(int argc, char** argv);
 static void main_printHelp(void);
 static void main_freeResources(void);
 static inline void main_initConfig(void);
+static inline void main_releaseConfig(void);
 static inline void main_initNetwork(void);
 static inline void main_initOutputFile(void);
 static inline void main_addChannel(unsigned int index, config_setting_t *config);
-static void main_writeCSVHeader(void);
-static void main_processSamples(void);
-static void main_appendString(FILE* file, const char* str);
-static void main_appendResult(FILE *file, const common_type_t *result);
-static void main_appendTimestamp(FILE *file, struct timeval *tv);
+static inline void main_orderChannels(void);
+static void main_logChannelStatistics(void);
+static inline void main_initEncoding(csv_writer_encoding_t *encoding,
+		const char *title, config_setting_t *config);
+static inline void main_initDaemon(void);
+static void main_runDaemon(void);
+static inline void main_initScheduler(void);
+static inline void main_initChannelTimers(int64_t baseInterval);
+static void main_updateDueChannels(int64_t tickIndex);
+static inline void main_blockSignals(void);
+static inline void main_initSignals(void);
+static void main_handleSignals(reactor_source_t *source, uint32_t events);
+static inline void main_initTimer(void);
+static void main_armTimer(void);
+static void main_handleTimer(reactor_source_t *source, uint32_t events);
+static common_type_error_t main_waitForWriter(void);
+static inline void main_initControl(void);
+static void main_controlStatus(char *reply, size_t size);
+static inline double main_getFormatRate(const csv_writer_statistics_t *stats);
+static inline double main_getRowsPerWrite(
+		const csv_writer_statistics_t *stats);
+static void main_controlReopen(char *reply, size_t size);
+static void main_controlQuit(char *reply, size_t size);
+static void main_reopenOutputFile(void);
+static void main_finishOutputFile(void);
+static void main_processSamples(const struct timeval *timestamp);
 
 /**
  * @brief Main program entry point
@@ -154,87 +248,538 @@ int main(int argc, char** argv) {
 		exit(EXIT_SUCCESS);
 	}
 	main_initConfig();
+	if (main_progOpt.daemon) {
+		main_blockSignals();
+	}
 	main_initNetwork();
 	main_initOutputFile();
+	if (main_progOpt.daemon) {
+		main_initDaemon();
+	}
+	main_releaseConfig();
 
-	main_processSamples();
+	if (main_progOpt.daemon) {
+		main_runDaemon();
+	} else {
+		main_processSamples(NULL);
+	}
 
+	main_finishOutputFile();
 	logging_adapter_info("Successfully finished");
 	main_freeResources();
 	return EXIT_SUCCESS;
 }
 
 /**
- * @brief Opens the output file and eventually writes the first line
- * @details The function assumes that the configuration was previously
- * initialized and that the channelVector is fully populated. It will bail out
- * if an error occurs.
+ * @brief Sets up the reactor driving the daemon
+ * @details The network stack and the output file have to be initialized
+ * before. The reactor multiplexes the timer triggering the samples, the
+ * signals received and the optional control socket. The function bails out if
+ * something goes wrong.
  */
-static inline void main_initOutputFile() {
-	const char* filename;
-	int writeHeader;
+static inline void main_initDaemon(void) {
+	if (reactor_init() != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't initialize the event loop");
+	}
+	main_initSignals();
+	main_initScheduler();
+	main_initTimer();
+	main_initControl();
+}
 
-	if (!config_lookup_string(&main_config, MAIN_CONFIG_OUT_FILE, &filename)) {
-		main_bailOut(EXIT_ERR_CONFIG, "Can't fine the \"%s\" string configuration "
-				"directive.", MAIN_CONFIG_OUT_FILE);
+/**
+ * @brief Samples every configured channel periodically until the program is
+ * terminated
+ * @details The daemon has to be set up by main_initDaemon before. The samples
+ * are taken on wall-clock aligned ticks of the configured interval and the
+ * time-stamp of each row is the tick's time. If a sample took longer than an
+ * interval, the ticks missed are skipped. The function returns after receiving
+ * SIGTERM, SIGINT or the quit command and bails out if the reactor or the
+ * scheduler fails.
+ */
+static void main_runDaemon(void) {
+	const scheduler_statistics_t *stats;
+
+	if (reactor_run() != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't wait for the next event");
 	}
 
-	writeHeader = access(filename, F_OK);
-	errno = 0;
+	stats = scheduler_getStatistics();
+	logging_adapter_info("Received termination request after %llu sample(s), "
+			"%llu missed", (unsigned long long) stats->ticks,
+			(unsigned long long) stats->missedTicks);
+	if (stats->ticks > 1) {
+		logging_adapter_info("Minimal time left between a sample and the next "
+				"tick: %.3f ms", stats->minSlack / 1000000.0);
+	}
+}
 
-	main_csvOut = fopen(filename, "a");
-	if (main_csvOut == NULL ) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't open the file \"%s\" to append data",
-				filename);
+/**
+ * @brief Creates the timer triggering the samples and arms it for the first
+ * tick
+ * @details The timer measures the wall-clock and is cancelled if the
+ * wall-clock is set, so the schedule is recalculated. The function bails out
+ * on error.
+ */
+static inline void main_initTimer(void) {
+	main_timerSource.fd = timerfd_create(CLOCK_REALTIME,
+			TFD_NONBLOCK | TFD_CLOEXEC);
+	if (main_timerSource.fd < 0) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't create the sampling timer");
+	}
+	main_timerSource.handler = main_handleTimer;
+	if (reactor_add(&main_timerSource, EPOLLIN) != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't watch the sampling timer");
 	}
 
-	if (writeHeader) {
-		logging_adapter_debug("File \"%s\" doens't exist. Try to create it and "
-				"write a headline", filename);
-		main_writeCSVHeader();
+	main_armTimer();
+}
+
+/**
+ * @brief Arms the timer to expire on the next tick of the scheduler
+ * @details The function bails out on error.
+ */
+static void main_armTimer(void) {
+	struct itimerspec timeout;
+
+	memset(&timeout, 0, sizeof(timeout));
+	if (scheduler_next(&timeout.it_value) != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't calculate the next sample");
 	}
 
+	if (timerfd_settime(main_timerSource.fd,
+			TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &timeout, NULL) != 0) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't arm the sampling timer");
+	}
 }
 
 /**
- * @brief Writes the CSV header to the previously opened csvOut file.
- * @details <p>It assumes that the csvOut file as well as the configuration are
- * initialized and that the channelVector is fully populated. The function will
- * bail out if an error occurs.</p>
- * <p>The first column will be the time stamp header. The field is taken from
- * the configuration. If no configuration setting is present a default value
- * will be used.</p>
+ * @brief Takes a sample if the timer expired and arms it for the next tick
+ * @details If the wall-clock was set, the timer is just armed again for the
+ * recalculated tick.
+ * @param source The timer's source
+ * @param events The events received
  */
-static void main_writeCSVHeader() {
-	unsigned int i;
-	const char* timeHeader = "Current Time/Date";
-    const char* csvSeparator = MAIN_CSV_SEP;
+static void main_handleTimer(reactor_source_t *source, uint32_t events) {
+	struct timespec tick;
+	struct timeval timestamp;
+	uint64_t expirations;
+	common_type_error_t err;
 
-	assert(main_csvOut != NULL);
+	(void) events;
 
-	(void) config_lookup_string(&main_config, MAIN_CONFIG_TIME_HEADER,
-			&timeHeader);
-    (void) config_lookup_string(&main_config, MAIN_CONFIG_CSV_SEP, 
-            &csvSeparator);
+	if (read(source->fd, &expirations, sizeof(expirations)) < 0) {
+		if (errno == ECANCELED) {
+			logging_adapter_debug("The wall-clock was set, rearm the timer");
+			main_armTimer();
+		} else if (errno != EAGAIN && errno != EINTR) {
+			main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't read the sampling timer");
+		}
+		return;
+	}
+
+	err = scheduler_reached(&tick);
+	if (err == COMMON_TYPE_SUCCESS) {
+		timestamp.tv_sec = tick.tv_sec;
+		timestamp.tv_usec = tick.tv_nsec / 1000;
+		main_updateDueChannels(scheduler_getTickIndex(&tick));
+		main_processSamples(&timestamp);
+	} else if (err != COMMON_TYPE_ERR) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't wait for the next sample");
+	}
+
+	main_armTimer();
+}
+
+/**
+ * @brief Serves the signals and control commands while the sampling timer's
+ * handler waits for the CSV writer
+ * @return COMMON_TYPE_SUCCESS to keep waiting, an error code if the daemon
+ * has to stop
+ */
+static common_type_error_t main_waitForWriter(void) {
+	common_type_error_t err;
+
+	err = reactor_poll(&main_timerSource);
+	if (err != COMMON_TYPE_SUCCESS && err != COMMON_TYPE_ERR) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't serve the events while waiting");
+	}
+	return err;
+}
 
-	main_appendString(main_csvOut, timeHeader);
-	if (fprintf(main_csvOut, "%s", csvSeparator) < 0) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
+/**
+ * @brief Initializes the scheduler triggering the samples
+ * @details The interval is taken from the configuration. If it is not set, a
+ * default interval will be used. The function bails out on any error.
+ */
+static inline void main_initScheduler(void) {
+	double interval = MAIN_DEF_INTERVAL;
+	int64_t baseInterval;
+	int intInterval;
+
+	if (config_lookup_int(&main_config, MAIN_CONFIG_INTERVAL, &intInterval)) {
+		interval = intInterval;
+	} else {
+		(void) config_lookup_float(&main_config, MAIN_CONFIG_INTERVAL, &interval);
+	}
+	if (!(interval >= 0.001)) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" directive has to be at least "
+				"one millisecond", MAIN_CONFIG_INTERVAL);
+	}
+
+	baseInterval = (int64_t) (interval * 1000000000.0 + 0.5);
+	if (scheduler_init(baseInterval) != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't initialize the scheduler");
+	}
+
+	logging_adapter_debug("Sampling every %.3f seconds", interval);
+
+	main_initChannelTimers(baseInterval);
+}
+
+/**
+ * @brief Converts the channel's sampling intervals to scheduler ticks
+ * @details Each channel interval has to be a multiple of the scheduler's
+ * interval. Channels not setting an interval are sampled on every tick. The
+ * function initializes the timer wheel but the timers are added on the first
+ * tick. It bails out on error.
+ * @param baseInterval The scheduler's interval in nanoseconds
+ */
+static inline void main_initChannelTimers(int64_t baseInterval) {
+	unsigned int i;
+	int64_t channelInterval;
+	main_schedule_t *schedule;
+
+	assert(baseInterval > 0);
+
+	if (timer_wheel_init(&main_timerWheel, MAIN_TIMER_WHEEL_SLOTS)
+			!= COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_FAILURE, "Not enough memory available");
 	}
 
 	for (i = 0; i < main_channelVectorLength; i++) {
+		schedule = &main_channelSchedules[i];
+		channelInterval = (int64_t) (schedule->interval * 1000000000.0 + 0.5);
+		if (channelInterval % baseInterval != 0) {
+			main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" of channel \"%s\" isn't a "
+					"multiple of the global \"%s\"", MAIN_CONFIG_INTERVAL,
+					main_channelTitles[main_channelColumns[i]], MAIN_CONFIG_INTERVAL);
+		}
+		schedule->intervalTicks = channelInterval / baseInterval;
+		schedule->timer.data = schedule;
+	}
+}
 
-		main_appendString(main_csvOut, main_channelVector[i].title);
+/**
+ * @brief Marks the channels to sample on the given tick
+ * @details Every channel is sampled on the first tick. Afterwards the timer
+ * wheel is advanced by the number of ticks passed and decides which channels
+ * are due. The timers are aligned to the tick index such that channels are
+ * sampled on wall-clock aligned multiples of their interval. If the tick index
+ * isn't increasing, e.g. after the wall-clock was set back, a single tick is
+ * assumed to be passed.
+ * @param tickIndex The index of the current tick
+ */
+static void main_updateDueChannels(int64_t tickIndex) {
+	unsigned int i;
+	main_schedule_t *schedule;
+	timer_wheel_timer_t *timer;
+	uint64_t ticks;
+
+	if (main_lastTickIndex < 0) {
+		for (i = 0; i < main_channelVectorLength; i++) {
+			schedule = &main_channelSchedules[i];
+			main_channelDue[i] = 1;
+			if (schedule->intervalTicks > 1) {
+				timer_wheel_add(&main_timerWheel, &schedule->timer,
+						schedule->intervalTicks, schedule->intervalTicks
+								- ((uint64_t) tickIndex) % schedule->intervalTicks);
+			}
+		}
+	} else {
+		for (i = 0; i < main_channelVectorLength; i++) {
+			main_channelDue[i] = main_channelSchedules[i].intervalTicks <= 1;
+		}
 
-		if (i + 1 != main_channelVectorLength) {
-        	if (fprintf(main_csvOut, "%s", csvSeparator) < 0) {
-        		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
-        	}
+		ticks = tickIndex > main_lastTickIndex ? tickIndex - main_lastTickIndex : 1;
+		timer = timer_wheel_advance(&main_timerWheel, ticks);
+		for (; timer != NULL; timer = timer->nextExpired) {
+			main_channelDue[(main_schedule_t *) timer->data
+					- main_channelSchedules] = 1;
 		}
 	}
 
-   	if (fprintf(main_csvOut, "%s", MAIN_CSV_NEWLINE) < 0) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
+	main_lastTickIndex = tickIndex;
+}
+
+/**
+ * @brief Blocks the signals handled by the daemon loop
+ * @details The function has to be called before any thread is created, so
+ * every thread inherits the mask and the signals are received by the daemon
+ * loop only. It bails out on error.
+ */
+static inline void main_blockSignals(void) {
+	sigemptyset(&main_signalMask);
+	sigaddset(&main_signalMask, SIGTERM);
+	sigaddset(&main_signalMask, SIGINT);
+	sigaddset(&main_signalMask, SIGHUP);
+
+	if (pthread_sigmask(SIG_BLOCK, &main_signalMask, NULL) != 0) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't block the signals handled");
+	}
+}
+
+/**
+ * @brief Registers the signals blocked before at the reactor
+ * @details SIGTERM and SIGINT terminate the daemon loop, SIGHUP reopens the
+ * output file, e.g. after it was rotated. The function bails out on error.
+ */
+static inline void main_initSignals(void) {
+	main_signalSource.fd = signalfd(-1, &main_signalMask,
+			SFD_NONBLOCK | SFD_CLOEXEC);
+	if (main_signalSource.fd < 0) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't receive the signals handled");
+	}
+	main_signalSource.handler = main_handleSignals;
+	if (reactor_add(&main_signalSource, EPOLLIN) != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't watch the signals handled");
+	}
+}
+
+/**
+ * @brief Processes every signal pending
+ * @param source The signal's source
+ * @param events The events received
+ */
+static void main_handleSignals(reactor_source_t *source, uint32_t events) {
+	struct signalfd_siginfo info;
+
+	(void) events;
+
+	while (read(source->fd, &info, sizeof(info)) == sizeof(info)) {
+		if (info.ssi_signo == SIGHUP) {
+			logging_adapter_info("Received SIGHUP, reopen the output file");
+			main_reopenOutputFile();
+		} else {
+			reactor_stop();
+		}
+	}
+}
+
+/**
+ * @brief Opens the control socket if it is configured
+ * @details The function bails out on error.
+ */
+static inline void main_initControl(void) {
+	static const control_command_t commands[] = {
+			{ .name = "status", .handler = main_controlStatus },
+			{ .name = "reopen", .handler = main_controlReopen },
+			{ .name = "quit", .handler = main_controlQuit } };
+	const char *path;
+
+	if (!config_lookup_string(&main_config, MAIN_CONFIG_CONTROL_SOCKET, &path))
+		return;
+
+	if (control_init(path, commands, sizeof(commands) / sizeof(commands[0]))
+			!= COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't open the control socket");
+	}
+}
+
+/**
+ * @brief Control command reporting the scheduler's statistics
+ * @param reply The buffer receiving the reply
+ * @param size The size of the buffer
+ */
+static void main_controlStatus(char *reply, size_t size) {
+	const scheduler_statistics_t *stats = scheduler_getStatistics();
+	csv_writer_statistics_t writerStats;
+
+	csv_writer_getStatistics(&writerStats);
+	(void) snprintf(reply, size, "OK samples=%llu missed=%llu channels=%d "
+			"queued=%u/%u maxQueued=%u dropped=%llu blocked=%llu spilled=%llu "
+			"spooledBytes=%llu sinkFailures=%llu sink=%s formatRate=%.0f "
+			"rowsPerWrite=%.1f",
+			(unsigned long long) stats->ticks,
+			(unsigned long long) stats->missedTicks, main_channelVectorLength,
+			writerStats.occupancy, writerStats.capacity, writerStats.maxOccupancy,
+			(unsigned long long) writerStats.droppedRows,
+			(unsigned long long) writerStats.blockedRows,
+			(unsigned long long) writerStats.spilledRows,
+			(unsigned long long) writerStats.spooledBytes,
+			(unsigned long long) writerStats.sinkFailures,
+			writerStats.sinkFailed ? "failed" : "ok",
+			main_getFormatRate(&writerStats), main_getRowsPerWrite(&writerStats));
+}
+
+/**
+ * @brief Calculates the number of rows the writer formats per second
+ * @param stats The writer's statistics
+ * @return The number of rows per second or 0.0 if no row was formatted
+ */
+static inline double main_getFormatRate(const csv_writer_statistics_t *stats) {
+	if (stats->formatNanos == 0)
+		return 0.0;
+	return stats->formattedRows * 1000000000.0 / stats->formatNanos;
+}
+
+/**
+ * @brief Calculates the average number of rows delivered by a single write
+ * @param stats The writer's statistics
+ * @return The average number of rows or 0.0 if nothing was written
+ */
+static inline double main_getRowsPerWrite(const csv_writer_statistics_t *stats) {
+	if (stats->batches == 0)
+		return 0.0;
+	return (double) stats->formattedRows / stats->batches;
+}
+
+/**
+ * @brief Control command reopening the output file
+ * @param reply The buffer receiving the reply
+ * @param size The size of the buffer
+ */
+static void main_controlReopen(char *reply, size_t size) {
+	main_reopenOutputFile();
+	(void) snprintf(reply, size, "OK");
+}
+
+/**
+ * @brief Control command terminating the daemon loop
+ * @param reply The buffer receiving the reply
+ * @param size The size of the buffer
+ */
+static void main_controlQuit(char *reply, size_t size) {
+	reactor_stop();
+	(void) snprintf(reply, size, "OK");
+}
+
+/**
+ * @brief Requests the writer thread to close the output file and open it again
+ * @details If the file doesn't exist anymore, it is created including the
+ * headline. If it can't be opened, the writer retries periodically.
+ */
+static void main_reopenOutputFile(void) {
+	csv_writer_reopen();
+}
+
+/**
+ * @brief Waits until every row is written and stops the writer thread
+ * @details The writer's statistics are logged. The function bails out if
+ * rows were lost because the CSV file still fails.
+ */
+static void main_finishOutputFile(void) {
+	csv_writer_statistics_t stats;
+	common_type_error_t err;
+	int errorNumber;
+
+	err = csv_writer_free();
+	errorNumber = errno;
+	csv_writer_getStatistics(&stats);
+
+	logging_adapter_info("Committed %llu row(s), %llu dropped, %llu blocked, "
+			"at most %u of %u row(s) queued", (unsigned long long) stats.rows,
+			(unsigned long long) stats.droppedRows,
+			(unsigned long long) stats.blockedRows, stats.maxOccupancy,
+			stats.capacity);
+	if (stats.formattedRows > 0) {
+		logging_adapter_debug("Formatted %llu row(s) at %.0f row(s) per second, "
+				"%.1f row(s) per write", (unsigned long long) stats.formattedRows,
+				main_getFormatRate(&stats), main_getRowsPerWrite(&stats));
+	}
+	if (stats.sinkFailures > 0 || stats.spilledRows > 0) {
+		logging_adapter_info("Writing the CSV file failed %llu time(s), %llu "
+				"row(s) spilled", (unsigned long long) stats.sinkFailures,
+				(unsigned long long) stats.spilledRows);
+	}
+	if (stats.truncatedStrings > 0) {
+		logging_adapter_info("Truncated %llu string(s) exceeding a row's arena",
+				(unsigned long long) stats.truncatedStrings);
+	}
+
+	if (err != COMMON_TYPE_SUCCESS) {
+		// Report the failure of the CSV file rather than the last call's errno
+		errno = errorNumber;
+		main_bailOut(EXIT_ERR_OUTFILE, "Can't write every row to the CSV file");
+	}
+}
+
+/**
+ * @brief Starts the writer thread appending the rows to the output file
+ * @details The function assumes that the configuration was previously
+ * initialized and that the channelVector is fully populated. The writer opens
+ * the file and eventually writes the headline. The function will bail out if
+ * an error occurs.
+ */
+static inline void main_initOutputFile() {
+	csv_writer_config_t config;
+	const char *fileName, *timeFormat = MAIN_TIME_FORMAT;
+	const char *timeHeader = MAIN_TIME_HEADER, *separator = MAIN_CSV_SEP;
+	const char *policy = main_queuePolicies[CSV_WRITER_POLICY_DROP_OLDEST];
+	const char *spoolFileName = NULL;
+	const char *timeMode = main_timeModes[CSV_WRITER_TIME_LOCAL];
+	unsigned int i;
+	int queueLength = MAIN_DEF_WRITE_QUEUE;
+
+	memset(&config, 0, sizeof(config));
+	if (!config_lookup_string(&main_config, MAIN_CONFIG_OUT_FILE, &fileName)) {
+		main_bailOut(EXIT_ERR_CONFIG, "Can't fine the \"%s\" string configuration "
+				"directive.", MAIN_CONFIG_OUT_FILE);
+	}
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_TIME_FORMAT,
+			&timeFormat);
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_TIME_HEADER,
+			&timeHeader);
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_CSV_SEP, &separator);
+	config.fileName = fileName;
+	config.timeFormat = timeFormat;
+	config.timeHeader = timeHeader;
+	config.separator = separator;
+
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_TIME_MODE, &timeMode);
+	for (i = 0; i < sizeof(main_timeModes) / sizeof(main_timeModes[0])
+			&& strcmp(timeMode, main_timeModes[i]) != 0; i++)
+		;
+	if (i >= sizeof(main_timeModes) / sizeof(main_timeModes[0])) {
+		main_bailOut(EXIT_ERR_CONFIG, "Unknown \"%s\" value \"%s\"",
+				MAIN_CONFIG_TIME_MODE, timeMode);
+	}
+	config.timeMode = (csv_writer_time_mode_t) i;
+
+	(void) config_lookup_int(&main_config, MAIN_CONFIG_WRITE_QUEUE, &queueLength);
+	if (queueLength <= 0) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" directive has to be positive",
+				MAIN_CONFIG_WRITE_QUEUE);
+	}
+	config.queueLength = (unsigned int) queueLength;
+
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_QUEUE_POLICY, &policy);
+	for (i = 0; i < sizeof(main_queuePolicies) / sizeof(main_queuePolicies[0])
+			&& strcmp(policy, main_queuePolicies[i]) != 0; i++)
+		;
+	if (i >= sizeof(main_queuePolicies) / sizeof(main_queuePolicies[0])) {
+		main_bailOut(EXIT_ERR_CONFIG, "Unknown \"%s\" value \"%s\"",
+				MAIN_CONFIG_QUEUE_POLICY, policy);
+	}
+	config.policy = (csv_writer_policy_t) i;
+	(void) config_lookup_string(&main_config, MAIN_CONFIG_SPOOL_FILE,
+			&spoolFileName);
+	if (config.policy == CSV_WRITER_POLICY_SPILL && spoolFileName == NULL) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" policy requires the \"%s\" "
+				"directive", policy, MAIN_CONFIG_SPOOL_FILE);
+	}
+	config.spoolFileName = spoolFileName;
+	if (main_progOpt.daemon) {
+		config.waitHandler = main_waitForWriter;
+	}
+
+	config.titles = (const char * const *) main_channelTitles;
+	config.encodings = main_channelEncodings;
+	config.columnCount = main_channelVectorLength;
+
+	if (csv_writer_init(&config) != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_OUTFILE, "Can't start writing the file \"%s\"",
+				fileName);
 	}
 }
 
@@ -267,27 +812,40 @@ static inline void main_initNetwork() {
 	}
 	main_channelVectorLength = config_setting_length(channelConfig);
 	assert(main_channelVectorLength >= 0);
-	main_channelVector = malloc(
-			main_channelVectorLength * sizeof(main_channelVector[0]));
-	if (main_channelVector == NULL ) {
+	main_channelTitles = calloc(main_channelVectorLength,
+			sizeof(main_channelTitles[0]));
+	main_channelDue = calloc(main_channelVectorLength,
+			sizeof(main_channelDue[0]));
+	main_channelEncodings = calloc(main_channelVectorLength,
+			sizeof(main_channelEncodings[0]));
+	main_channelSchedules = calloc(main_channelVectorLength,
+			sizeof(main_channelSchedules[0]));
+	main_dueIDs = malloc(main_channelVectorLength * sizeof(main_dueIDs[0]));
+	main_dueResults = malloc(
+			main_channelVectorLength * sizeof(main_dueResults[0]));
+	if (main_channelTitles == NULL || main_channelDue == NULL
+			|| main_channelEncodings == NULL || main_channelSchedules == NULL
+			|| main_dueIDs == NULL || main_dueResults == NULL) {
 		main_bailOut(EXIT_FAILURE, "Not enough memory available");
 	}
 
 	for (i = 0; i < main_channelVectorLength; i++) {
 		main_addChannel(i, config_setting_get_elem(channelConfig, i));
 	}
-
+	main_orderChannels();
 }
 
 /**
  * @brief Adds the given channel and sets it within the list of configured
  * channels
  * @details The function will bail out if an error is detected.
- * @param index the index of the channel within the channelVector
+ * @param index the index of the channel within the channel vectors
  * @param config The configuration of the channel, not null
  */
 static inline void main_addChannel(unsigned int index, config_setting_t *config) {
 	const char* title = NULL;
+	double interval = 0.0;
+	int intInterval, channelID;
 
 	assert(config != NULL);
 	assert(index < main_channelVectorLength);
@@ -305,16 +863,100 @@ static inline void main_addChannel(unsigned int index, config_setting_t *config)
 	}
 	assert(title != NULL);
 
-	main_channelVector[index].title = title;
-	main_channelVector[index].channelID = pfm_addChannel(config);
+	if (config_setting_lookup_int(config, MAIN_CONFIG_INTERVAL, &intInterval)) {
+		interval = intInterval;
+	} else {
+		(void) config_setting_lookup_float(config, MAIN_CONFIG_INTERVAL, &interval);
+	}
+	if (!(interval >= 0.0)) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" of channel \"%s\" is "
+				"negative", MAIN_CONFIG_INTERVAL, title);
+	}
+
+	main_channelTitles[index] = malloc(strlen(title) + 1);
+	if (main_channelTitles[index] == NULL) {
+		main_bailOut(EXIT_FAILURE, "Not enough memory available");
+	}
+	strcpy(main_channelTitles[index], title);
+	main_channelSchedules[index].interval = interval;
+	main_channelDue[index] = 1;
+	main_initEncoding(&main_channelEncodings[index], title, config);
+	channelID = pfm_addChannel(config);
 
-	if (main_channelVector[index].channelID < 0) {
+	if (channelID < 0) {
 		main_bailOut(EXIT_ERR_NETWORK, "Can't register the channel within the "
 				"network stack.");
 	}
+	// Until the channels are ordered, the identifier is the column
+	assert(channelID == (int) index);
 	logging_adapter_debug("Channel \"%s\" successfully added", title);
 }
 
+/**
+ * @brief Orders the channels by the modules they depend on
+ * @details The network stack sorts its channel table once, so a sample walks
+ * the channels linearly. The vectors indexed by the channel's identifier are
+ * reordered accordingly and the column of each channel is kept. The function
+ * bails out on error.
+ */
+static inline void main_orderChannels(void) {
+	main_schedule_t *schedules;
+	unsigned int *columns;
+	unsigned int i;
+
+	columns = calloc(main_channelVectorLength, sizeof(columns[0]));
+	schedules = calloc(main_channelVectorLength, sizeof(schedules[0]));
+	if (columns == NULL || schedules == NULL
+			|| pfm_orderChannels(columns) != COMMON_TYPE_SUCCESS) {
+		free(columns);
+		free(schedules);
+		main_bailOut(EXIT_FAILURE, "Not enough memory available");
+	}
+	main_channelColumns = columns;
+
+	for (i = 0; i < main_channelVectorLength; i++) {
+		schedules[i] = main_channelSchedules[main_channelColumns[i]];
+	}
+	free(main_channelSchedules);
+	main_channelSchedules = schedules;
+}
+
+/**
+ * @brief Reads the optional scale and precision of a channel
+ * @details The function will bail out if an invalid value is detected.
+ * @param encoding The channel's encoding to initialize
+ * @param title The channel's title used to report errors
+ * @param config The configuration of the channel, not null
+ */
+static inline void main_initEncoding(csv_writer_encoding_t *encoding,
+		const char *title, config_setting_t *config) {
+	double scale = 1.0;
+	int intScale, precision = CSV_WRITER_NO_PRECISION;
+
+	assert(encoding != NULL && title != NULL);
+	assert(config != NULL);
+
+	if (config_setting_lookup_int(config, MAIN_CONFIG_SCALE, &intScale)) {
+		scale = intScale;
+	} else {
+		(void) config_setting_lookup_float(config, MAIN_CONFIG_SCALE, &scale);
+	}
+	if (!isfinite(scale) || scale == 0.0) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" of channel \"%s\" has to be a "
+				"finite non-zero number", MAIN_CONFIG_SCALE, title);
+	}
+
+	if (config_setting_lookup_int(config, MAIN_CONFIG_PRECISION, &precision)
+			&& (precision < 0 || precision > COMMON_TYPE_FIXED_MAX_EXPONENT)) {
+		main_bailOut(EXIT_ERR_CONFIG, "The \"%s\" of channel \"%s\" has to be "
+				"within [0, %d]", MAIN_CONFIG_PRECISION, title,
+				COMMON_TYPE_FIXED_MAX_EXPONENT);
+	}
+
+	encoding->scale = scale;
+	encoding->precision = precision;
+}
+
 /**
  * @brief Initializes the globally available configuration
  * @details It assumes that the program options are successfully parsed and
@@ -323,6 +965,7 @@ static inline void main_addChannel(unsigned int index, config_setting_t *config)
  */
 static inline void main_initConfig(void) {
 	config_init(&main_config);
+	main_configValid = 1;
 	if (!config_read_file(&main_config, main_progOpt.configName)) {
 		main_bailOut(EXIT_ERR_CONFIG, "Couldn't parse configuration file \"%s\" "
 				"(line: %d): %s", main_progOpt.configName,
@@ -331,170 +974,109 @@ static inline void main_initConfig(void) {
 }
 
 /**
- * @brief Fetches the values from each configured channel and writes them to the
- * previously opened CSV file.
+ * @brief Frees the global configuration
+ * @details Every setting is evaluated during startup and the components keep
+ * copies of the strings they need, so the parsed configuration isn't needed
+ * while sampling.
+ */
+static inline void main_releaseConfig(void) {
+	if (main_configValid) {
+		config_destroy(&main_config);
+		main_configValid = 0;
+	}
+}
+
+/**
+ * @brief Fetches the values from each configured channel and passes them to the
+ * CSV writer thread.
  * @details The network stack needs to be initialized but the function will call
- * the sync function on it's own. If something went wrong during printing or
- * synchronizing the function will bail out. If a value can't be fetched
- * correctly a place holder value will be inserted into the CSV file.
+ * the sync function on it's own. If something went wrong during synchronizing or
+ * the writer failed before, the function will bail out. If a value can't be
+ * fetched correctly a place holder value will be inserted into the CSV file.
+ * Only channels marked as due are sampled and only the modules needed to read
+ * them are synchronized. The columns of the remaining channels are left empty.
+ * If no channel is due, no row will be written. If the writer can't keep up,
+ * the configured queue policy applies. A row the daemon stopped waiting for is
+ * skipped.
+ * @param timestamp The time-stamp of the row or NULL to take the current time
+ * after synchronizing.
  */
-static void main_processSamples() {
+static void main_processSamples(const struct timeval *timestamp) {
 	struct timeval currentTime;
-	unsigned int i;
-	common_type_t result;
+	unsigned int i, dueCount = 0, dueIndex;
 	common_type_error_t err;
-    const char* csvSeparator = MAIN_CSV_SEP;
-
-	assert(main_csvOut != NULL);
-
-    (void) config_lookup_string(&main_config, MAIN_CONFIG_CSV_SEP, 
-            &csvSeparator);
-
-	err = pfm_sync();
-	if (err != COMMON_TYPE_SUCCESS) {
-		main_bailOut(EXIT_ERR_NETWORK, "Can't synchronize the network clients");
-	}
-
-	if (gettimeofday(&currentTime, NULL ) != 0) {
-		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't read the local system time");
-	}
-
-	main_appendTimestamp(main_csvOut, &currentTime);
-	if (fprintf(main_csvOut, "%s", csvSeparator) < 0) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file anymore");
-	}
+	csv_writer_row_t *row;
 
 	for (i = 0; i < main_channelVectorLength; i++) {
-		result = pfm_fetchValue(main_channelVector[i].channelID);
-		if (result.type == COMMON_TYPE_ERROR) {
-			logging_adapter_error("Can't fetch the value of \"%s\" (err-no. %d)",
-					main_channelVector[i].title, (int) result.data.errVal);
-		}
-		main_appendResult(main_csvOut, &result);
-
-		if (i + 1 < main_channelVectorLength) {
-			if (fprintf(main_csvOut, "%s", csvSeparator) < 0) {
-				main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file anymore");
-			}
+		if (main_channelDue[i]) {
+			main_dueIDs[dueCount++] = i;
 		}
 	}
-
-	if (fprintf(main_csvOut, "%s", MAIN_CSV_NEWLINE) < 0) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file anymore");
+	if (dueCount == 0 && main_channelVectorLength > 0) {
+		return; // Nothing to sample on this tick
 	}
 
-}
-
-/**
- * @brief Formats the given time-stamp and appends it to the file
- * @details <p>It assumes that both references are valid. If an error occurs
- * during writing the data the function will bail out. The function also assumes
- * that the configuration was previously initialized.</p>
- * <p>The given timeval structure is converted to a local time and printed
- * afterwards. The format is taken from the corresponding configuration
- * directive.</p>
- * @param file The file to write to
- * @param tv The time stamp to print
- *
- */
-static void main_appendTimestamp(FILE *file, struct timeval *tv) {
-	char strBuffer[MAIN_TIMESTAMP_BUFFER_SIZE];
-	const char* format = "%Y-%m-%d %H:%M:%S";
-	struct tm brokentime;
-	assert(file != NULL);
-	assert(tv != NULL);
-
-	(void) config_lookup_string(&main_config, MAIN_CONFIG_TIME_FORMAT, &format);
-
-	if (localtime_r(&tv->tv_sec, &brokentime) != &brokentime) {
-		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't convert to local time");
+	err = pfm_syncChannels(main_dueIDs, dueCount);
+	if (err != COMMON_TYPE_SUCCESS && main_progOpt.daemon) {
+		// Don't stop sampling on temporary network errors
+		logging_adapter_error("Can't synchronize the network clients "
+				"(err-code: %d), skip sample", (int) err);
+		return;
+	} else if (err != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_ERR_NETWORK, "Can't synchronize the network clients");
 	}
 
-	if (strftime(strBuffer, MAIN_TIMESTAMP_BUFFER_SIZE, format, &brokentime)
-			== 0) {
-		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't successfully create the time "
-				"string \"%s\"", format);
+	err = pfm_fetchValues(main_dueIDs, main_dueResults, dueCount);
+	if (err != COMMON_TYPE_SUCCESS) {
+		main_bailOut(EXIT_FAILURE, "Can't fetch the values of the channels");
 	}
 
-	if (fwrite(strBuffer, 1, strlen(strBuffer), file) != strlen(strBuffer)) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file anymore");
+	if (timestamp != NULL) {
+		currentTime = *timestamp;
+	} else if (gettimeofday(&currentTime, NULL ) != 0) {
+		main_bailOut(EXIT_ERR_LOCAL_SYS, "Can't read the local system time");
 	}
-}
-
-/**
- * @brief Appends the value to the given file
- * @details It assumes that the given references are valid. No column
- * separation character will be printed. If the function can not append the data
- * successfully, the function will bail out.
- * @param file The file reference used to append the result
- * @param result The result to append
- */
-static void main_appendResult(FILE *file, const common_type_t *result) {
-	int err = 0;
-	assert(file != NULL);
-	assert(result != NULL);
 
-	switch (result->type) {
-	case COMMON_TYPE_DOUBLE:
-		err = fprintf(file, "%.15le", result->data.doubleVal);
-		break;
-	case COMMON_TYPE_LONG:
-		err = fprintf(file, "%lli", (long long int) result->data.longVal);
-		break;
-	case COMMON_TYPE_STRING:
-		main_appendString(file, result->data.strVal);
-		break;
-	case COMMON_TYPE_ERROR:
-		err = fprintf(file, MAIN_CSV_ERR);
-		break;
-	default:
-		assert(0);
+	row = csv_writer_beginRow(&currentTime);
+	if (row == NULL) {
+		return; // The daemon stops while waiting for the writer
 	}
 
-	if (err < 0) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file anymore");
+	// Channels not due are left empty
+	for (dueIndex = 0; dueIndex < dueCount; dueIndex++) {
+		i = main_channelColumns[main_dueIDs[dueIndex]];
+		if (main_dueResults[dueIndex].type == COMMON_TYPE_ERROR) {
+			logging_adapter_error("Can't fetch the value of \"%s\" (err-no. %d)",
+					main_channelTitles[i],
+					(int) main_dueResults[dueIndex].data.errVal);
+		}
+		csv_writer_setValue(row, i, &main_dueResults[dueIndex]);
 	}
+
+	csv_writer_commitRow(row);
 }
 
 /**
- * @brief Tries to append the given string to the CSV file
- * @details <p>It is assumed that the given common type contains a valid string
- * reference. The string is enclosed within double quotes and any double quote
- * character will be escaped using two double quotes. No column separator is
- * appended. The terminating '\0' character won't be written.</p>
- * <p>If something went wrong the function will call main_bailOut</p>
- * @param file A valid file reference to append the CSV data
- * @param str The string to append
+ * @brief Reports the channels which couldn't be fetched every time
+ * @details Nothing is reported before the channels were ordered.
  */
-static void main_appendString(FILE *file, const char* str) {
-	const char quote = '"';
-
-	assert(file != NULL);
-	assert(str != NULL);
-
-	if (fwrite(&quote, sizeof(quote), 1, file) != sizeof(quote)) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
-	}
-
-	while (*str) {
-
-		if (*str == '"') {
-			if (fwrite(&quote, sizeof(quote), 1, file) != sizeof(quote)) {
-				main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
-			}
-		}
+static void main_logChannelStatistics(void) {
+	const pfm_channel_statistics_t *stats;
+	common_type_t lastValue;
+	unsigned int i;
 
-		if (fwrite(str, sizeof(str[0]), 1, file) != sizeof(str[0])) {
-			main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
+	for (i = 0; main_channelColumns != NULL && i < main_channelVectorLength;
+			i++) {
+		stats = pfm_getChannelStatistics(i);
+		if (stats->errors == 0) {
+			continue;
 		}
-
-		str++;
-	}
-
-	if (fwrite(&quote, sizeof(quote), 1, file) != sizeof(quote)) {
-		main_bailOut(EXIT_ERR_OUTFILE, "Can't write to the CSV file");
+		lastValue = pfm_getLastValue(i);
+		logging_adapter_info("Channel \"%s\": %lu of %lu fetch(es) failed%s",
+				main_channelTitles[main_channelColumns[i]], stats->errors,
+				stats->fetches, lastValue.type == COMMON_TYPE_ERROR ?
+						", including the last one" : "");
 	}
-
 }
 
 /**
@@ -508,7 +1090,7 @@ static void main_appendString(FILE *file, const char* str) {
 static void main_parseProgOpts(int argc, char** argv) {
 	int nextOpt;
 
-	while ((nextOpt = getopt(argc, argv, "c:h")) > 0) {
+	while ((nextOpt = getopt(argc, argv, "c:dh")) > 0) {
 		switch (nextOpt) {
 		case 'c':
 			if (main_progOpt.configNameSet) {
@@ -517,6 +1099,9 @@ static void main_parseProgOpts(int argc, char** argv) {
 			main_progOpt.configNameSet = 1;
 			main_progOpt.configName = optarg;
 			break;
+		case 'd':
+			main_progOpt.daemon = 1;
+			break;
 		case 'h':
 			main_progOpt.help = 1;
 			break;
@@ -541,9 +1126,11 @@ static void main_parseProgOpts(int argc, char** argv) {
  */
 static void main_printHelp(void) {
 	(void) printf("Usage:\n");
-	(void) printf("  %s [-c <file>] [-h]\n\n", main_progOpt.progname);
+	(void) printf("  %s [-c <file>] [-d] [-h]\n\n", main_progOpt.progname);
 	(void) printf("  -c <file>    Reads the configuration <file> instead of "
-			"\"%s\"\n\n", DEF_CONFIG);
+			"\"%s\"\n", DEF_CONFIG);
+	(void) printf("  -d           Keeps sampling every \"%s\" seconds until "
+			"terminated\n\n", MAIN_CONFIG_INTERVAL);
 	(void) printf("Reads the values from the fieldbus nodes configured and "
 			"appends them to a \n");
 	(void) printf("specified log file in a CSV format\n");
@@ -556,8 +1143,34 @@ static void main_printHelp(void) {
  */
 static void main_freeResources(void) {
 	common_type_error_t err;
+	int i;
 
-	free(main_channelVector);
+	main_logChannelStatistics();
+	for (i = 0; main_channelTitles != NULL && i < main_channelVectorLength; i++) {
+		free(main_channelTitles[i]);
+	}
+	free(main_channelTitles);
+	free(main_channelEncodings);
+	free(main_channelColumns);
+	free(main_channelDue);
+	free(main_channelSchedules);
+	free(main_dueIDs);
+	free(main_dueResults);
+	if (main_timerWheel.slots != NULL) {
+		timer_wheel_free(&main_timerWheel);
+	}
+
+	(void) csv_writer_free();
+	control_free();
+	if (main_timerSource.fd >= 0) {
+		(void) close(main_timerSource.fd);
+		main_timerSource.fd = -1;
+	}
+	if (main_signalSource.fd >= 0) {
+		(void) close(main_signalSource.fd);
+		main_signalSource.fd = -1;
+	}
+	reactor_free();
 
 	err = pfm_free();
 	if (err != COMMON_TYPE_SUCCESS) {
@@ -565,7 +1178,7 @@ static void main_freeResources(void) {
 				(int) err);
 	}
 
-	config_destroy(&main_config);
+	main_releaseConfig();
 	logging_adapter_freeResources();
 }
 
@@ -28,13 +28,19 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 
 /* Configuration directives */
 #define PFM_CONFIG_MAC "mac"
 #define PFM_CONFIG_NAME "name"
 #define PFM_CONFIG_TYPE "type"
 #define PFM_CONFIG_ADDRESS "address"
+#define PFM_CONFIG_ID "id"
+#define PFM_CONFIG_SYNC_THREADS "syncThreads"
 
 /** @brief Structure encapsulating a MAC module's data*/
 typedef struct {
@@ -44,37 +50,86 @@ typedef struct {
 	fieldbus_mac_sync_t sync;
 	/** The free function pointer of the module */
 	fieldbus_mac_free_t free;
+	/** The sync function pointer of a module providing contexts or NULL */
+	fieldbus_mac_syncContext_t syncContext;
+	/** The free function pointer of a module providing contexts or NULL */
+	fieldbus_mac_freeContext_t freeContext;
+	/** @brief The instance's context, if the module provides contexts */
+	fieldbus_mac_context_t context;
+	/** @brief The copy of the optional identifier referenced by channels */
+	char* id;
+	/**
+	 * @brief The index of the first MAC entry sharing the module's handler
+	 * @details Entries sharing a handler share the module's state and are
+	 * synchronized by the same thread one after another. Entries of modules
+	 * providing contexts don't share any state and form their own group.
+	 */
+	unsigned int syncGroup;
+	/** @brief The number of successful and failed synchronizations */
+	unsigned long syncCount;
+	/** @brief The duration of the last synchronization in nanoseconds */
+	int64_t lastLatency;
+	/** @brief The longest synchronization in nanoseconds */
+	int64_t maxLatency;
+	/** @brief The sum of every synchronization's duration in nanoseconds */
+	int64_t totalLatency;
+	/** @brief Flag indicating that the module has to be synchronized */
+	unsigned int due :1;
 } pfm_mac_t;
 
 /** @brief Structure encapsulating an application module's data */
 typedef struct {
 	/** @brief The handler used by the dl function. */
 	void* handler;
-	/**
-	 * @brief The name of the shared object holding the module
-	 * @details The string will be contained within the configuration structure
-	 * and mustn't be deallocated manually.
-	 */
-	const char* name;
+	/** @brief The copy of the name of the shared object holding the module */
+	char* name;
 	/** @brief fieldbus_application_sync function reference of the module */
 	fieldbus_application_sync_t sync;
 	/** @brief fieldbus_application_fetchValue function reference of the module */
 	fieldbus_application_fetchValue_t fetchValue;
+	/**
+	 * @brief fieldbus_application_compileAddress function reference of the
+	 * module or NULL, if compiled addresses are not supported
+	 */
+	fieldbus_application_compileAddress_t compileAddress;
+	/**
+	 * @brief fieldbus_application_fetchCompiled function reference of the
+	 * module or NULL, if compiled addresses are not supported
+	 */
+	fieldbus_application_fetchCompiled_t fetchCompiled;
+	/**
+	 * @brief fieldbus_application_fetchValues function reference of the module
+	 * or NULL, if fetching several compiled addresses at once isn't supported
+	 */
+	fieldbus_application_fetchValues_t fetchValues;
 	/** @brief fieldbus_application_free function reference of the module */
 	fieldbus_application_free_t free;
-} pfm_app_t;
-
-/** @brief Structure defining a single data channel */
-typedef struct {
-	/** @brief The configuration snippet defining the address */
-	config_setting_t *address;
 	/**
-	 * @brief The index of the associated application layer module
-	 * @details The module's address may change if new modules were registered,
-	 * the index will remain.
+	 * @brief fieldbus_application_syncContext function reference of the module
+	 * or NULL, if the module doesn't provide the context variant
 	 */
-	int appIndex;
-} pfm_channel_t;
+	fieldbus_application_syncContext_t syncContext;
+	/** @brief fieldbus_application_compileContext function reference */
+	fieldbus_application_compileContext_t compileContext;
+	/** @brief fieldbus_application_fetchContext function reference */
+	fieldbus_application_fetchContext_t fetchContext;
+	/**
+	 * @brief fieldbus_application_fetchValuesContext function reference or
+	 * NULL, if fetching several compiled addresses at once isn't supported
+	 */
+	fieldbus_application_fetchValuesContext_t fetchValuesContext;
+	/**
+	 * @brief fieldbus_application_getMacContext function reference or NULL,
+	 * if the module can't tell the MAC instance serving an address
+	 */
+	fieldbus_application_getMacContext_t getMacContext;
+	/** @brief fieldbus_application_freeContext function reference */
+	fieldbus_application_freeContext_t freeContext;
+	/** @brief The module's context, if the context variant is provided */
+	fieldbus_application_context_t context;
+	/** @brief Flag indicating that the module has to be synchronized */
+	unsigned int due :1;
+} pfm_app_t;
 
 /** @brief The size of the MAC module vector */
 static unsigned int pfm_macVectorLength = 0;
@@ -86,25 +141,130 @@ static unsigned int pfm_appVectorLength = 0;
 /** @brief The vector of loaded application modules */
 static pfm_app_t * pfm_appVector = NULL;
 
+/*
+ * The channels are stored as parallel vectors indexed by the channel's
+ * identifier. Once every channel is added, pfm_orderChannels sorts the vectors
+ * by the modules the channels depend on. Thus, a sample walks every vector
+ * linearly and the channels of a module are passed to it at once.
+ */
 /** @brief The number of available channels */
 static unsigned int pfm_channelVectorLength = 0;
-/** @brief The vector containing every initialized channel */
-static pfm_channel_t *pfm_channelVector = NULL;
+/** @brief The number of channels the channel vectors are able to hold */
+static unsigned int pfm_channelCapacity = 0;
+/**
+ * @brief The index of each channel's application layer module
+ * @details The module's address may change if new modules were registered,
+ * the index will remain.
+ */
+static unsigned int *pfm_channelApps = NULL;
+/**
+ * @brief The index of the MAC module each channel depends on
+ * @details The index is derived while adding the channel, if it doesn't name
+ * its MAC module. A negative index denotes that the channel depends on every
+ * MAC module.
+ */
+static int *pfm_channelMacs = NULL;
+/** @brief Flag indicating that a channel depending on every MAC was reported */
+static int pfm_channelMacsAmbiguous = 0;
+/**
+ * @brief The compiled address of each channel
+ * @details The handle is only valid if the application module supports
+ * compiled addresses.
+ */
+static fieldbus_application_handle_t *pfm_channelHandles = NULL;
+/**
+ * @brief The configuration snippet defining each channel's address
+ * @details The snippet is only kept if the application module doesn't support
+ * compiled addresses. It refers to a copy owned by the manager, so the
+ * configuration may be freed after adding the channels.
+ */
+static config_setting_t **pfm_channelAddresses = NULL;
+/** @brief The value or error each channel returned last */
+static common_type_t *pfm_channelLastValues = NULL;
+/** @brief The statistics of each channel */
+static pfm_channel_statistics_t *pfm_channelStats = NULL;
+
+/** @brief The configuration holding the copied addresses of channels */
+static config_t pfm_addressConfig;
+/** @brief Flag indicating that pfm_addressConfig is initialized */
+static int pfm_addressConfigValid = 0;
+
+/** @brief The number of elements the batch vector is able to hold */
+static unsigned int pfm_batchCapacity = 0;
+/**
+ * @brief The compiled addresses passed to a module's fetchValues function
+ * @details The vector is only used if the channels passed aren't stored
+ * consecutively within the channel vectors.
+ */
+static fieldbus_application_handle_t *pfm_batchHandles = NULL;
+
+/** @brief The number of worker threads synchronizing MAC modules */
+static unsigned int pfm_syncThreadCount = 0;
+/** @brief The worker threads synchronizing MAC modules */
+static pthread_t *pfm_syncThreads = NULL;
+/** @brief Barrier releasing the workers at the beginning of a sync */
+static pthread_barrier_t pfm_syncStart;
+/** @brief Barrier joining the workers at the end of a sync */
+static pthread_barrier_t pfm_syncDone;
+/** @brief Lock protecting the shared sync state below */
+static pthread_mutex_t pfm_syncLock = PTHREAD_MUTEX_INITIALIZER;
+/** @brief The next MAC entry to consider during the current sync */
+static unsigned int pfm_syncNext;
+/** @brief The first error reported during the current sync */
+static common_type_error_t pfm_syncError;
+/** @brief Flag telling the workers to terminate */
+static int pfm_syncQuit;
+/** @brief 0 until the workers are released, 1 to start and -1 to terminate */
+static int pfm_syncReady;
+/** @brief Condition signaling a change of pfm_syncReady */
+static pthread_cond_t pfm_syncReadyCond = PTHREAD_COND_INITIALIZER;
 
 /* Function prototypes */
 static inline common_type_error_t pfm_installMacModule(
 		config_setting_t *modConfig, const unsigned int index);
+static inline common_type_error_t pfm_installMacContext(
+		config_setting_t *modConfig, const unsigned int index,
+		fieldbus_mac_initContext_t initContext);
 static inline common_type_error_t pfm_freeMac(void);
 static inline common_type_error_t pfm_freeAppModules(void);
+static inline common_type_error_t pfm_reserveBatch(unsigned int count);
+static inline common_type_error_t pfm_reserveChannel(void);
+static int pfm_deriveMacIndex(int appIndex,
+		fieldbus_application_handle_t handle);
+static int pfm_compareChannels(const void *first, const void *second);
+static void pfm_permuteVector(void *vector, size_t size,
+		const unsigned int *order, unsigned int length, void *buffer);
+static inline unsigned int pfm_getBatchEnd(const int *ids, unsigned int start,
+		unsigned int count, int *consecutive);
 static int pfm_getAppIndex(const char* driverName);
 static int pfm_loadAppModule(const char* name);
 static void pfm_appVectorRollback(void);
 static inline fieldbus_application_init_t pfm_lookupAppInterfaceFunctions(
 		pfm_app_t *app);
-static inline int pfm_newChannel(int appIndex, config_setting_t *address);
+static inline int pfm_lookupAppCompileFunctions(pfm_app_t *app);
+static inline common_type_error_t pfm_installAppContext(pfm_app_t *app,
+		fieldbus_application_initContext_t initContext);
+static inline int pfm_newChannel(int appIndex, int macIndex,
+		config_setting_t *address);
+static inline int pfm_getMacIndex(config_setting_t* channelConf);
+static config_setting_t * pfm_copyAddress(const config_setting_t *address);
+static common_type_error_t pfm_copySetting(config_setting_t *copy,
+		const config_setting_t *setting);
+static char * pfm_copyString(const char *str);
+static common_type_error_t pfm_syncDue(void);
+static inline common_type_error_t pfm_startSyncThreads(
+		config_setting_t* configuration);
+static inline void pfm_stopSyncThreads(void);
+static void pfm_releaseSyncThreads(int state);
+static void* pfm_syncWorker(void *arg);
+static void pfm_runSyncTasks(void);
+static common_type_error_t pfm_syncMacGroup(unsigned int group);
+static inline void pfm_logMacStatistics(void);
 
 /**
  * @brief Extracts the MAC module's names and loads the modules.
+ * @details Afterwards, the threads synchronizing independent MAC modules
+ * concurrently are started.
  * @param configuration The root configuration containing the mac member. The
  * root configuration has to be a group setting always.
  * @return The status of the operation
@@ -145,9 +305,176 @@ common_type_error_t pfm_init(config_setting_t* configuration) {
 		}
 	}
 
+	return pfm_startSyncThreads(configuration);
+}
+
+/**
+ * @brief Assigns the sync groups and starts the worker threads
+ * @details The number of threads synchronizing MAC modules, including the
+ * calling thread, is taken from the optional syncThreads directive. It is
+ * limited by the number of independent MAC modules, which is the default as
+ * well. If only one thread is used, no worker is started and every module is
+ * synchronized sequentially. Workers don't handle any signal, so signals still
+ * interrupt the calling thread.
+ * @param configuration The root configuration
+ * @return The status of the operation
+ */
+static inline common_type_error_t pfm_startSyncThreads(
+		config_setting_t* configuration) {
+	unsigned int i, j, groupCount = 0;
+	int threads;
+	sigset_t allSignals, oldSignals;
+
+	for (i = 0; i < pfm_macVectorLength; i++) {
+		for (j = 0; pfm_macVector[j].handler != pfm_macVector[i].handler; j++)
+			;
+		if (pfm_macVector[i].syncContext != NULL) {
+			j = i; // Instances don't share any state
+		}
+		pfm_macVector[i].syncGroup = j;
+		groupCount += (i == j ? 1 : 0);
+	}
+
+	threads = (int) groupCount;
+	if (config_setting_lookup_int(configuration, PFM_CONFIG_SYNC_THREADS,
+			&threads) && threads < 1) {
+		logging_adapter_info("The \"%s\" directive has to be positive",
+				PFM_CONFIG_SYNC_THREADS);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+	if ((unsigned int) threads > groupCount) {
+		threads = (int) groupCount;
+	}
+	if (threads <= 1) {
+		logging_adapter_debug("Synchronize the MAC modules sequentially");
+		return COMMON_TYPE_SUCCESS;
+	}
+
+	pfm_syncThreads = malloc((threads - 1) * sizeof(pfm_syncThreads[0]));
+	if (pfm_syncThreads == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	pfm_syncQuit = 0;
+	pfm_syncReady = 0;
+	(void) sigfillset(&allSignals);
+	(void) pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+	for (pfm_syncThreadCount = 0; pfm_syncThreadCount < threads - 1;
+			pfm_syncThreadCount++) {
+		if (pthread_create(&pfm_syncThreads[pfm_syncThreadCount], NULL,
+				&pfm_syncWorker, NULL) != 0) {
+			logging_adapter_info("Can only start %u of %d MAC sync threads",
+					pfm_syncThreadCount, threads - 1);
+			break;
+		}
+	}
+	(void) pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+
+	// The barriers are sized by the number of workers actually started
+	if (pfm_syncThreadCount == 0
+			|| pthread_barrier_init(&pfm_syncStart, NULL,
+					pfm_syncThreadCount + 1) != 0) {
+		pfm_releaseSyncThreads(-1);
+		return pfm_syncThreadCount == 0 ? COMMON_TYPE_SUCCESS : COMMON_TYPE_ERR;
+	}
+	if (pthread_barrier_init(&pfm_syncDone, NULL, pfm_syncThreadCount + 1)
+			!= 0) {
+		(void) pthread_barrier_destroy(&pfm_syncStart);
+		pfm_releaseSyncThreads(-1);
+		return COMMON_TYPE_ERR;
+	}
+	pfm_releaseSyncThreads(1);
+
+	logging_adapter_debug("Synchronize %u MAC module(s) using %u threads",
+			groupCount, pfm_syncThreadCount + 1);
 	return COMMON_TYPE_SUCCESS;
 }
 
+/**
+ * @brief Releases the freshly started worker threads
+ * @details If the workers are told to terminate, they are joined and the
+ * thread vector is freed. In this case the MAC modules are synchronized
+ * sequentially.
+ * @param state 1 to start synchronizing, -1 to terminate the workers
+ */
+static void pfm_releaseSyncThreads(int state) {
+	unsigned int i;
+
+	(void) pthread_mutex_lock(&pfm_syncLock);
+	pfm_syncReady = state;
+	(void) pthread_cond_broadcast(&pfm_syncReadyCond);
+	(void) pthread_mutex_unlock(&pfm_syncLock);
+
+	if (state < 0) {
+		for (i = 0; i < pfm_syncThreadCount; i++) {
+			(void) pthread_join(pfm_syncThreads[i], NULL);
+		}
+		free(pfm_syncThreads);
+		pfm_syncThreads = NULL;
+		pfm_syncThreadCount = 0;
+	}
+}
+
+/**
+ * @brief Terminates the worker threads and frees their resources
+ * @details The function does nothing if the MAC modules are synchronized
+ * sequentially.
+ */
+static inline void pfm_stopSyncThreads(void) {
+	unsigned int i;
+
+	if (pfm_syncThreads == NULL) {
+		return;
+	}
+
+	pfm_syncQuit = 1;
+	(void) pthread_barrier_wait(&pfm_syncStart);
+	for (i = 0; i < pfm_syncThreadCount; i++) {
+		(void) pthread_join(pfm_syncThreads[i], NULL);
+	}
+
+	(void) pthread_barrier_destroy(&pfm_syncStart);
+	(void) pthread_barrier_destroy(&pfm_syncDone);
+	free(pfm_syncThreads);
+	pfm_syncThreads = NULL;
+	pfm_syncThreadCount = 0;
+}
+
+/**
+ * @brief The main loop of a worker thread
+ * @details The worker waits until the pool is released. Afterwards it takes
+ * part in every sync until it is told to terminate.
+ * @param arg Unused
+ * @return Always NULL
+ */
+static void* pfm_syncWorker(void *arg) {
+	int state;
+
+	(void) arg;
+
+	(void) pthread_mutex_lock(&pfm_syncLock);
+	while (pfm_syncReady == 0) {
+		(void) pthread_cond_wait(&pfm_syncReadyCond, &pfm_syncLock);
+	}
+	state = pfm_syncReady;
+	(void) pthread_mutex_unlock(&pfm_syncLock);
+
+	if (state < 0) {
+		return NULL;
+	}
+
+	for (;;) {
+		(void) pthread_barrier_wait(&pfm_syncStart);
+		if (pfm_syncQuit) {
+			break;
+		}
+		pfm_runSyncTasks();
+		(void) pthread_barrier_wait(&pfm_syncDone);
+	}
+	return NULL;
+}
+
 /**
  * @brief Loads the given module, adds its handler to the list of known modules
  * and initializes it.
@@ -160,6 +487,7 @@ common_type_error_t pfm_init(config_setting_t* configuration) {
 static inline common_type_error_t pfm_installMacModule(
 		config_setting_t *modConfig, const unsigned int index) {
 	const char* name = "";
+	const char* id = NULL;
 	char* errStr;
 	/* Used to fix the POSIX - C99 conflict */
 	union {
@@ -167,6 +495,7 @@ static inline common_type_error_t pfm_installMacModule(
 		fieldbus_mac_init_t initPtr;
 		fieldbus_mac_sync_t syncPtr;
 		fieldbus_mac_free_t freePtr;
+		fieldbus_mac_initContext_t initContextPtr;
 	} ptrWorkaround;
 
 	common_type_error_t err;
@@ -188,6 +517,15 @@ static inline common_type_error_t pfm_installMacModule(
 	}
 	assert(name != NULL);
 
+	// The identifier is optional
+	if (config_setting_lookup_string(modConfig, PFM_CONFIG_ID, &id)) {
+		pfm_macVector[index].id = pfm_copyString(id);
+		if (pfm_macVector[index].id == NULL) {
+			logging_adapter_info("Can't obtain more memory");
+			return COMMON_TYPE_ERR;
+		}
+	}
+
 	logging_adapter_debug("Try to load MAC module \"%s\"", name);
 
 	pfm_macVector[index].handler = dlopen(name, RTLD_NOW | RTLD_GLOBAL);
@@ -196,6 +534,15 @@ static inline common_type_error_t pfm_installMacModule(
 		return COMMON_TYPE_ERR_LOAD_MODULE;
 	}
 
+	// Prefer the context variant, if available
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(pfm_macVector[index].handler,
+			FIELDBUS_MAC_INIT_CONTEXT_NAME);
+	if (dlerror() == NULL && ptrWorkaround.vPtr != NULL) {
+		return pfm_installMacContext(modConfig, index,
+				ptrWorkaround.initContextPtr);
+	}
+
 	// Load end execute init function
 	(void) dlerror();
 	ptrWorkaround.vPtr = dlsym(pfm_macVector[index].handler, "fieldbus_mac_init");
@@ -241,13 +588,77 @@ static inline common_type_error_t pfm_installMacModule(
 	return COMMON_TYPE_SUCCESS;
 }
 
+/**
+ * @brief Creates a new instance of a module providing contexts
+ * @details The sync and free functions are looked up before creating the
+ * instance, so the instance is always freed by pfm_freeMac.
+ * @param modConfig The module's group configuration.
+ * @param index The index within the MAC vector structure to populate.
+ * @param initContext The module's valid initContext function
+ * @return The status of the operation
+ */
+static inline common_type_error_t pfm_installMacContext(
+		config_setting_t *modConfig, const unsigned int index,
+		fieldbus_mac_initContext_t initContext) {
+	char* errStr;
+	fieldbus_mac_syncContext_t syncContext;
+	fieldbus_mac_freeContext_t freeContext;
+	fieldbus_mac_context_t context;
+	common_type_error_t err;
+	/* Used to fix the POSIX - C99 conflict */
+	union {
+		void* vPtr;
+		fieldbus_mac_syncContext_t syncPtr;
+		fieldbus_mac_freeContext_t freePtr;
+	} ptrWorkaround;
+
+	assert(modConfig != NULL);
+	assert(index < pfm_macVectorLength);
+	assert(initContext != NULL);
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(pfm_macVector[index].handler,
+			FIELDBUS_MAC_SYNC_CONTEXT_NAME);
+	syncContext = ptrWorkaround.syncPtr;
+	errStr = dlerror();
+	if (errStr != NULL ) {
+		logging_adapter_info("Can't successfully load the \"%s\" "
+				"function: %s", FIELDBUS_MAC_SYNC_CONTEXT_NAME, errStr);
+		return COMMON_TYPE_ERR_LOAD_MODULE;
+	}
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(pfm_macVector[index].handler,
+			FIELDBUS_MAC_FREE_CONTEXT_NAME);
+	freeContext = ptrWorkaround.freePtr;
+	errStr = dlerror();
+	if (errStr != NULL ) {
+		logging_adapter_info("Can't successfully load the \"%s\" "
+				"function: %s", FIELDBUS_MAC_FREE_CONTEXT_NAME, errStr);
+		return COMMON_TYPE_ERR_LOAD_MODULE;
+	}
+
+	assert(syncContext != NULL);
+	assert(freeContext != NULL);
+
+	err = initContext(modConfig, &context);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	pfm_macVector[index].context = context;
+	pfm_macVector[index].syncContext = syncContext;
+	pfm_macVector[index].freeContext = freeContext;
+	return COMMON_TYPE_SUCCESS;
+}
+
 /**
  * @details Assumes that the channelConf reference isn't null.
  */
 int pfm_addChannel(config_setting_t* channelConf) {
 	const char* driver = "";
 	config_setting_t *address;
-	int appIndex = -1;
+	int appIndex = -1, macIndex;
 
 	assert(channelConf != NULL);
 
@@ -270,6 +681,11 @@ int pfm_addChannel(config_setting_t* channelConf) {
 		return -1;
 	}
 
+	macIndex = pfm_getMacIndex(channelConf);
+	if (macIndex < -1) {
+		return -1;
+	}
+
 	// obtain the device driver
 	appIndex = pfm_getAppIndex(driver);
 	if (appIndex < 0 ) {
@@ -280,41 +696,372 @@ int pfm_addChannel(config_setting_t* channelConf) {
 		return -1;
 	}
 
-	return pfm_newChannel(appIndex, address);
+	return pfm_newChannel(appIndex, macIndex, address);
+}
+
+/**
+ * @brief Resolves the MAC module referenced by the channel configuration
+ * @details If the channel doesn't reference a MAC module, -1 is returned. If
+ * the referenced module can't be found an error message will be reported and
+ * -2 is returned.
+ * @param channelConf The valid channel configuration group
+ * @return The index of the MAC module, -1 or -2
+ */
+static inline int pfm_getMacIndex(config_setting_t* channelConf) {
+	const char* macID;
+	unsigned int i;
+
+	assert(channelConf != NULL);
+
+	if (!config_setting_lookup_string(channelConf, PFM_CONFIG_MAC, &macID)) {
+		return -1;
+	}
+
+	for (i = 0; i < pfm_macVectorLength; i++) {
+		if (pfm_macVector[i].id != NULL && strcmp(pfm_macVector[i].id, macID) == 0) {
+			return i;
+		}
+	}
+
+	logging_adapter_info("The channel references the unknown MAC module \"%s\"",
+			macID);
+	return -2;
 }
 
 /**
  * @brief Adds a new channel to the list of known channels and returns it's id
- * @details If the function is unable to obtain memory, -1 is returned.
+ * @details If the application module supports compiled addresses, the address
+ * will be compiled. Otherwise, a copy of the address is kept. If the function
+ * is unable to obtain memory or to compile the address, -1 is returned.
  * @param appIndex The index of the previously loaded app module within it's
  * vector
+ * @param macIndex The index of the MAC module the channel depends on or -1
  * @param address The channel's address configuration
  * @return The index of the newly created channel
  */
-static inline int pfm_newChannel(int appIndex, config_setting_t *address) {
+static inline int pfm_newChannel(int appIndex, int macIndex,
+		config_setting_t *address) {
 	unsigned int index = pfm_channelVectorLength;
-	pfm_channel_t * oldVector = pfm_channelVector;
+	fieldbus_application_handle_t handle = NULL;
+	config_setting_t *copy = NULL;
+	common_type_error_t err;
 
 	assert(appIndex >= 0);
 	assert(appIndex < pfm_appVectorLength);
 	assert(address != NULL);
 
-	pfm_channelVector = realloc(pfm_channelVector,
-			(pfm_channelVectorLength + 1) * sizeof(pfm_channelVector[0]));
-	if (pfm_channelVector == NULL ) {
-		pfm_channelVector = oldVector;
+	// Reserve first, so a compiled handle is never left without an owner
+	if (pfm_reserveChannel() != COMMON_TYPE_SUCCESS) {
 		logging_adapter_info("Can't obtain more memory");
 		return -1;
 	}
 
+	if (pfm_appVector[appIndex].compileContext != NULL) {
+		err = pfm_appVector[appIndex].compileContext(
+				pfm_appVector[appIndex].context, address, &handle);
+	} else if (pfm_appVector[appIndex].compileAddress != NULL) {
+		err = pfm_appVector[appIndex].compileAddress(address, &handle);
+	} else {
+		// The module accesses the address on each fetch, so it is kept
+		copy = pfm_copyAddress(address);
+		err = (copy != NULL ? COMMON_TYPE_SUCCESS : COMMON_TYPE_ERR);
+	}
+	if (err != COMMON_TYPE_SUCCESS) {
+		logging_adapter_info("Can't compile the channel's address for module "
+				"\"%s\" (err-no: %d)", pfm_appVector[appIndex].name, (int) err);
+		return -1;
+	}
+
 	pfm_channelVectorLength++;
 
-	pfm_channelVector[index].address = address;
-	pfm_channelVector[index].appIndex = appIndex;
+	pfm_channelAddresses[index] = copy;
+	pfm_channelHandles[index] = handle;
+	pfm_channelApps[index] = (unsigned int) appIndex;
+	pfm_channelMacs[index] =
+			macIndex >= 0 ? macIndex : pfm_deriveMacIndex(appIndex, handle);
+	pfm_channelLastValues[index].type = COMMON_TYPE_ERROR;
+	pfm_channelLastValues[index].data.errVal = COMMON_TYPE_ERR;
+	memset(&pfm_channelStats[index], 0, sizeof(pfm_channelStats[0]));
 
 	return index;
 }
 
+/**
+ * @brief Derives the MAC module a channel not naming it depends on
+ * @details The dependency is unambiguous if only one MAC module is loaded or if
+ * the application module reports the MAC instance serving the address.
+ * Otherwise, the channel depends on every MAC module, which is reported once.
+ * @param appIndex The index of the channel's application module
+ * @param handle The channel's compiled address or NULL
+ * @return The index of the MAC module or -1
+ */
+static int pfm_deriveMacIndex(int appIndex,
+		fieldbus_application_handle_t handle) {
+	const pfm_app_t *app = &pfm_appVector[appIndex];
+	fieldbus_mac_context_t macContext;
+	unsigned int i;
+
+	if (pfm_macVectorLength <= 1) {
+		return pfm_macVectorLength == 1 ? 0 : -1;
+	}
+
+	if (app->getMacContext != NULL) {
+		macContext = app->getMacContext(app->context, handle);
+		for (i = 0; macContext != NULL && i < pfm_macVectorLength; i++) {
+			if (pfm_macVector[i].syncContext != NULL
+					&& pfm_macVector[i].context == macContext) {
+				return i;
+			}
+		}
+	}
+
+	if (!pfm_channelMacsAmbiguous) {
+		logging_adapter_info("Channel %u of module \"%s\" doesn't name its MAC "
+				"module, so reading it synchronizes every MAC module",
+				pfm_channelVectorLength - 1, app->name);
+		pfm_channelMacsAmbiguous = 1;
+	}
+	return -1;
+}
+
+common_type_error_t pfm_orderChannels(unsigned int *previousIDs) {
+	unsigned int i;
+	size_t size;
+	void *buffer;
+
+	assert(previousIDs != NULL || pfm_channelVectorLength == 0);
+
+	if (pfm_channelVectorLength == 0)
+		return COMMON_TYPE_SUCCESS;
+
+	for (i = 0; i < pfm_channelVectorLength; i++) {
+		previousIDs[i] = i;
+	}
+	qsort(previousIDs, pfm_channelVectorLength, sizeof(previousIDs[0]),
+			&pfm_compareChannels);
+
+	// A single buffer holds the elements of any vector while it is reordered
+	size = sizeof(pfm_channelLastValues[0]);
+	size = (sizeof(pfm_channelStats[0]) > size ? sizeof(pfm_channelStats[0])
+			: size);
+	size = (sizeof(pfm_channelHandles[0]) > size ? sizeof(pfm_channelHandles[0])
+			: size);
+	buffer = malloc(pfm_channelVectorLength * size);
+	if (buffer == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	pfm_permuteVector(pfm_channelApps, sizeof(pfm_channelApps[0]), previousIDs,
+			pfm_channelVectorLength, buffer);
+	pfm_permuteVector(pfm_channelMacs, sizeof(pfm_channelMacs[0]), previousIDs,
+			pfm_channelVectorLength, buffer);
+	pfm_permuteVector(pfm_channelHandles, sizeof(pfm_channelHandles[0]),
+			previousIDs, pfm_channelVectorLength, buffer);
+	pfm_permuteVector(pfm_channelAddresses, sizeof(pfm_channelAddresses[0]),
+			previousIDs, pfm_channelVectorLength, buffer);
+	pfm_permuteVector(pfm_channelLastValues, sizeof(pfm_channelLastValues[0]),
+			previousIDs, pfm_channelVectorLength, buffer);
+	pfm_permuteVector(pfm_channelStats, sizeof(pfm_channelStats[0]),
+			previousIDs, pfm_channelVectorLength, buffer);
+
+	free(buffer);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Compares two channels by the modules they depend on
+ * @details Channels are ordered by their MAC module first and by their
+ * application module afterwards. Channels depending on every MAC module are
+ * ordered last. Channels depending on the same modules are ordered by their
+ * identifier, so the order is stable.
+ * @param first The reference to the first channel's identifier
+ * @param second The reference to the second channel's identifier
+ * @return A negative or positive value if the first channel is ordered before
+ * or after the second one
+ */
+static int pfm_compareChannels(const void *first, const void *second) {
+	unsigned int a = *(const unsigned int *) first;
+	unsigned int b = *(const unsigned int *) second;
+	int macA = pfm_channelMacs[a], macB = pfm_channelMacs[b];
+
+	if (macA != macB) {
+		if (macA < 0 || macB < 0)
+			return macA < 0 ? 1 : -1;
+		return macA < macB ? -1 : 1;
+	}
+	if (pfm_channelApps[a] != pfm_channelApps[b])
+		return pfm_channelApps[a] < pfm_channelApps[b] ? -1 : 1;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/**
+ * @brief Reorders the elements of a vector
+ * @param vector The vector to reorder
+ * @param size The size of a single element
+ * @param order The previous position of each element, indexed by the new one
+ * @param length The number of elements
+ * @param buffer The buffer able to hold every element
+ */
+static void pfm_permuteVector(void *vector, size_t size,
+		const unsigned int *order, unsigned int length, void *buffer) {
+	unsigned int i;
+
+	memcpy(buffer, vector, length * size);
+	for (i = 0; i < length; i++) {
+		memcpy((char *) vector + i * size, (const char *) buffer + order[i] * size,
+				size);
+	}
+}
+
+/**
+ * @brief Ensures that the channel vectors are able to hold another channel
+ * @details The capacity is doubled, so adding many channels doesn't copy the
+ * vectors each time.
+ * @return The status of the operation
+ */
+static inline common_type_error_t pfm_reserveChannel(void) {
+	unsigned int capacity;
+	unsigned int *apps;
+	int *macs;
+	fieldbus_application_handle_t *handles;
+	config_setting_t **addresses;
+	common_type_t *lastValues;
+	pfm_channel_statistics_t *stats;
+
+	if (pfm_channelVectorLength < pfm_channelCapacity)
+		return COMMON_TYPE_SUCCESS;
+
+	capacity = (pfm_channelCapacity > 0 ? 2 * pfm_channelCapacity : 16);
+	apps = realloc(pfm_channelApps, capacity * sizeof(apps[0]));
+	if (apps != NULL)
+		pfm_channelApps = apps;
+	macs = realloc(pfm_channelMacs, capacity * sizeof(macs[0]));
+	if (macs != NULL)
+		pfm_channelMacs = macs;
+	handles = realloc(pfm_channelHandles, capacity * sizeof(handles[0]));
+	if (handles != NULL)
+		pfm_channelHandles = handles;
+	addresses = realloc(pfm_channelAddresses, capacity * sizeof(addresses[0]));
+	if (addresses != NULL)
+		pfm_channelAddresses = addresses;
+	lastValues = realloc(pfm_channelLastValues, capacity * sizeof(lastValues[0]));
+	if (lastValues != NULL)
+		pfm_channelLastValues = lastValues;
+	stats = realloc(pfm_channelStats, capacity * sizeof(stats[0]));
+	if (stats != NULL)
+		pfm_channelStats = stats;
+
+	if (apps == NULL || macs == NULL || handles == NULL || addresses == NULL
+			|| lastValues == NULL || stats == NULL)
+		return COMMON_TYPE_ERR;
+
+	pfm_channelCapacity = capacity;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Copies the given address into the manager's own configuration
+ * @details The copies are appended to a list and freed by pfm_free.
+ * @param address The address snippet to copy
+ * @return The copy or NULL if it can't be created
+ */
+static config_setting_t * pfm_copyAddress(const config_setting_t *address) {
+	config_setting_t *root, *list, *copy;
+
+	assert(address != NULL);
+
+	if (!pfm_addressConfigValid) {
+		config_init(&pfm_addressConfig);
+		pfm_addressConfigValid = 1;
+	}
+	root = config_root_setting(&pfm_addressConfig);
+	list = config_setting_get_member(root, PFM_CONFIG_ADDRESS);
+	if (list == NULL) {
+		list = config_setting_add(root, PFM_CONFIG_ADDRESS, CONFIG_TYPE_LIST);
+	}
+	if (list == NULL) {
+		return NULL;
+	}
+
+	copy = config_setting_add(list, NULL, config_setting_type(address));
+	if (copy == NULL || pfm_copySetting(copy, address) != COMMON_TYPE_SUCCESS) {
+		return NULL;
+	}
+	return copy;
+}
+
+/**
+ * @brief Recursively copies the value of the given setting
+ * @details The copy has to be of the same type as the setting. Members of
+ * groups keep their names.
+ * @param copy The setting receiving the value
+ * @param setting The setting to copy
+ * @return The status of the operation
+ */
+static common_type_error_t pfm_copySetting(config_setting_t *copy,
+		const config_setting_t *setting) {
+	config_setting_t *element, *elementCopy;
+	const char *name;
+	int i, success;
+
+	switch (config_setting_type(setting)) {
+	case CONFIG_TYPE_GROUP:
+	case CONFIG_TYPE_LIST:
+	case CONFIG_TYPE_ARRAY:
+		for (i = 0; i < config_setting_length(setting); i++) {
+			element = config_setting_get_elem(setting, i);
+			name = (config_setting_is_group(setting) ?
+					config_setting_name(element) : NULL);
+			elementCopy = config_setting_add(copy, name,
+					config_setting_type(element));
+			if (elementCopy == NULL
+					|| pfm_copySetting(elementCopy, element) != COMMON_TYPE_SUCCESS) {
+				return COMMON_TYPE_ERR;
+			}
+		}
+		return COMMON_TYPE_SUCCESS;
+	case CONFIG_TYPE_INT:
+		success = config_setting_set_int(copy, config_setting_get_int(setting));
+		break;
+	case CONFIG_TYPE_INT64:
+		success = config_setting_set_int64(copy,
+				config_setting_get_int64(setting));
+		break;
+	case CONFIG_TYPE_FLOAT:
+		success = config_setting_set_float(copy,
+				config_setting_get_float(setting));
+		break;
+	case CONFIG_TYPE_BOOL:
+		success = config_setting_set_bool(copy, config_setting_get_bool(setting));
+		break;
+	case CONFIG_TYPE_STRING:
+		success = config_setting_set_string(copy,
+				config_setting_get_string(setting));
+		break;
+	default:
+		success = CONFIG_FALSE;
+	}
+	return success == CONFIG_TRUE ? COMMON_TYPE_SUCCESS : COMMON_TYPE_ERR;
+}
+
+/**
+ * @brief Returns a copy of the given string
+ * @param str The string to copy
+ * @return The copy, which has to be freed, or NULL if no memory is available
+ */
+static char * pfm_copyString(const char *str) {
+	char *copy;
+
+	assert(str != NULL);
+
+	copy = malloc(strlen(str) + 1);
+	if (copy != NULL) {
+		strcpy(copy, str);
+	}
+	return copy;
+}
+
 /**
  * @brief Loads and initializes the application module and adds it to the global
  * list.
@@ -328,6 +1075,11 @@ static int pfm_loadAppModule(const char* name) {
 	pfm_app_t *app;
 	fieldbus_application_init_t init;
 	common_type_error_t err;
+	/* Used to fix the POSIX - C99 conflict */
+	union {
+		void* vPtr;
+		fieldbus_application_initContext_t initContextPtr;
+	} ptrWorkaround;
 
 	assert(name != NULL);
 
@@ -342,7 +1094,12 @@ static int pfm_loadAppModule(const char* name) {
 	app = &pfm_appVector[pfm_appVectorLength - 1];
 	memset(app, 0, sizeof(app[0]));
 
-	app->name = name;
+	app->name = pfm_copyString(name);
+	if (app->name == NULL) {
+		pfm_appVectorRollback();
+		logging_adapter_info("Can't obtain more memory");
+		return -1 ;
+	}
 	app->handler = dlopen(name, RTLD_NOW);
 	if (app->handler == NULL ) {
 		pfm_appVectorRollback();
@@ -351,13 +1108,21 @@ static int pfm_loadAppModule(const char* name) {
 		return -1 ;
 	}
 
-	init = pfm_lookupAppInterfaceFunctions(app);
-	if (init == NULL ) {
-		pfm_appVectorRollback();
-		return -1 ;
+	// Prefer the context variant, if available
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_INIT_CONTEXT_NAME);
+	if (dlerror() == NULL && ptrWorkaround.vPtr != NULL) {
+		err = pfm_installAppContext(app, ptrWorkaround.initContextPtr);
+	} else {
+		init = pfm_lookupAppInterfaceFunctions(app);
+		if (init == NULL ) {
+			pfm_appVectorRollback();
+			return -1 ;
+		}
+		err = init();
 	}
 
-	err = init();
 	if (err != COMMON_TYPE_SUCCESS) {
 		pfm_appVectorRollback();
 		logging_adapter_info("Can't initialize the \"%s\" module (err-no: %d)",
@@ -440,9 +1205,153 @@ static inline fieldbus_application_init_t pfm_lookupAppInterfaceFunctions(
 		return NULL ;
 	}
 
+	if (!pfm_lookupAppCompileFunctions(app)) {
+		return NULL ;
+	}
+
 	return ret;
 }
 
+/**
+ * @brief Tries to lookup the optional functions handling compiled addresses
+ * @details If the module doesn't provide any of the functions, the function
+ * references remain NULL. If only one of them is provided, an error will be
+ * reported. The requirements of pfm_lookupAppInterfaceFunctions apply.
+ * @param app The reference to the application structure to manipulate
+ * @return 1 on success, 0 if the module provides an incomplete interface
+ */
+static inline int pfm_lookupAppCompileFunctions(pfm_app_t *app) {
+	union {
+		void* vPtr;
+		fieldbus_application_compileAddress_t compilePtr;
+		fieldbus_application_fetchCompiled_t fetchPtr;
+		fieldbus_application_fetchValues_t fetchValuesPtr;
+	} ptrWorkaround;
+
+	assert(app != NULL);
+	assert(app->handler != NULL);
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_COMPILE_ADDRESS_NAME);
+	app->compileAddress = dlerror() == NULL ? ptrWorkaround.compilePtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_FETCH_COMPILED_NAME);
+	app->fetchCompiled = dlerror() == NULL ? ptrWorkaround.fetchPtr : NULL;
+
+	if ((app->compileAddress == NULL) != (app->fetchCompiled == NULL)) {
+		logging_adapter_info("The fieldbus application module \"%s\" has to "
+				"provide both, the \"%s\" and the \"%s\" function", app->name,
+				FIELDBUS_APPLICATION_COMPILE_ADDRESS_NAME,
+				FIELDBUS_APPLICATION_FETCH_COMPILED_NAME);
+		return 0;
+	}
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_FETCH_VALUES_NAME);
+	app->fetchValues = dlerror() == NULL ? ptrWorkaround.fetchValuesPtr : NULL;
+
+	if (app->fetchValues != NULL && app->compileAddress == NULL) {
+		logging_adapter_info("The fieldbus application module \"%s\" provides "
+				"the \"%s\" function without supporting compiled addresses",
+				app->name, FIELDBUS_APPLICATION_FETCH_VALUES_NAME);
+		return 0;
+	}
+
+	if (app->compileAddress != NULL) {
+		logging_adapter_debug("Module \"%s\" supports compiled addresses%s",
+				app->name, app->fetchValues != NULL ? " and batch fetching" : "");
+	}
+	return 1;
+}
+
+/**
+ * @brief Looks up the context variant's functions and creates the context
+ * @details Every function except fetchValuesContext and getMacContext is
+ * mandatory. If one of
+ * them is missing, an error is reported and the context isn't created. The
+ * requirements of pfm_lookupAppInterfaceFunctions apply.
+ * @param app The reference to the application structure to manipulate
+ * @param initContext The module's valid initContext function
+ * @return The status of the operation
+ */
+static inline common_type_error_t pfm_installAppContext(pfm_app_t *app,
+		fieldbus_application_initContext_t initContext) {
+	fieldbus_application_context_t context;
+	common_type_error_t err;
+	/* Used to fix the POSIX - C99 conflict */
+	union {
+		void* vPtr;
+		fieldbus_application_syncContext_t syncPtr;
+		fieldbus_application_compileContext_t compilePtr;
+		fieldbus_application_fetchContext_t fetchPtr;
+		fieldbus_application_fetchValuesContext_t fetchValuesPtr;
+		fieldbus_application_getMacContext_t getMacPtr;
+		fieldbus_application_freeContext_t freePtr;
+	} ptrWorkaround;
+
+	assert(app != NULL);
+	assert(app->handler != NULL);
+	assert(app->name != NULL);
+	assert(initContext != NULL);
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_SYNC_CONTEXT_NAME);
+	app->syncContext = dlerror() == NULL ? ptrWorkaround.syncPtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_COMPILE_CONTEXT_NAME);
+	app->compileContext = dlerror() == NULL ? ptrWorkaround.compilePtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_FETCH_CONTEXT_NAME);
+	app->fetchContext = dlerror() == NULL ? ptrWorkaround.fetchPtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_FETCH_VALUES_CONTEXT_NAME);
+	app->fetchValuesContext =
+			dlerror() == NULL ? ptrWorkaround.fetchValuesPtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_GET_MAC_CONTEXT_NAME);
+	app->getMacContext = dlerror() == NULL ? ptrWorkaround.getMacPtr : NULL;
+
+	(void) dlerror();
+	ptrWorkaround.vPtr = dlsym(app->handler,
+			FIELDBUS_APPLICATION_FREE_CONTEXT_NAME);
+	app->freeContext = dlerror() == NULL ? ptrWorkaround.freePtr : NULL;
+
+	if (app->syncContext == NULL || app->compileContext == NULL
+			|| app->fetchContext == NULL || app->freeContext == NULL) {
+		logging_adapter_info("The fieldbus application module \"%s\" has to "
+				"provide the \"%s\", \"%s\", \"%s\" and \"%s\" function together "
+				"with \"%s\"", app->name, FIELDBUS_APPLICATION_SYNC_CONTEXT_NAME,
+				FIELDBUS_APPLICATION_COMPILE_CONTEXT_NAME,
+				FIELDBUS_APPLICATION_FETCH_CONTEXT_NAME,
+				FIELDBUS_APPLICATION_FREE_CONTEXT_NAME,
+				FIELDBUS_APPLICATION_INIT_CONTEXT_NAME);
+		return COMMON_TYPE_ERR_LOAD_MODULE;
+	}
+
+	err = initContext(&context);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+	app->context = context;
+
+	logging_adapter_debug("Module \"%s\" provides contexts%s", app->name,
+			app->fetchValuesContext != NULL ? " and batch fetching" : "");
+	return COMMON_TYPE_SUCCESS;
+}
+
 /**
  * @brief Fetches the application layer module with the given name.
  * @details It assumes that the given driverName reference isn't null. If the
@@ -474,6 +1383,7 @@ static void pfm_appVectorRollback(void) {
 	assert(pfm_appVectorLength > 0);
 	pfm_app_t * oldVector = pfm_appVector;
 	pfm_appVectorLength--;
+	free(pfm_appVector[pfm_appVectorLength].name);
 	pfm_appVector = realloc(pfm_appVector,
 			pfm_appVectorLength * sizeof(oldVector[0]));
 	if (pfm_appVector == NULL ) {
@@ -483,21 +1393,82 @@ static void pfm_appVectorRollback(void) {
 
 common_type_error_t pfm_sync() {
 	unsigned int i;
-	common_type_error_t err;
 
-	// Sync MAC layer
 	for (i = 0; i < pfm_macVectorLength; i++) {
-		err = pfm_macVector[i].sync();
-		if (err != COMMON_TYPE_SUCCESS) {
-			logging_adapter_info("The MAC module nr. %d can't be synchronized "
-					"correctly.", i + 1);
-			return err;
+		pfm_macVector[i].due = 1;
+	}
+	for (i = 0; i < pfm_appVectorLength; i++) {
+		pfm_appVector[i].due = 1;
+	}
+
+	return pfm_syncDue();
+}
+
+common_type_error_t pfm_syncChannels(const int *ids, unsigned int count) {
+	unsigned int i;
+	int macIndex;
+
+	assert(ids != NULL || count == 0);
+
+	for (i = 0; i < pfm_macVectorLength; i++) {
+		pfm_macVector[i].due = 0;
+	}
+	for (i = 0; i < pfm_appVectorLength; i++) {
+		pfm_appVector[i].due = 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		assert(ids[i] >= 0 && ids[i] < pfm_channelVectorLength);
+
+		pfm_appVector[pfm_channelApps[ids[i]]].due = 1;
+		macIndex = pfm_channelMacs[ids[i]];
+		if (macIndex >= 0) {
+			pfm_macVector[macIndex].due = 1;
+		} else {
+			return pfm_sync();
 		}
 	}
 
+	return pfm_syncDue();
+}
+
+/**
+ * @brief Synchronizes every module marked as due
+ * @details The MAC modules will be synchronized before the application modules.
+ * Independent MAC modules are synchronized concurrently if worker threads are
+ * available. Every due MAC module is synchronized even if another one fails,
+ * but the application modules are skipped in this case. If one application
+ * module fails, the function returns immediately.
+ * @return The status of the operation
+ */
+static common_type_error_t pfm_syncDue(void) {
+	unsigned int i;
+	common_type_error_t err;
+
+	// Sync MAC layer
+	pfm_syncNext = 0;
+	pfm_syncError = COMMON_TYPE_SUCCESS;
+	if (pfm_syncThreads != NULL) {
+		(void) pthread_barrier_wait(&pfm_syncStart);
+		pfm_runSyncTasks();
+		(void) pthread_barrier_wait(&pfm_syncDone);
+	} else {
+		pfm_runSyncTasks();
+	}
+	if (pfm_syncError != COMMON_TYPE_SUCCESS) {
+		return pfm_syncError;
+	}
+
 	// Sync App layer
 	for (i = 0; i < pfm_appVectorLength; i++) {
-		err = pfm_appVector[i].sync();
+		if (!pfm_appVector[i].due) {
+			continue;
+		}
+		if (pfm_appVector[i].syncContext != NULL) {
+			err = pfm_appVector[i].syncContext(pfm_appVector[i].context);
+		} else {
+			err = pfm_appVector[i].sync();
+		}
 		if (err != COMMON_TYPE_SUCCESS) {
 			logging_adapter_info("The Application module nr. %d can't be "
 					"synchronized correctly.", i + 1);
@@ -508,17 +1479,237 @@ common_type_error_t pfm_sync() {
 	return COMMON_TYPE_SUCCESS;
 }
 
+/**
+ * @brief Synchronizes the due MAC groups until no one is left
+ * @details The function is executed by every thread of the pool concurrently.
+ * Each group is taken by exactly one thread. The first error is stored within
+ * pfm_syncError.
+ */
+static void pfm_runSyncTasks(void) {
+	unsigned int group;
+	common_type_error_t err;
+
+	for (;;) {
+		(void) pthread_mutex_lock(&pfm_syncLock);
+		while (pfm_syncNext < pfm_macVectorLength
+				&& pfm_macVector[pfm_syncNext].syncGroup != pfm_syncNext) {
+			pfm_syncNext++;
+		}
+		group = pfm_syncNext++;
+		(void) pthread_mutex_unlock(&pfm_syncLock);
+
+		if (group >= pfm_macVectorLength) {
+			break;
+		}
+
+		err = pfm_syncMacGroup(group);
+		if (err != COMMON_TYPE_SUCCESS) {
+			(void) pthread_mutex_lock(&pfm_syncLock);
+			if (pfm_syncError == COMMON_TYPE_SUCCESS) {
+				pfm_syncError = err;
+			}
+			(void) pthread_mutex_unlock(&pfm_syncLock);
+		}
+	}
+}
+
+/**
+ * @brief Synchronizes the due MAC modules of a single group sequentially
+ * @details The latency of each synchronization is measured using the monotonic
+ * clock. If one module fails, the remaining modules of the group are skipped.
+ * @param group The index of the group's first MAC entry
+ * @return The status of the operation
+ */
+static common_type_error_t pfm_syncMacGroup(unsigned int group) {
+	unsigned int i;
+	common_type_error_t err;
+	struct timespec start, end;
+	int64_t latency;
+
+	for (i = group; i < pfm_macVectorLength; i++) {
+		if (pfm_macVector[i].syncGroup != group || !pfm_macVector[i].due) {
+			continue;
+		}
+
+		(void) clock_gettime(CLOCK_MONOTONIC, &start);
+		if (pfm_macVector[i].syncContext != NULL) {
+			err = pfm_macVector[i].syncContext(pfm_macVector[i].context);
+		} else {
+			err = pfm_macVector[i].sync();
+		}
+		(void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+		latency = (int64_t) (end.tv_sec - start.tv_sec) * 1000000000
+				+ (end.tv_nsec - start.tv_nsec);
+		pfm_macVector[i].syncCount++;
+		pfm_macVector[i].lastLatency = latency;
+		pfm_macVector[i].totalLatency += latency;
+		if (latency > pfm_macVector[i].maxLatency) {
+			pfm_macVector[i].maxLatency = latency;
+		}
+
+		if (err != COMMON_TYPE_SUCCESS) {
+			logging_adapter_info("The MAC module nr. %u can't be synchronized "
+					"correctly.", i + 1);
+			return err;
+		}
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Reports the sync latency of each MAC module
+ */
+static inline void pfm_logMacStatistics(void) {
+	unsigned int i;
+
+	for (i = 0; i < pfm_macVectorLength; i++) {
+		if (pfm_macVector[i].syncCount == 0) {
+			continue;
+		}
+		logging_adapter_info("MAC module nr. %u: %lu sync(s), latency average "
+				"%.3f ms, maximum %.3f ms, last %.3f ms", i + 1,
+				pfm_macVector[i].syncCount,
+				pfm_macVector[i].totalLatency / 1e6 / pfm_macVector[i].syncCount,
+				pfm_macVector[i].maxLatency / 1e6,
+				pfm_macVector[i].lastLatency / 1e6);
+	}
+}
+
 common_type_t pfm_fetchValue(int id) {
-	fieldbus_application_fetchValue_t fetch;
+	const pfm_app_t *app;
+
+	assert(id >= 0);
+	assert(id < pfm_channelVectorLength);
+	assert(pfm_channelApps[id] < pfm_appVectorLength);
+
+	app = &pfm_appVector[pfm_channelApps[id]];
+	if (app->fetchContext != NULL) {
+		return app->fetchContext(app->context, pfm_channelHandles[id]);
+	}
+	if (app->fetchCompiled != NULL) {
+		return app->fetchCompiled(pfm_channelHandles[id]);
+	}
+	assert(pfm_channelAddresses[id] != NULL);
+	return app->fetchValue(pfm_channelAddresses[id]);
+}
+
+common_type_error_t pfm_fetchValues(const int *ids, common_type_t *results,
+		unsigned int count) {
+	common_type_error_t err;
+	unsigned int i, start, end;
+	int consecutive;
+	const fieldbus_application_handle_t *handles;
+	const pfm_app_t *app;
+
+	assert(ids != NULL || count == 0);
+	assert(results != NULL || count == 0);
+
+	err = pfm_reserveBatch(count);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	// Fetch run by run, batch capable modules get every channel of a run at once
+	for (start = 0; start < count; start = end) {
+		end = pfm_getBatchEnd(ids, start, count, &consecutive);
+		app = &pfm_appVector[pfm_channelApps[ids[start]]];
+
+		if (app->fetchValuesContext != NULL || app->fetchValues != NULL) {
+			handles = &pfm_channelHandles[ids[start]];
+			if (!consecutive) {
+				for (i = start; i < end; i++) {
+					pfm_batchHandles[i] = pfm_channelHandles[ids[i]];
+				}
+				handles = &pfm_batchHandles[start];
+			}
+			if (app->fetchValuesContext != NULL) {
+				app->fetchValuesContext(app->context, handles, &results[start],
+						end - start);
+			} else {
+				app->fetchValues(handles, &results[start], end - start);
+			}
+		} else {
+			for (i = start; i < end; i++) {
+				results[i] = pfm_fetchValue(ids[i]);
+			}
+		}
+
+		for (i = start; i < end; i++) {
+			pfm_channelLastValues[ids[i]] = results[i];
+			pfm_channelStats[ids[i]].fetches++;
+			if (results[i].type == COMMON_TYPE_ERROR) {
+				pfm_channelStats[ids[i]].errors++;
+			}
+		}
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Finds the end of a run of channels sharing their application module
+ * @param ids The identifiers of the channels
+ * @param start The position of the run's first channel
+ * @param count The number of channels
+ * @param consecutive The location receiving a flag which indicates that the
+ * run's channels are stored consecutively within the channel vectors
+ * @return The position behind the run's last channel
+ */
+static inline unsigned int pfm_getBatchEnd(const int *ids, unsigned int start,
+		unsigned int count, int *consecutive) {
+	unsigned int end, appIndex;
+
+	assert(start < count);
+	assert(ids[start] >= 0 && ids[start] < pfm_channelVectorLength);
+
+	appIndex = pfm_channelApps[ids[start]];
+	*consecutive = 1;
+	for (end = start + 1; end < count; end++) {
+		assert(ids[end] >= 0 && ids[end] < pfm_channelVectorLength);
+		if (pfm_channelApps[ids[end]] != appIndex)
+			break;
+		*consecutive &= (ids[end] == ids[end - 1] + 1);
+	}
+	return end;
+}
+
+common_type_t pfm_getLastValue(int id) {
+	assert(id >= 0);
+	assert(id < pfm_channelVectorLength);
+
+	return pfm_channelLastValues[id];
+}
 
+const pfm_channel_statistics_t * pfm_getChannelStatistics(int id) {
 	assert(id >= 0);
 	assert(id < pfm_channelVectorLength);
-	assert(pfm_channelVector[id].address != NULL);
-	assert(pfm_channelVector[id].appIndex >= 0);
-	assert(pfm_channelVector[id].appIndex < pfm_appVectorLength);
 
-	fetch = pfm_appVector[pfm_channelVector[id].appIndex].fetchValue;
-	return fetch(pfm_channelVector[id].address);
+	return &pfm_channelStats[id];
+}
+
+/**
+ * @brief Ensures that the batch vector is able to hold count elements
+ * @details The vector is only enlarged, so the allocation is usually done
+ * once while fetching the first sample.
+ * @param count The number of elements needed
+ * @return The status of the operation
+ */
+static inline common_type_error_t pfm_reserveBatch(unsigned int count) {
+	fieldbus_application_handle_t *handles;
+
+	if (count <= pfm_batchCapacity)
+		return COMMON_TYPE_SUCCESS;
+
+	handles = realloc(pfm_batchHandles, count * sizeof(handles[0]));
+	if (handles == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	pfm_batchHandles = handles;
+	pfm_batchCapacity = count;
+	return COMMON_TYPE_SUCCESS;
 }
 
 common_type_error_t pfm_free() {
@@ -528,11 +1719,34 @@ common_type_error_t pfm_free() {
 		err = pfm_freeAppModules();
 	}
 
-	free(pfm_channelVector);
-	pfm_channelVector = NULL;
+	free(pfm_channelApps);
+	free(pfm_channelMacs);
+	free(pfm_channelHandles);
+	free(pfm_channelAddresses);
+	free(pfm_channelLastValues);
+	free(pfm_channelStats);
+	pfm_channelApps = NULL;
+	pfm_channelMacs = NULL;
+	pfm_channelHandles = NULL;
+	pfm_channelAddresses = NULL;
+	pfm_channelLastValues = NULL;
+	pfm_channelStats = NULL;
 	pfm_channelVectorLength = 0;
+	pfm_channelCapacity = 0;
+	pfm_channelMacsAmbiguous = 0;
+	if (pfm_addressConfigValid) {
+		config_destroy(&pfm_addressConfig);
+		pfm_addressConfigValid = 0;
+	}
+
+	free(pfm_batchHandles);
+	pfm_batchHandles = NULL;
+	pfm_batchCapacity = 0;
+
+	pfm_stopSyncThreads();
 
 	if (pfm_macVector != NULL ) {
+		pfm_logMacStatistics();
 		tmpErr = pfm_freeMac();
 		err = (tmpErr == COMMON_TYPE_SUCCESS ? err : tmpErr);
 	}
@@ -555,7 +1769,11 @@ static inline common_type_error_t pfm_freeAppModules() {
 	assert(pfm_appVector != NULL || pfm_appVectorLength == 0);
 
 	for (i = 0; i < pfm_appVectorLength; i++) {
-		if (pfm_appVector[i].free != NULL ) {
+		if (pfm_appVector[i].freeContext != NULL ) {
+			tmpErr = pfm_appVector[i].freeContext(pfm_appVector[i].context);
+			lastErr = (tmpErr == COMMON_TYPE_SUCCESS ? lastErr : tmpErr);
+			err |= (tmpErr == COMMON_TYPE_SUCCESS ? 0 : 1);
+		} else if (pfm_appVector[i].free != NULL ) {
 			tmpErr = pfm_appVector[i].free();
 			lastErr = (tmpErr == COMMON_TYPE_SUCCESS ? lastErr : tmpErr);
 			err |= (tmpErr == COMMON_TYPE_SUCCESS ? 0 : 1);
@@ -563,6 +1781,7 @@ static inline common_type_error_t pfm_freeAppModules() {
 		if (pfm_appVector[i].handler != NULL ) {
 			err |= dlclose(pfm_appVector[i].handler);
 		}
+		free(pfm_appVector[i].name);
 	}
 
 	free(pfm_appVector);
@@ -596,7 +1815,11 @@ static inline common_type_error_t pfm_freeMac() {
 	err = 0;
 	for (i = 0; i < pfm_macVectorLength; i++) {
 
-		if (pfm_macVector[i].free != NULL ) {
+		if (pfm_macVector[i].freeContext != NULL ) {
+			tmpErr = pfm_macVector[i].freeContext(pfm_macVector[i].context);
+			err |= (tmpErr == COMMON_TYPE_SUCCESS ? 0 : 1);
+			lastErr = (tmpErr == COMMON_TYPE_SUCCESS ? lastErr : tmpErr);
+		} else if (pfm_macVector[i].free != NULL ) {
 			tmpErr = pfm_macVector[i].free();
 			err |= (tmpErr == COMMON_TYPE_SUCCESS ? 0 : 1);
 			lastErr = (tmpErr == COMMON_TYPE_SUCCESS ? lastErr : tmpErr);
@@ -605,6 +1828,7 @@ static inline common_type_error_t pfm_freeMac() {
 		if (pfm_macVector[i].handler != NULL ) {
 			err |= dlclose(pfm_macVector[i].handler);
 		}
+		free(pfm_macVector[i].id);
 	}
 
 	free(pfm_macVector);
@@ -5,7 +5,11 @@
  * @details Each remote variable, called channel, will be identified using an
  * unique integer value. During initialization configured MAC layer modules will
  * be added. Afterwards each channel has to be registered using the addChannel
- * functions.
+ * functions. A channel may name the MAC module it depends on by referencing the
+ * module's id. Thus, only the modules needed by a set of channels are
+ * synchronized. Once every channel is added, the channels may be ordered by
+ * the modules they depend on, so fetching a sample walks the channels
+ * linearly.
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -31,11 +35,20 @@
 #include <common-type.h>
 #include <libconfig.h>
 
+/** @brief The statistics of a single channel */
+typedef struct {
+	/** @brief The number of values fetched by pfm_fetchValues() */
+	unsigned long fetches;
+	/** @brief The number of fetches returning an error */
+	unsigned long errors;
+} pfm_channel_statistics_t;
+
 /**
  * @brief Initializes the network stack
  * @details Dynamically loads the fieldbus MAC modules and tries to initialize
  * them. The function has to be called once before any other function of the
- * module. It requires the logging facilities to be properly initialized.
+ * module. It requires the logging facilities to be properly initialized. The
+ * configuration isn't referenced after returning.
  * @param configuration The root configuration used to obtain needed values
  * @return The status of the operation.
  */
@@ -45,13 +58,30 @@ common_type_error_t pfm_init(
 /**
  * @brief Opens a new virtual channel
  * @details If the channel uses a new fieldbus application module it will be
- * loaded dynamically.
+ * loaded dynamically. The configuration isn't referenced after returning.
+ * The identifiers are assigned in ascending order starting at zero, so they may
+ * index vectors kept by the caller.
  * @param channelConf The configuration snippet describing the channel.
  * @return The unique channel identifier or a negative number if the operation
  * failed
  */
 int pfm_addChannel(config_setting_t* channelConf);
 
+/**
+ * @brief Orders the channels by the modules they depend on
+ * @details The channels are sorted by their MAC module and, within each MAC
+ * module, by their application module. The order of channels depending on the
+ * same modules is kept and channels depending on every MAC module are placed
+ * last. The function has to be called once after every channel is added.
+ * Afterwards, the channels are identified by their position instead of the
+ * identifier returned by pfm_addChannel().
+ * @param previousIDs The vector receiving the identifier each channel was
+ * added with, indexed by the channel's new identifier. It has to be able to
+ * hold an element per channel.
+ * @return The status of the operation
+ */
+common_type_error_t pfm_orderChannels(unsigned int *previousIDs);
+
 /**
  * @brief Synchronizes every channel
  * @details The function has to be called before reading one or more values. It
@@ -62,16 +92,66 @@ int pfm_addChannel(config_setting_t* channelConf);
  */
 common_type_error_t pfm_sync(void);
 
+/**
+ * @brief Synchronizes the modules needed to read the given channels
+ * @details The function behaves like pfm_sync() but only synchronizes the MAC
+ * modules the channels depend on as well as the application modules of the
+ * channels. A channel not naming it's MAC module depends on the MAC module
+ * derived while adding it. If it can't be derived, the channel depends on every
+ * MAC module.
+ * @param ids The vector of valid channel identifiers
+ * @param count The number of channel identifiers
+ * @return The status of the operation
+ */
+common_type_error_t pfm_syncChannels(const int *ids, unsigned int count);
+
 /**
  * @brief Fetches the value from the given channel.
  * @details The sync function has to be called before but not necessarily
  * directly before calling this function. Reading a channel more than once after
- * the sync signal may return inconsistent results.
+ * the sync signal may return inconsistent results. Channels of application
+ * modules providing contexts may be read by several threads concurrently, as
+ * long as no sync is in progress.
  * @param id The unique channel identifier
  * @return The read value or an error code.
  */
 common_type_t pfm_fetchValue(int id);
 
+/**
+ * @brief Fetches the values of several channels at once.
+ * @details The function behaves like calling pfm_fetchValue() for each channel.
+ * Consecutive channels of an application module supporting batch fetching are
+ * passed to the module in a single call. Hence, the identifiers should be
+ * passed in ascending order after the channels were ordered by
+ * pfm_orderChannels(). A channel which can't be read is reported by it's
+ * result only. The result and the statistics of each channel are kept. Unlike
+ * pfm_fetchValue(), the function mustn't be called by several threads
+ * concurrently.
+ * @param ids The vector of valid channel identifiers
+ * @param results The vector receiving the read values or error codes
+ * @param count The number of elements within both vectors
+ * @return The status of the operation, e.g. an error if no memory is left
+ */
+common_type_error_t pfm_fetchValues(const int *ids, common_type_t *results,
+		unsigned int count);
+
+/**
+ * @brief Returns the value fetched last by pfm_fetchValues()
+ * @details If the channel wasn't fetched yet, an error is returned. A string
+ * is only valid until the channel's modules are synchronized again.
+ * @param id The unique channel identifier
+ * @return The value or error fetched last
+ */
+common_type_t pfm_getLastValue(int id);
+
+/**
+ * @brief Returns the statistics of a channel
+ * @details The statistics are updated by pfm_fetchValues().
+ * @param id The unique channel identifier
+ * @return The valid reference to the channel's statistics
+ */
+const pfm_channel_statistics_t * pfm_getChannelStatistics(int id);
+
 /**
  * @brief Frees used resources.
  * @details After calling the function only init, reconfiguring the module, may
@@ -0,0 +1,190 @@
+/**
+ * @file reactor.c
+ * @brief Implements the epoll based event loop
+ * @details The epoll data of each registered file descriptor references the
+ * source structure. Events are fetched in batches; removing a source clears
+ * the source's events left within the current batch so that no handler is
+ * called for a source already freed.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "reactor.h"
+
+#include <logging-adapter.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/** @brief The maximum number of events fetched at once */
+#define REACTOR_MAX_EVENTS 16
+
+/** @brief Structure containing the reactor's state */
+static struct {
+	/** @brief The epoll instance or -1 if it isn't initialized */
+	int epollFd;
+	/** @brief The events fetched within the current dispatch round */
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+	/** @brief The number of valid events */
+	int eventCount;
+	/** @brief The events fetched by reactor_poll within a handler */
+	struct epoll_event nestedEvents[REACTOR_MAX_EVENTS];
+	/** @brief The number of valid nested events */
+	int nestedCount;
+	/** @brief Flag indicating that reactor_poll is dispatching events */
+	unsigned int polling :1;
+	/** @brief Flag indicating that reactor_run has to return */
+	unsigned int stop :1;
+} reactor_cData = { .epollFd = -1 };
+
+common_type_error_t reactor_init(void) {
+	assert(reactor_cData.epollFd < 0);
+
+	reactor_cData.epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (reactor_cData.epollFd < 0) {
+		logging_adapter_info("Can't create the epoll instance: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+	reactor_cData.eventCount = 0;
+	reactor_cData.nestedCount = 0;
+	reactor_cData.polling = 0;
+	reactor_cData.stop = 0;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t reactor_add(reactor_source_t *source, uint32_t events) {
+	struct epoll_event event;
+
+	assert(reactor_cData.epollFd >= 0);
+	assert(source != NULL && source->handler != NULL);
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.ptr = source;
+	if (epoll_ctl(reactor_cData.epollFd, EPOLL_CTL_ADD, source->fd, &event)
+			!= 0) {
+		logging_adapter_info("Can't watch file descriptor %d: %s", source->fd,
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+void reactor_remove(reactor_source_t *source) {
+	int i;
+
+	assert(reactor_cData.epollFd >= 0);
+	assert(source != NULL);
+
+	if (epoll_ctl(reactor_cData.epollFd, EPOLL_CTL_DEL, source->fd, NULL)
+			!= 0) {
+		logging_adapter_debug("Can't remove file descriptor %d: %s", source->fd,
+				strerror(errno));
+	}
+
+	for (i = 0; i < reactor_cData.eventCount; i++) {
+		if (reactor_cData.events[i].data.ptr == source) {
+			reactor_cData.events[i].data.ptr = NULL;
+		}
+	}
+	for (i = 0; i < reactor_cData.nestedCount; i++) {
+		if (reactor_cData.nestedEvents[i].data.ptr == source) {
+			reactor_cData.nestedEvents[i].data.ptr = NULL;
+		}
+	}
+}
+
+common_type_error_t reactor_run(void) {
+	reactor_source_t *source;
+	int i;
+
+	assert(reactor_cData.epollFd >= 0);
+
+	reactor_cData.stop = 0;
+	while (!reactor_cData.stop) {
+		reactor_cData.eventCount = epoll_wait(reactor_cData.epollFd,
+				reactor_cData.events, REACTOR_MAX_EVENTS, -1);
+		if (reactor_cData.eventCount < 0) {
+			reactor_cData.eventCount = 0;
+			if (errno == EINTR)
+				continue;
+
+			logging_adapter_info("Can't wait for events: %s", strerror(errno));
+			return COMMON_TYPE_ERR_IO;
+		}
+
+		for (i = 0; i < reactor_cData.eventCount; i++) {
+			source = reactor_cData.events[i].data.ptr;
+			if (source != NULL) {
+				source->handler(source, reactor_cData.events[i].events);
+			}
+		}
+		reactor_cData.eventCount = 0;
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t reactor_poll(const reactor_source_t *busy) {
+	reactor_source_t *source;
+	int i;
+
+	assert(reactor_cData.epollFd >= 0);
+	assert(!reactor_cData.polling);
+
+	reactor_cData.nestedCount = epoll_wait(reactor_cData.epollFd,
+			reactor_cData.nestedEvents, REACTOR_MAX_EVENTS, 0);
+	if (reactor_cData.nestedCount < 0) {
+		reactor_cData.nestedCount = 0;
+		if (errno != EINTR) {
+			logging_adapter_info("Can't poll for events: %s", strerror(errno));
+			return COMMON_TYPE_ERR_IO;
+		}
+	}
+
+	reactor_cData.polling = 1;
+	for (i = 0; i < reactor_cData.nestedCount; i++) {
+		source = reactor_cData.nestedEvents[i].data.ptr;
+		// The busy source stays pending until its handler returned
+		if (source != NULL && source != busy) {
+			source->handler(source, reactor_cData.nestedEvents[i].events);
+		}
+	}
+	reactor_cData.nestedCount = 0;
+	reactor_cData.polling = 0;
+
+	return reactor_cData.stop ? COMMON_TYPE_ERR : COMMON_TYPE_SUCCESS;
+}
+
+void reactor_stop(void) {
+	reactor_cData.stop = 1;
+}
+
+void reactor_free(void) {
+	if (reactor_cData.epollFd >= 0) {
+		(void) close(reactor_cData.epollFd);
+		reactor_cData.epollFd = -1;
+	}
+	reactor_cData.eventCount = 0;
+	reactor_cData.nestedCount = 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file reactor.h
+ * @brief Event loop multiplexing file descriptors on a single thread
+ * @details Every source of events the daemon reacts to, e.g. the timer
+ * triggering samples, the signals received and control connections, is
+ * represented by a file descriptor registered at the reactor. The reactor
+ * waits for all of them at once using epoll and dispatches each event to the
+ * handler of the source. Handlers are called sequentially, hence they must not
+ * block for long. The source structures are allocated by the caller and must
+ * remain valid until they are removed.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef REACTOR_H_
+#define REACTOR_H_
+
+#include <common-type.h>
+#include <stdint.h>
+
+struct reactor_source;
+
+/**
+ * @brief Handler called if a source has pending events
+ * @param source The source the events occurred at
+ * @param events The epoll event mask received
+ */
+typedef void (*reactor_handler_t)(struct reactor_source *source,
+		uint32_t events);
+
+/**
+ * @brief Structure defining a single source of events
+ * @details The reactor is compiled without packed structures since the kernel
+ * expects the natural layout of struct epoll_event on most platforms. The
+ * members are ordered by their alignment, hence the offsets are the same
+ * whether the structure is packed or not.
+ */
+typedef struct reactor_source {
+	/** @brief The handler processing the events of the source */
+	reactor_handler_t handler;
+	/** @brief User data associated with the source */
+	void *data;
+	/** @brief The file descriptor watched */
+	int fd;
+} reactor_source_t;
+
+/**
+ * @brief Initializes the reactor
+ * @details The function has to be called once before any other function of
+ * the module.
+ * @return The status of the operation
+ */
+common_type_error_t reactor_init(void);
+
+/**
+ * @brief Registers a source of events
+ * @details The fd, handler and data fields of the source have to be set
+ * before. Sources may be added within a handler.
+ * @param source The valid source to watch
+ * @param events The epoll event mask to watch for, e.g. EPOLLIN
+ * @return The status of the operation
+ */
+common_type_error_t reactor_add(reactor_source_t *source, uint32_t events);
+
+/**
+ * @brief Unregisters a previously added source
+ * @details The source may be removed and freed within any handler, including
+ * it's own. Events of the source which are pending within the current dispatch
+ * round are discarded. The file descriptor isn't closed.
+ * @param source The source to remove
+ */
+void reactor_remove(reactor_source_t *source);
+
+/**
+ * @brief Dispatches events until the reactor is stopped
+ * @details Waits interrupted by a signal are resumed.
+ * @return COMMON_TYPE_SUCCESS if the reactor was stopped, an error code if
+ * waiting for events failed.
+ */
+common_type_error_t reactor_run(void);
+
+/**
+ * @brief Dispatches the events pending without waiting
+ * @details The function is meant to be called by a handler which has to wait
+ * for a long time, so other sources such as signals are still served. Events
+ * of the busy source are left pending. The function must not be nested.
+ * @param busy The source whose handler is running or NULL
+ * @return COMMON_TYPE_SUCCESS if the events were dispatched, COMMON_TYPE_ERR
+ * if the reactor was requested to stop and an other error code if polling
+ * failed.
+ */
+common_type_error_t reactor_poll(const reactor_source_t *busy);
+
+/**
+ * @brief Requests to leave reactor_run
+ * @details The function is meant to be called by a handler. The events of the
+ * current dispatch round are still processed.
+ */
+void reactor_stop(void);
+
+/**
+ * @brief Frees the reactor's resources
+ * @details The sources registered aren't touched. It's safe to call the
+ * function even if the reactor wasn't initialized.
+ */
+void reactor_free(void);
+
+#endif /* REACTOR_H_ */
@@ -0,0 +1,159 @@
+/**
+ * @file ring-buffer.c
+ * @brief Implements the single-producer single-consumer ring
+ * @details The producer position is written by the producer only and read by
+ * the consumer, the consumer position vice versa. Publishing a slot stores the
+ * producer position with release semantics after the slot was written, the
+ * consumer loads it with acquire semantics before reading the slot. Releasing
+ * works the same way in the other direction. Since the producer may advance
+ * the consumer position to drop the oldest slot, the consumer position is
+ * updated by compare-and-swap on both sides. A successful release proves that
+ * the slot wasn't dropped before the consumer finished reading it.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ring-buffer.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief The assumed size of a cache line in bytes */
+#define RING_BUFFER_CACHE_LINE 64
+/** @brief The index of the producer's position */
+#define RING_BUFFER_HEAD 0
+/** @brief The index of the consumer's position, placed in another cache line */
+#define RING_BUFFER_TAIL (RING_BUFFER_CACHE_LINE / sizeof(uint64_t))
+
+common_type_error_t ring_buffer_init(ring_buffer_t *ring,
+		unsigned int slotCount, size_t slotSize) {
+	void *positions;
+
+	assert(ring != NULL);
+	assert(slotCount > 0);
+	assert(slotSize > 0);
+
+	memset(ring, 0, sizeof(*ring));
+	if (posix_memalign(&positions, RING_BUFFER_CACHE_LINE,
+			2 * RING_BUFFER_CACHE_LINE) != 0) {
+		return COMMON_TYPE_ERR;
+	}
+	ring->positions = positions;
+	ring->positions[RING_BUFFER_HEAD] = 0;
+	ring->positions[RING_BUFFER_TAIL] = 0;
+
+	ring->slots = calloc(slotCount, slotSize);
+	if (ring->slots == NULL) {
+		ring_buffer_free(ring);
+		return COMMON_TYPE_ERR;
+	}
+	ring->slotCount = slotCount;
+	ring->slotSize = slotSize;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+void * ring_buffer_reserve(ring_buffer_t *ring) {
+	uint64_t head, tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	head = __atomic_load_n(&ring->positions[RING_BUFFER_HEAD], __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->positions[RING_BUFFER_TAIL], __ATOMIC_ACQUIRE);
+	if (head - tail >= ring->slotCount)
+		return NULL;
+
+	return &ring->slots[(head % ring->slotCount) * ring->slotSize];
+}
+
+void ring_buffer_publish(ring_buffer_t *ring) {
+	uint64_t head, tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	head = __atomic_load_n(&ring->positions[RING_BUFFER_HEAD], __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->positions[RING_BUFFER_TAIL], __ATOMIC_RELAXED);
+	assert(head - tail < ring->slotCount);
+
+	__atomic_store_n(&ring->positions[RING_BUFFER_HEAD], head + 1,
+			__ATOMIC_RELEASE);
+
+	if (head + 1 - tail > ring->maxOccupancy) {
+		ring->maxOccupancy = head + 1 - tail;
+	}
+}
+
+int ring_buffer_dropOldest(ring_buffer_t *ring) {
+	uint64_t head, tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	head = __atomic_load_n(&ring->positions[RING_BUFFER_HEAD], __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->positions[RING_BUFFER_TAIL], __ATOMIC_ACQUIRE);
+	if (head == tail)
+		return 0;
+
+	return __atomic_compare_exchange_n(&ring->positions[RING_BUFFER_TAIL],
+			&tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void * ring_buffer_peek(ring_buffer_t *ring) {
+	uint64_t head, tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	tail = __atomic_load_n(&ring->positions[RING_BUFFER_TAIL], __ATOMIC_RELAXED);
+	head = __atomic_load_n(&ring->positions[RING_BUFFER_HEAD], __ATOMIC_ACQUIRE);
+	if (head == tail)
+		return NULL;
+
+	ring->peeked = tail;
+	return &ring->slots[(tail % ring->slotCount) * ring->slotSize];
+}
+
+int ring_buffer_release(ring_buffer_t *ring) {
+	uint64_t tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	// Fails if the producer dropped the slot since it was peeked at
+	tail = ring->peeked;
+	return __atomic_compare_exchange_n(&ring->positions[RING_BUFFER_TAIL],
+			&tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+unsigned int ring_buffer_getOccupancy(ring_buffer_t *ring) {
+	uint64_t head, tail;
+
+	assert(ring != NULL && ring->slots != NULL);
+
+	tail = __atomic_load_n(&ring->positions[RING_BUFFER_TAIL], __ATOMIC_ACQUIRE);
+	head = __atomic_load_n(&ring->positions[RING_BUFFER_HEAD], __ATOMIC_ACQUIRE);
+	return (unsigned int) (head - tail);
+}
+
+void ring_buffer_free(ring_buffer_t *ring) {
+	assert(ring != NULL);
+
+	free(ring->slots);
+	free(ring->positions);
+	ring->slots = NULL;
+	ring->positions = NULL;
+	ring->slotCount = 0;
+}
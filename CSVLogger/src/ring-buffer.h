@@ -0,0 +1,132 @@
+/**
+ * @file ring-buffer.h
+ * @brief Lock-free single-producer single-consumer ring of fixed-size slots
+ * @details The ring passes records from exactly one producing thread to
+ * exactly one consuming thread without any lock. The producer reserves a slot,
+ * fills it in place and publishes it. The consumer peeks at the oldest
+ * published slot, copies it and releases it. If the ring is full, the producer
+ * may drop the oldest slot instead of waiting. Hence, the consumer has to
+ * check the result of releasing the slot to find out whether the copy is
+ * consistent. Both sides only wait on each other by polling, any blocking
+ * wakeup has to be done by the caller. The positions of both sides are kept in
+ * separate cache lines to avoid false sharing.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <common-type.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Structure defining the ring */
+typedef struct {
+	/** @brief The storage of the slots */
+	uint8_t *slots;
+	/**
+	 * @brief The positions of the producer and the consumer
+	 * @details The positions are counted from the start and accessed
+	 * atomically only. They are stored separately since the fields of packed
+	 * structures may not be aligned.
+	 */
+	uint64_t *positions;
+	/** @brief The size of each slot in bytes */
+	size_t slotSize;
+	/** @brief The number of slots */
+	unsigned int slotCount;
+	/** @brief The consumer position of the slot peeked at, consumer only */
+	uint64_t peeked;
+	/** @brief The maximum number of slots published at once, producer only */
+	unsigned int maxOccupancy;
+} ring_buffer_t;
+
+/**
+ * @brief Allocates the slots of the ring
+ * @param ring The ring to initialize
+ * @param slotCount The number of slots, greater than zero
+ * @param slotSize The size of each slot in bytes, greater than zero
+ * @return The status of the operation
+ */
+common_type_error_t ring_buffer_init(ring_buffer_t *ring,
+		unsigned int slotCount, size_t slotSize);
+
+/**
+ * @brief Returns the next free slot without publishing it
+ * @details Producer only. Calling the function again without publishing the
+ * slot returns the same slot.
+ * @param ring The initialized ring
+ * @return The slot to fill or NULL if the ring is full
+ */
+void * ring_buffer_reserve(ring_buffer_t *ring);
+
+/**
+ * @brief Passes the slot reserved before to the consumer
+ * @details Producer only. Every write to the slot done before is visible to
+ * the consumer.
+ * @param ring The initialized ring
+ */
+void ring_buffer_publish(ring_buffer_t *ring);
+
+/**
+ * @brief Discards the oldest published slot to make room for a new one
+ * @details Producer only. The function fails if the consumer released the
+ * slot concurrently, so the caller should try to reserve a slot again.
+ * @param ring The initialized ring
+ * @return Non-zero if a slot was dropped
+ */
+int ring_buffer_dropOldest(ring_buffer_t *ring);
+
+/**
+ * @brief Returns the oldest published slot without releasing it
+ * @details Consumer only. The slot may be dropped and overwritten by the
+ * producer at any time, so it should be copied before being released.
+ * @param ring The initialized ring
+ * @return The slot to process or NULL if the ring is empty
+ */
+void * ring_buffer_peek(ring_buffer_t *ring);
+
+/**
+ * @brief Passes the slot returned by ring_buffer_peek back to the producer
+ * @details Consumer only. The slot must not be accessed afterwards.
+ * @param ring The initialized ring
+ * @return Non-zero if the slot was released, zero if the producer dropped it
+ * meanwhile. In the latter case, any data read from the slot has to be
+ * discarded.
+ */
+int ring_buffer_release(ring_buffer_t *ring);
+
+/**
+ * @brief Returns the number of slots published but not released yet
+ * @details The function may be called by either side. The value may be
+ * outdated as soon as it is returned.
+ * @param ring The initialized ring
+ * @return The current occupancy
+ */
+unsigned int ring_buffer_getOccupancy(ring_buffer_t *ring);
+
+/**
+ * @brief Frees the slots of the ring
+ * @details Neither side may access the ring afterwards. It's safe to free a
+ * ring which failed to initialize.
+ * @param ring The ring to free
+ */
+void ring_buffer_free(ring_buffer_t *ring);
+
+#endif /* RING_BUFFER_H_ */
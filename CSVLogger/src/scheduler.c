@@ -0,0 +1,209 @@
+/**
+ * @file scheduler.c
+ * @brief Implements the wall-clock aligned scheduler
+ * @details Every point in time is handled as nanoseconds since the epoch to
+ * avoid rounding errors on calculating aligned ticks. The ticks are waited for
+ * using an absolute clock_nanosleep or an absolute timer of the caller so the
+ * wakeup does not depend on the moment the wait was started.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scheduler.h"
+
+#include <logging-adapter.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+/** @brief The number of nanoseconds per second */
+#define SCHEDULER_NSEC_PER_SEC (1000000000LL)
+
+/** @brief The sampling interval in nanoseconds */
+static int64_t scheduler_interval = 0;
+
+/** @brief Structure containing the scheduler's state */
+static struct {
+	/** @brief The last tick reached in nanoseconds since the epoch */
+	int64_t lastTick;
+	/** @brief The tick currently waited for in nanoseconds since the epoch */
+	int64_t pendingTick;
+	/** @brief Flag indicating that the lastTick value is valid */
+	unsigned int lastTickValid :1;
+	/** @brief Flag indicating that the pendingTick value is valid */
+	unsigned int tickPending :1;
+} scheduler_cData;
+
+/** @brief The statistics collected */
+static scheduler_statistics_t scheduler_stats;
+
+/* Function prototypes */
+static inline common_type_error_t scheduler_now(int64_t *now);
+static inline int64_t scheduler_alignedTickAfter(int64_t time);
+static inline void scheduler_completeTick(void);
+
+common_type_error_t scheduler_init(int64_t interval) {
+	assert(interval > 0);
+
+	scheduler_interval = interval;
+	memset(&scheduler_cData, 0, sizeof(scheduler_cData));
+	memset(&scheduler_stats, 0, sizeof(scheduler_stats));
+	scheduler_stats.minSlack = INT64_MAX;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t scheduler_next(struct timespec *tick) {
+	common_type_error_t err;
+	int64_t now, next, missed;
+
+	assert(tick != NULL);
+	assert(scheduler_interval > 0);
+
+	err = scheduler_now(&now);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	if (scheduler_cData.tickPending) {
+		next = scheduler_cData.pendingTick;
+	} else if (scheduler_cData.lastTickValid) {
+		next = scheduler_cData.lastTick + scheduler_interval;
+		if (next - now < scheduler_stats.minSlack) {
+			scheduler_stats.minSlack = next - now;
+		}
+	} else {
+		next = scheduler_alignedTickAfter(now);
+	}
+
+	if (next <= now) {
+		// The cycle overran, skip every tick passed
+		missed = (now - next) / scheduler_interval + 1;
+		next += missed * scheduler_interval;
+		scheduler_stats.missedTicks += missed;
+		logging_adapter_info("Skipped %lli tick(s), %llu tick(s) missed in total",
+				(long long) missed, (unsigned long long) scheduler_stats.missedTicks);
+	} else if (next - now > scheduler_interval) {
+		logging_adapter_info("The wall-clock was set back, realign the schedule");
+		next = scheduler_alignedTickAfter(now);
+	}
+
+	scheduler_cData.pendingTick = next;
+	scheduler_cData.tickPending = 1;
+
+	tick->tv_sec = (time_t) (next / SCHEDULER_NSEC_PER_SEC);
+	tick->tv_nsec = (long) (next % SCHEDULER_NSEC_PER_SEC);
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t scheduler_wait(struct timespec *tick) {
+	common_type_error_t err;
+	int retCode;
+
+	assert(tick != NULL);
+
+	err = scheduler_next(tick);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	// The deadline is absolute, so an interrupted wait is simply resumed
+	do {
+		retCode = clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, tick, NULL);
+	} while (retCode == EINTR);
+	if (retCode != 0) {
+		logging_adapter_info("Can't wait for the next tick: %s",
+				strerror(retCode));
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	scheduler_completeTick();
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t scheduler_reached(struct timespec *tick) {
+	common_type_error_t err;
+	int64_t now;
+
+	assert(tick != NULL);
+	assert(scheduler_cData.tickPending);
+
+	err = scheduler_now(&now);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+	if (now < scheduler_cData.pendingTick)
+		return COMMON_TYPE_ERR;
+
+	tick->tv_sec = (time_t) (scheduler_cData.pendingTick
+			/ SCHEDULER_NSEC_PER_SEC);
+	tick->tv_nsec = (long) (scheduler_cData.pendingTick % SCHEDULER_NSEC_PER_SEC);
+
+	scheduler_completeTick();
+	return COMMON_TYPE_SUCCESS;
+}
+
+int64_t scheduler_getTickIndex(const struct timespec *tick) {
+	assert(tick != NULL);
+	assert(scheduler_interval > 0);
+
+	return (((int64_t) tick->tv_sec) * SCHEDULER_NSEC_PER_SEC + tick->tv_nsec)
+			/ scheduler_interval;
+}
+
+const scheduler_statistics_t * scheduler_getStatistics(void) {
+	return &scheduler_stats;
+}
+
+/**
+ * @brief Reads the current wall-clock time
+ * @param now The location to store the time in nanoseconds since the epoch
+ * @return The status of the operation
+ */
+static inline common_type_error_t scheduler_now(int64_t *now) {
+	struct timespec current;
+
+	assert(now != NULL);
+
+	if (clock_gettime(CLOCK_REALTIME, &current) != 0) {
+		logging_adapter_info("Can't read the wall-clock time: %s",
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	*now = ((int64_t) current.tv_sec) * SCHEDULER_NSEC_PER_SEC
+			+ current.tv_nsec;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Returns the first multiple of the interval after the given time
+ * @param time The time in nanoseconds since the epoch
+ * @return The aligned tick in nanoseconds since the epoch
+ */
+static inline int64_t scheduler_alignedTickAfter(int64_t time) {
+	return (time / scheduler_interval + 1) * scheduler_interval;
+}
+
+/**
+ * @brief Marks the pending tick as the last tick reached
+ */
+static inline void scheduler_completeTick(void) {
+	scheduler_cData.lastTick = scheduler_cData.pendingTick;
+	scheduler_cData.lastTickValid = 1;
+	scheduler_cData.tickPending = 0;
+	scheduler_stats.ticks++;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file scheduler.h
+ * @brief Schedules periodic samples aligned to the wall-clock
+ * @details Ticks are placed on multiples of the sampling interval counted from
+ * the epoch. E.g. an interval of 10 seconds triggers samples at :00, :10, :20
+ * and so on. Since each tick is calculated from the absolute wall-clock time,
+ * the time spent processing a sample does not accumulate. If processing a
+ * sample takes longer than an interval, the ticks missed are skipped and
+ * counted instead of being processed in a burst.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <common-type.h>
+#include <stdint.h>
+#include <time.h>
+
+/** @brief Structure holding the scheduler's statistics */
+typedef struct {
+	/** @brief The number of ticks processed */
+	uint64_t ticks;
+	/** @brief The number of ticks skipped because a cycle overran */
+	uint64_t missedTicks;
+	/**
+	 * @brief The minimal time in nanoseconds left between finishing a cycle and
+	 * the next tick.
+	 * @details The value is only valid if at least two ticks were processed. It
+	 * approaches zero if the cycles nearly reach the sampling interval and is
+	 * negative if a cycle overran.
+	 */
+	int64_t minSlack;
+} scheduler_statistics_t;
+
+/**
+ * @brief Initializes the scheduler
+ * @details The function has to be called once before any other function of
+ * the module. The first tick will be the next multiple of the interval.
+ * @param interval The sampling interval in nanoseconds, greater than zero
+ * @return The status of the operation
+ */
+common_type_error_t scheduler_init(int64_t interval);
+
+/**
+ * @brief Calculates the next tick which isn't in the past
+ * @details If ticks have passed since the last tick returned, they will be
+ * counted as missed ticks and skipped. If the wall-clock was set back by more
+ * than an interval, the schedule will be realigned. Calling the function again
+ * without waiting for the tick returns the same tick.
+ * @param tick The location to store the absolute wall-clock time of the tick
+ * @return The status of the operation
+ */
+common_type_error_t scheduler_next(struct timespec *tick);
+
+/**
+ * @brief Waits until the next tick is reached
+ * @details The function uses scheduler_next() to determine the next tick and
+ * sleeps until the absolute wall-clock time is reached. Waits interrupted by
+ * a signal are resumed, the tick remains unchanged. Hence, signals have to be
+ * received by other means, e.g. a signal file descriptor.
+ * @param tick The location to store the absolute wall-clock time of the tick
+ * @return The status of the operation
+ */
+common_type_error_t scheduler_wait(struct timespec *tick);
+
+/**
+ * @brief Completes waiting for the tick returned by scheduler_next()
+ * @details The function is meant for callers waiting for the tick on their
+ * own, e.g. by a timer file descriptor. If the wall-clock didn't reach the
+ * tick yet, COMMON_TYPE_ERR will be returned and the tick remains pending.
+ * @param tick The location to store the absolute wall-clock time of the tick
+ * @return The status of the operation
+ */
+common_type_error_t scheduler_reached(struct timespec *tick);
+
+/**
+ * @brief Returns the index of the given tick
+ * @details The index is the number of intervals passed since the epoch. Hence,
+ * consecutive ticks have consecutive indices and the difference of two indices
+ * includes any tick skipped in between.
+ * @param tick A tick returned by the scheduler
+ * @return The tick's index
+ */
+int64_t scheduler_getTickIndex(const struct timespec *tick);
+
+/**
+ * @brief Returns the statistics collected so far
+ * @return A valid reference to the statistics which must not be modified
+ */
+const scheduler_statistics_t * scheduler_getStatistics(void);
+
+#endif /* SCHEDULER_H_ */
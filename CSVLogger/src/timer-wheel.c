@@ -0,0 +1,187 @@
+/**
+ * @file timer-wheel.c
+ * @brief Implements the hashed timer wheel
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "timer-wheel.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/* Function prototypes */
+static timer_wheel_timer_t * timer_wheel_skip(timer_wheel_t *wheel,
+		uint64_t ticks);
+
+common_type_error_t timer_wheel_init(timer_wheel_t *wheel,
+		unsigned int slotCount) {
+	assert(wheel != NULL);
+	assert(slotCount > 0);
+
+	wheel->slots = calloc(slotCount, sizeof(wheel->slots[0]));
+	if (wheel->slots == NULL) {
+		return COMMON_TYPE_ERR;
+	}
+	wheel->slotCount = slotCount;
+	wheel->current = 0;
+	wheel->generation = 0;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_timer_t *timer,
+		uint64_t period, uint64_t delay) {
+	unsigned int slot;
+
+	assert(wheel != NULL && wheel->slots != NULL);
+	assert(timer != NULL);
+	assert(period > 0);
+	assert(delay > 0);
+
+	slot = (wheel->current + delay % wheel->slotCount) % wheel->slotCount;
+
+	timer->period = period;
+	timer->rounds = (delay - 1) / wheel->slotCount;
+	timer->next = wheel->slots[slot];
+	wheel->slots[slot] = timer;
+}
+
+timer_wheel_timer_t * timer_wheel_advance(timer_wheel_t *wheel,
+		uint64_t ticks) {
+	timer_wheel_timer_t *expiredList = NULL, *expiredTail = NULL;
+	timer_wheel_timer_t *slotExpired, *timer, *prev, *next;
+
+	assert(wheel != NULL && wheel->slots != NULL);
+
+	wheel->generation++;
+
+	// Stepping through more than a revolution would visit slots repeatedly
+	if (ticks >= wheel->slotCount) {
+		return timer_wheel_skip(wheel, ticks);
+	}
+
+	for (; ticks > 0; ticks--) {
+		wheel->current = (wheel->current + 1) % wheel->slotCount;
+
+		// Take every expired timer from the current slot
+		slotExpired = NULL;
+		prev = NULL;
+		for (timer = wheel->slots[wheel->current]; timer != NULL; timer = next) {
+			next = timer->next;
+			if (timer->rounds > 0) {
+				timer->rounds--;
+				prev = timer;
+				continue;
+			}
+
+			if (prev == NULL) {
+				wheel->slots[wheel->current] = next;
+			} else {
+				prev->next = next;
+			}
+			timer->next = slotExpired;
+			slotExpired = timer;
+		}
+
+		// Report and reschedule them
+		while (slotExpired != NULL) {
+			timer = slotExpired;
+			slotExpired = timer->next;
+
+			if (timer->expiredGeneration != wheel->generation) {
+				timer->expiredGeneration = wheel->generation;
+				timer->nextExpired = NULL;
+				if (expiredTail == NULL) {
+					expiredList = timer;
+				} else {
+					expiredTail->nextExpired = timer;
+				}
+				expiredTail = timer;
+			}
+			timer_wheel_add(wheel, timer, timer->period, timer->period);
+		}
+	}
+
+	return expiredList;
+}
+
+/**
+ * @brief Advances the wheel by at least a full revolution at once
+ * @details Every timer is taken from the wheel and the tick it expires next is
+ * calculated directly. Expired timers are reported and every timer is added
+ * again relative to the re-synchronized current slot. Hence, the costs don't
+ * depend on the number of ticks.
+ * @param wheel The initialized wheel, the generation is already incremented
+ * @param ticks The number of ticks to advance, at least the number of slots
+ * @return The list of expired timers or NULL if no timer expired
+ */
+static timer_wheel_timer_t * timer_wheel_skip(timer_wheel_t *wheel,
+		uint64_t ticks) {
+	timer_wheel_timer_t *expiredList = NULL, *expiredTail = NULL;
+	timer_wheel_timer_t *pending = NULL, *timer;
+	unsigned int slot;
+	uint64_t due;
+
+	assert(ticks >= wheel->slotCount);
+
+	// Take every timer, its rounds member keeps the ticks until it is due
+	for (slot = 0; slot < wheel->slotCount; slot++) {
+		while (wheel->slots[slot] != NULL) {
+			timer = wheel->slots[slot];
+			wheel->slots[slot] = timer->next;
+
+			due = (slot + wheel->slotCount - wheel->current - 1) % wheel->slotCount
+					+ 1 + timer->rounds * wheel->slotCount;
+			if (due <= ticks) {
+				timer->expiredGeneration = wheel->generation;
+				timer->nextExpired = NULL;
+				if (expiredTail == NULL) {
+					expiredList = timer;
+				} else {
+					expiredTail->nextExpired = timer;
+				}
+				expiredTail = timer;
+				due = timer->period - (ticks - due) % timer->period;
+			} else {
+				due -= ticks;
+			}
+			timer->rounds = due;
+			timer->next = pending;
+			pending = timer;
+		}
+	}
+
+	wheel->current = (wheel->current + ticks % wheel->slotCount)
+			% wheel->slotCount;
+	while (pending != NULL) {
+		timer = pending;
+		pending = timer->next;
+		timer_wheel_add(wheel, timer, timer->period, timer->rounds);
+	}
+
+	return expiredList;
+}
+
+void timer_wheel_free(timer_wheel_t *wheel) {
+	assert(wheel != NULL);
+
+	free(wheel->slots);
+	wheel->slots = NULL;
+	wheel->slotCount = 0;
+}
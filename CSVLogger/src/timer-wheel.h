@@ -0,0 +1,105 @@
+/**
+ * @file timer-wheel.h
+ * @brief Hashed timer wheel triggering periodic timers
+ * @details The wheel consists of a fixed number of slots, each holding a list
+ * of timers. A timer is hashed into the slot of it's expiration tick modulo the
+ * number of slots and additionally stores the number of rounds left. Advancing
+ * the wheel by one tick only visits the timers of a single slot, independent
+ * of the total number of timers registered. Expired timers are rescheduled
+ * according to their period automatically. The timer structures are allocated
+ * by the caller and must remain valid until the wheel is freed.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <common-type.h>
+#include <stdint.h>
+
+/** @brief Structure defining a single periodic timer */
+typedef struct timer_wheel_timer {
+	/** @brief The next timer within the same slot */
+	struct timer_wheel_timer *next;
+	/** @brief The next timer within the list of expired timers */
+	struct timer_wheel_timer *nextExpired;
+	/** @brief The timer's period in ticks, at least one */
+	uint64_t period;
+	/** @brief The number of full wheel rounds left until the timer expires */
+	uint64_t rounds;
+	/** @brief The advance call the timer expired last, used internally */
+	uint64_t expiredGeneration;
+	/** @brief User data associated with the timer */
+	void *data;
+} timer_wheel_timer_t;
+
+/** @brief Structure defining the timer wheel */
+typedef struct {
+	/** @brief The vector of slots holding the timer lists */
+	timer_wheel_timer_t **slots;
+	/** @brief The number of slots */
+	unsigned int slotCount;
+	/** @brief The index of the current slot */
+	unsigned int current;
+	/** @brief The number of advance calls, used to report a timer only once */
+	uint64_t generation;
+} timer_wheel_t;
+
+/**
+ * @brief Initializes the given wheel
+ * @param wheel The reference of the wheel to initialize
+ * @param slotCount The number of slots, greater than zero
+ * @return The status of the operation
+ */
+common_type_error_t timer_wheel_init(timer_wheel_t *wheel,
+		unsigned int slotCount);
+
+/**
+ * @brief Adds a periodic timer to the wheel
+ * @details The timer expires the first time after the wheel was advanced by
+ * delay ticks and afterwards every period ticks. The timer has to be zero
+ * initialized before it is added the first time.
+ * @param wheel The initialized wheel
+ * @param timer The timer to add, not currently registered
+ * @param period The period in ticks, at least one
+ * @param delay The number of ticks until the first expiration, at least one
+ */
+void timer_wheel_add(timer_wheel_t *wheel, timer_wheel_timer_t *timer,
+		uint64_t period, uint64_t delay);
+
+/**
+ * @brief Advances the wheel by the given number of ticks
+ * @details Every timer which expired at least once during the ticks passed is
+ * returned once. The expired timers are linked using the nextExpired member
+ * and the list is valid until the wheel is advanced again.
+ * @param wheel The initialized wheel
+ * @param ticks The number of ticks to advance
+ * @return The list of expired timers or NULL if no timer expired
+ */
+timer_wheel_timer_t * timer_wheel_advance(timer_wheel_t *wheel,
+		uint64_t ticks);
+
+/**
+ * @brief Frees resources allocated by the wheel
+ * @details The timers registered are not touched.
+ * @param wheel The wheel to free
+ */
+void timer_wheel_free(timer_wheel_t *wheel);
+
+#endif /* TIMER_WHEEL_H_ */
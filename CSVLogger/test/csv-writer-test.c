@@ -0,0 +1,149 @@
+/**
+ * @file csv-writer-test.c
+ * @brief Tests storing strings into the row's arena of the CSV writer
+ * @details Each row fills the arena exactly, so the following string doesn't
+ * find any room left. The rows are written to a scratch file in the current
+ * directory, which is compared to the expected content. The program returns
+ * EXIT_SUCCESS if every check passed.
+ *
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "csv-writer.h"
+
+#include <logging-adapter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @brief The file receiving the rows */
+#define CSV_WRITER_TEST_FILE "csv-writer-test.csv"
+/** @brief The number of value columns */
+#define CSV_WRITER_TEST_COLUMNS 2
+/**
+ * @brief The size of a row's arena
+ * @details It has to match CSV_WRITER_ARENA_PER_COLUMN times the number of
+ * columns.
+ */
+#define CSV_WRITER_TEST_ARENA_SIZE (CSV_WRITER_TEST_COLUMNS * 64)
+/** @brief The size of the buffer holding the file's content */
+#define CSV_WRITER_TEST_BUFFER_SIZE 4096
+
+/* Function prototypes */
+static void csv_writer_test_addRow(const char *first, const char *second);
+static int csv_writer_test_check(const char *expected);
+
+int main(int argc, char **argv) {
+	static const char * const titles[CSV_WRITER_TEST_COLUMNS] = { "A", "B" };
+	char fitting[CSV_WRITER_TEST_ARENA_SIZE];
+	char exceeding[2 * CSV_WRITER_TEST_ARENA_SIZE];
+	char expected[CSV_WRITER_TEST_BUFFER_SIZE];
+	csv_writer_config_t config = { .fileName = CSV_WRITER_TEST_FILE,
+			.timeMode = CSV_WRITER_TIME_EPOCH, .timeHeader = "Time",
+			.separator = ";", .titles = titles,
+			.columnCount = CSV_WRITER_TEST_COLUMNS, .queueLength = 4,
+			.policy = CSV_WRITER_POLICY_BLOCK };
+	csv_writer_statistics_t stats;
+
+	if (!logging_adapter_init(argv[0])) {
+		fprintf(stderr, "Can't initialize the logging adapter\n");
+		return EXIT_FAILURE;
+	}
+	(void) unlink(CSV_WRITER_TEST_FILE);
+	if (csv_writer_init(&config) != COMMON_TYPE_SUCCESS) {
+		fprintf(stderr, "Can't initialize the CSV writer\n");
+		return EXIT_FAILURE;
+	}
+
+	// The first string takes the whole arena including the terminating '\0'
+	memset(fitting, 'a', sizeof(fitting) - 1);
+	fitting[sizeof(fitting) - 1] = '\0';
+	csv_writer_test_addRow(fitting, "b");
+	// The first string is truncated to the whole arena
+	memset(exceeding, 'a', sizeof(exceeding) - 1);
+	exceeding[sizeof(exceeding) - 1] = '\0';
+	csv_writer_test_addRow(exceeding, "b");
+	// Each row starts with an empty arena
+	csv_writer_test_addRow("x", "y");
+
+	csv_writer_getStatistics(&stats);
+	if (csv_writer_free() != COMMON_TYPE_SUCCESS) {
+		fprintf(stderr, "Can't write the rows\n");
+		return EXIT_FAILURE;
+	}
+	if (stats.truncatedStrings != 3) {
+		fprintf(stderr, "Expected 3 truncated strings, counted %llu\n",
+				(unsigned long long) stats.truncatedStrings);
+		return EXIT_FAILURE;
+	}
+
+	snprintf(expected, sizeof(expected), "\"Time\";\"A\";\"B\"\n"
+			"1;\"%s\";\n1;\"%s\";\n1;\"x\";\"y\"\n", fitting, fitting);
+	if (!csv_writer_test_check(expected))
+		return EXIT_FAILURE;
+
+	(void) unlink(CSV_WRITER_TEST_FILE);
+	logging_adapter_freeResources();
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Writes a row holding the given strings
+ * @param first The string of the first column
+ * @param second The string of the second column
+ */
+static void csv_writer_test_addRow(const char *first, const char *second) {
+	struct timeval timestamp = { .tv_sec = 1, .tv_usec = 0 };
+	csv_writer_row_t *row;
+	common_type_t value;
+
+	row = csv_writer_beginRow(&timestamp);
+	value.type = COMMON_TYPE_STRING;
+	value.data.strVal = (char *) first;
+	csv_writer_setValue(row, 0, &value);
+	value.data.strVal = (char *) second;
+	csv_writer_setValue(row, 1, &value);
+	csv_writer_commitRow(row);
+}
+
+/**
+ * @brief Compares the content of the file written to the expected one
+ * @param expected The expected content
+ * @return Non-zero if the content matches
+ */
+static int csv_writer_test_check(const char *expected) {
+	char content[CSV_WRITER_TEST_BUFFER_SIZE];
+	size_t length;
+	FILE *file;
+
+	file = fopen(CSV_WRITER_TEST_FILE, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Can't open \"%s\"\n", CSV_WRITER_TEST_FILE);
+		return 0;
+	}
+	length = fread(content, 1, sizeof(content) - 1, file);
+	(void) fclose(file);
+	content[length] = '\0';
+
+	if (strcmp(content, expected) != 0) {
+		fprintf(stderr, "Unexpected content:\n%s\nExpected:\n%s\n", content,
+				expected);
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file dlogg-capture.c
+ * @brief Implements the wire-traffic capture of the D-LOGG MAC layer
+ * @details The records are buffered by the standard library and written at
+ * the latest when the capture file is closed.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dlogg-capture.h"
+
+#include <logging-adapter.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/** @brief The capture file directive */
+#define DLOGG_CAP_CONFIG_CAPTURE_FILE "capture-file"
+
+/* Function prototypes */
+static inline void dlogg_cap_putLE(uint8_t *buffer, uint64_t value,
+		size_t length);
+static inline void dlogg_cap_disable(dlogg_cap_state_t *state);
+
+common_type_error_t dlogg_cap_init(dlogg_cap_state_t *state,
+		config_setting_t *configuration) {
+	const char *path;
+	uint8_t header[DLOGG_CAP_MAGIC_LENGTH + 1];
+	struct timespec start;
+
+	assert(state != NULL);
+	assert(configuration != NULL);
+	assert(state->file == NULL);
+
+	if (!config_setting_lookup_string(configuration,
+			DLOGG_CAP_CONFIG_CAPTURE_FILE, &path)) {
+		return COMMON_TYPE_SUCCESS; // The capture is optional
+	}
+
+	state->file = fopen(path, "ab");
+	if (state->file == NULL) {
+		logging_adapter_info("Can't open the capture file \"%s\": %s", path,
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	memcpy(header, DLOGG_CAP_MAGIC, DLOGG_CAP_MAGIC_LENGTH);
+	header[DLOGG_CAP_MAGIC_LENGTH] = DLOGG_CAP_VERSION;
+	if (fwrite(header, sizeof(header), 1, state->file) != 1) {
+		logging_adapter_info("Can't write to the capture file \"%s\": %s", path,
+				strerror(errno));
+		dlogg_cap_disable(state);
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	state->start = start;
+	state->lineID = 0;
+	logging_adapter_debug("Capture the D-LOGG traffic to \"%s\"", path);
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+void dlogg_cap_record(dlogg_cap_state_t *state, uint8_t direction,
+		const uint8_t *buffer, size_t length) {
+	uint8_t header[DLOGG_CAP_RECORD_HEADER_LENGTH];
+	struct timespec now;
+	uint64_t time;
+
+	assert(state != NULL);
+	assert(buffer != NULL || length == 0);
+
+	if (state->file == NULL || length == 0)
+		return;
+
+	assert(length <= 0xFFFF);
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	time = (uint64_t) (now.tv_sec - state->start.tv_sec) * 1000000u
+			+ (now.tv_nsec - state->start.tv_nsec) / 1000;
+
+	header[0] = direction;
+	dlogg_cap_putLE(&header[1], time, 8);
+	dlogg_cap_putLE(&header[9], length, 2);
+
+	if (fwrite(header, sizeof(header), 1, state->file) != 1
+			|| fwrite(buffer, length, 1, state->file) != 1) {
+		logging_adapter_info("Can't write to the capture file, stop capturing: %s",
+				strerror(errno));
+		dlogg_cap_disable(state);
+	}
+}
+
+void dlogg_cap_selectLine(dlogg_cap_state_t *state, uint8_t lineID) {
+	assert(state != NULL);
+
+	if (state->file == NULL || lineID == state->lineID)
+		return;
+
+	state->lineID = lineID;
+	dlogg_cap_record(state, DLOGG_CAP_DIR_LINE, &lineID, sizeof(lineID));
+}
+
+common_type_error_t dlogg_cap_free(dlogg_cap_state_t *state) {
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+
+	assert(state != NULL);
+
+	if (state->file != NULL) {
+		if (fclose(state->file) != 0) {
+			logging_adapter_info("Can't close the capture file: %s", strerror(errno));
+			err = COMMON_TYPE_ERR_IO;
+		}
+		state->file = NULL;
+	}
+
+	return err;
+}
+
+/**
+ * @brief Stores the value in little endian byte order
+ * @param buffer The destination of the value
+ * @param value The value to store
+ * @param length The number of bytes to store
+ */
+static inline void dlogg_cap_putLE(uint8_t *buffer, uint64_t value,
+		size_t length) {
+	size_t i;
+
+	for (i = 0; i < length; i++) {
+		buffer[i] = (uint8_t) (value >> (8 * i));
+	}
+}
+
+/**
+ * @brief Closes the capture file without reporting further errors
+ * @param state The valid state of an enabled capture
+ */
+static inline void dlogg_cap_disable(dlogg_cap_state_t *state) {
+	(void) fclose(state->file);
+	state->file = NULL;
+}
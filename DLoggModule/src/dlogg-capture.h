@@ -0,0 +1,113 @@
+/**
+ * @file dlogg-capture.h
+ * @brief The header file specifies the wire-traffic capture of the D-LOGG MAC
+ * layer and its file format.
+ * @details <p>If enabled, every byte sent to and received from the D-LOGG
+ * device is written to a binary capture file. The capture may be served again
+ * by the replay MAC layer to reproduce a session without any device.</p>
+ * <p>A capture file consists of sessions. Each session starts with the magic
+ * bytes "DLOGGCAP" followed by the version byte. Each subsequent record
+ * consists of the direction byte, the time since the session's start in
+ * microseconds (8 bytes, little endian), the number of data bytes (2 bytes,
+ * little endian) and the data bytes itself. Appending a new session to an
+ * existing capture file is allowed.</p>
+ * <p>If the MAC layer serves several lines, a line record holding the line's
+ * identifier as single data byte precedes the records of another line. Each
+ * session starts at line 0.</p>
+ * <p>The definitions of this module arn't meant to be used outside the MAC
+ * layer.</p>
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DLOGG_CAPTURE_H_
+#define DLOGG_CAPTURE_H_
+
+#include <common-type.h>
+#include <libconfig.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/** @brief The magic bytes starting a capture session */
+#define DLOGG_CAP_MAGIC "DLOGGCAP"
+/** @brief The length of the magic bytes */
+#define DLOGG_CAP_MAGIC_LENGTH (8)
+/** @brief The capture format version */
+#define DLOGG_CAP_VERSION (1)
+/** @brief The length of a record's header in bytes */
+#define DLOGG_CAP_RECORD_HEADER_LENGTH (11)
+
+/** @brief The direction code of bytes sent to the device */
+#define DLOGG_CAP_DIR_SEND ('>')
+/** @brief The direction code of bytes received from the device */
+#define DLOGG_CAP_DIR_RECEIVE ('<')
+/** @brief The code of records selecting the line of subsequent records */
+#define DLOGG_CAP_DIR_LINE ('L')
+
+/** @brief structure encapsulating the capture's state of a MAC instance */
+typedef struct {
+	/** @brief The capture file or NULL if the capture is disabled */
+	FILE *file;
+	/** @brief The start of the session */
+	struct timespec start;
+	/** @brief The line of the last record */
+	uint8_t lineID;
+} dlogg_cap_state_t;
+
+/**
+ * @brief Initializes the capture and opens the capture file
+ * @details The file's path is taken from the optional "capture-file" directive
+ * of the MAC configuration. If the directive is missing, nothing is captured.
+ * A new session is appended to an existing file. Each MAC instance needs its
+ * own capture file.
+ * @param state The instance's zero initialized state
+ * @param configuration The valid MAC configuration group
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_cap_init(dlogg_cap_state_t *state,
+		config_setting_t *configuration);
+
+/**
+ * @brief Writes a single record, if the capture is enabled
+ * @details Write errors are reported once and disable the capture. They don't
+ * affect the communication with the device.
+ * @param state The instance's valid state
+ * @param direction The direction code of the record
+ * @param buffer The bytes exchanged
+ * @param length The number of bytes exchanged
+ */
+void dlogg_cap_record(dlogg_cap_state_t *state, uint8_t direction,
+		const uint8_t *buffer, size_t length);
+
+/**
+ * @brief Records the line subsequent records belong to
+ * @details A line record is only written, if the line changes.
+ * @param state The instance's valid state
+ * @param lineID The identifier of the selected line
+ */
+void dlogg_cap_selectLine(dlogg_cap_state_t *state, uint8_t lineID);
+
+/**
+ * @brief Closes the capture file
+ * @param state The instance's state
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_cap_free(dlogg_cap_state_t *state);
+
+#endif /* DLOGG_CAPTURE_H_ */
@@ -5,6 +5,17 @@
  * values of controls manufactured by Technische Alternative (www.ta.co.at) An
  * up-to-date protocol specification may be obtained by contacting the
  * Technische Alternative support team.
+ * The meta-data of a line is cached. It is only fetched again if the cached
+ * data expires or the current-data response doesn't fit the cached meta-data.
+ * If a state file is configured, the meta-data of the previous invocation is
+ * used initially.
+ * Each line is served by a separate device. A sync fetches every line served
+ * by the MAC layer. The current-data requests are issued to all lines before
+ * the first response is read, so the devices assemble their responses
+ * concurrently. Receiving a response is done by a resumable state machine per
+ * line (await the device ID, await the sample, verify the checksum). Whichever
+ * line has bytes at hand is advanced, so a slow device doesn't delay reading
+ * the others. A line failing doesn't affect the data of other lines.
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -26,46 +37,105 @@
 
 #include "dlogg-current-data.h"
 #include "dlogg-mac.h"
+#include "dlogg-mac-common.h"
+#include "dlogg-state-cache.h"
 #include <fieldbus-mac.h>
 #include <logging-adapter.h>
 
 #include <assert.h>
 #include <time.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-/** @brief The maximum number of data samples per active-data message */
-#define DLOGG_CD_MAX_SAMPLES_PER_MSG (2)
+/** @brief The meta-data refresh interval directive */
+#define DLOGG_CD_CONFIG_METADATA_REFRESH "metadata-refresh"
+
+/** @brief The states of receiving a line's current-data response */
+typedef enum {
+	/** @brief The device ID of the next sample is awaited */
+	DLOGG_CD_RX_DEVICE_ID = 0,
+	/** @brief The data of the current sample is awaited */
+	DLOGG_CD_RX_SAMPLE,
+	/** @brief The checksum of the response is awaited */
+	DLOGG_CD_RX_CHKSUM,
+	/** @brief The response was received completely */
+	DLOGG_CD_RX_DONE
+} dlogg_cd_rxState_t;
+
+/** @brief The resumable state of receiving a line's current-data response */
+typedef struct {
+	/** @brief The received samples */
+	uint8_t buffer[DLOGG_CD_MAX_SAMPLES_PER_MSG][sizeof(dlogg_cd_sample_t)];
+	/** @brief The decoded internal sample type of each sample */
+	int sampleType[DLOGG_CD_MAX_SAMPLES_PER_MSG];
+	/** @brief The location receiving the bytes awaited */
+	uint8_t *target;
+	/** @brief The number of bytes awaited in the current state */
+	size_t expected;
+	/** @brief The number of bytes received in the current state */
+	size_t received;
+	/** @brief The current state */
+	dlogg_cd_rxState_t state;
+	/** @brief The checksum calculated so far */
+	dlogg_mac_chksum_t chksum;
+	/** @brief The device ID received last */
+	uint8_t deviceID;
+	/** @brief The checksum received */
+	dlogg_mac_chksum_t chksumRead;
+	/** @brief The number of samples expected */
+	uint8_t sampleCount;
+	/** @brief The index of the current sample */
+	uint8_t sample;
+} dlogg_cd_receiver_t;
 
 /**
- * @brief Encapsulates the data fetched from one data line.
- * @details It is planned to support multiple logging lines each communicating
- * with different control equipment. The type will be provided for future
- * compatibility only.
+ * @brief The MAC instances serving lines, ordered by their first line
+ * @details The registry is only modified while creating and freeing instances,
+ * which is never done concurrently to synchronizing or accessing the lines.
  */
-typedef struct {
-	/** @brief The line's identifier */
-	uint8_t lineID;
-	/** @brief The line's meta-data */
-	dlogg_cd_metadata_t metaData;
-	/** @brief The device's data */
-	dlogg_cd_sample_t samples[DLOGG_CD_MAX_SAMPLES_PER_MSG];
-} dlogg_cd_lineData_t;
-
-/** @brief The currently buffered data */
-dlogg_cd_lineData_t dlogg_cd_data;
+static struct {
+	/** @brief The registered instances */
+	dlogg_mac_context_t **contexts;
+	/** @brief The number of registered instances */
+	unsigned int length;
+} dlogg_cd_registry;
 
 /* Function Prototypes */
 static void dlogg_cd_debug_buffer(const char* name, uint8_t* buffer,
 		size_t length);
-static dlogg_cd_lineData_t * dlogg_cd_getLineData(uint8_t lineID);
-static inline common_type_error_t dlogg_cd_fetchMetaData(uint8_t activeLine);
+static inline common_type_error_t dlogg_cd_register(
+		dlogg_mac_context_t *context);
+static dlogg_cd_lineData_t * dlogg_cd_getLineData(
+		dlogg_mac_context_t *context, uint8_t activeLine);
+static inline common_type_error_t dlogg_cd_prepareLine(
+		dlogg_mac_context_t *context, uint8_t activeLine, int * cached);
+static common_type_error_t dlogg_cd_retryLine(dlogg_mac_context_t *context,
+		uint8_t activeLine, common_type_error_t err, int cached);
+static inline int dlogg_cd_isMetaDataValid(dlogg_mac_context_t *context,
+		dlogg_cd_lineData_t * lineData);
+static inline time_t dlogg_cd_getMonotonicTime(void);
+static inline common_type_error_t dlogg_cd_fetchMetaData(
+		dlogg_mac_context_t *context, uint8_t activeLine);
 static inline common_type_error_t dlogg_cd_fetchModuleType(
-		dlogg_cd_moduleType_t * moduleType);
-static inline common_type_error_t dlogg_cd_fetchModuleMode(uint8_t * mode);
-static inline common_type_error_t dlogg_cd_fetchOperationMode(uint8_t * mode);
+		dlogg_mac_context_t *context, dlogg_cd_moduleType_t * moduleType);
+static inline common_type_error_t dlogg_cd_fetchModuleMode(
+		dlogg_mac_context_t *context, uint8_t * mode);
+static inline common_type_error_t dlogg_cd_fetchOperationMode(
+		dlogg_mac_context_t *context, uint8_t * mode);
 static inline void dlogg_cd_coffeeBreak(void);
-static inline common_type_error_t dlogg_cd_fetchCurrentData(uint8_t activeLine);
+static inline common_type_error_t dlogg_cd_requestCurrentData(
+		dlogg_mac_context_t *context, uint8_t activeLine);
+static inline common_type_error_t dlogg_cd_receiveCurrentData(
+		dlogg_mac_context_t *context, uint8_t activeLine);
+static void dlogg_cd_receiveLines(dlogg_mac_context_t *context,
+		unsigned int lines, common_type_error_t *err);
+static inline void dlogg_cd_startReceiver(dlogg_cd_receiver_t *rx,
+		dlogg_cd_lineData_t *lineData);
+static common_type_error_t dlogg_cd_stepReceiver(dlogg_mac_context_t *context,
+		dlogg_cd_receiver_t *rx, dlogg_cd_lineData_t *lineData);
+static inline void dlogg_cd_storeSamples(const dlogg_cd_receiver_t *rx,
+		dlogg_cd_lineData_t *lineData);
 static inline common_type_error_t dlogg_cd_checkDLMode(
 		dlogg_cd_metadata_t * metadata);
 static inline int dlogg_cd_getSampleCount(dlogg_cd_metadata_t * metadata);
@@ -73,38 +143,297 @@ static inline int dlogg_cd_getSampleType(uint8_t deviceID,
 		dlogg_cd_metadata_t * metaData);
 static size_t dlogg_cd_getSampleSize(uint8_t sampleID);
 
+common_type_error_t dlogg_cd_init(dlogg_mac_context_t *context,
+		config_setting_t *configuration, uint8_t lineCount) {
+	dlogg_cd_state_t *state;
+	int refresh = 0;
+	uint8_t i;
+
+	assert(context != NULL);
+	assert(configuration != NULL);
+	assert(lineCount > 0 && lineCount <= DLOGG_CD_MAX_LINES);
+
+	state = &context->currentData;
+	assert(!state->registered);
+
+	if (config_setting_lookup_int(configuration,
+			DLOGG_CD_CONFIG_METADATA_REFRESH, &refresh) && refresh < 0) {
+		logging_adapter_info("The %s configuration directive contains a negative "
+				"value: %d", DLOGG_CD_CONFIG_METADATA_REFRESH, refresh);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+	state->metaDataRefresh = refresh;
+	state->lineCount = lineCount;
+
+	if (dlogg_cd_register(context) != COMMON_TYPE_SUCCESS)
+		return COMMON_TYPE_ERR_CONFIG;
+
+	memset(state->lines, 0, sizeof(state->lines));
+	for (i = 0; i < lineCount; i++) {
+		state->lines[i].lineID = state->firstLine + i;
+		if (dlogg_sc_getMetadata(&context->stateCache, i,
+				&state->lines[i].metaData)) {
+			logging_adapter_debug("Use the meta-data of the previous invocation at "
+					"line %u", (unsigned) state->lines[i].lineID);
+			state->lines[i].metaDataTime = dlogg_cd_getMonotonicTime();
+			state->lines[i].metaDataValid = 1;
+		}
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Adds the instance to the registry and assigns its first line
+ * @details The instance's lines are numbered after the lines of every instance
+ * registered so far.
+ * @param context The valid instance whose line count is set
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_cd_register(
+		dlogg_mac_context_t *context) {
+	dlogg_mac_context_t **contexts;
+	const dlogg_cd_state_t *last;
+	unsigned int firstLine = 0;
+
+	assert(context != NULL);
+
+	if (dlogg_cd_registry.length > 0) {
+		last = &dlogg_cd_registry.contexts[dlogg_cd_registry.length - 1]
+				->currentData;
+		firstLine = last->firstLine + last->lineCount;
+	}
+	if (firstLine + context->currentData.lineCount > DLOGG_CD_MAX_GLOBAL_LINES) {
+		logging_adapter_info("Every D-LOGG MAC module together may serve up to %u "
+				"lines", (unsigned) DLOGG_CD_MAX_GLOBAL_LINES);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	contexts = realloc(dlogg_cd_registry.contexts,
+			(dlogg_cd_registry.length + 1) * sizeof(contexts[0]));
+	if (contexts == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+	contexts[dlogg_cd_registry.length++] = context;
+	dlogg_cd_registry.contexts = contexts;
+
+	context->currentData.firstLine = firstLine;
+	context->currentData.registered = 1;
+	return COMMON_TYPE_SUCCESS;
+}
+
+void dlogg_cd_free(dlogg_mac_context_t *context) {
+	unsigned int i;
+
+	assert(context != NULL);
+
+	if (!context->currentData.registered)
+		return;
+
+	for (i = 0; i < dlogg_cd_registry.length; i++) {
+		if (dlogg_cd_registry.contexts[i] == context)
+			break;
+	}
+	assert(i < dlogg_cd_registry.length);
+
+	dlogg_cd_registry.length--;
+	memmove(&dlogg_cd_registry.contexts[i], &dlogg_cd_registry.contexts[i + 1],
+			(dlogg_cd_registry.length - i) * sizeof(dlogg_cd_registry.contexts[0]));
+	if (dlogg_cd_registry.length == 0) {
+		free(dlogg_cd_registry.contexts);
+		dlogg_cd_registry.contexts = NULL;
+	}
+	context->currentData.registered = 0;
+}
+
+/**
+ * @brief Fetches all available active-data samples of every line of the
+ * instance
+ * @details The meta-data is fetched on demand. Afterwards, the current-data
+ * request is sent to every line before the responses are received
+ * concurrently. Lines failing are retried once, if necessary.
+ * @param context The instance's valid context
+ * @return The status of the operation, successful if at least one line could
+ * be synchronized
+ */
+common_type_error_t fieldbus_mac_syncContext(fieldbus_mac_context_t context) {
+	dlogg_mac_context_t *mac = context;
+	const dlogg_cd_state_t *state;
+	common_type_error_t err[DLOGG_CD_MAX_LINES], ret = COMMON_TYPE_SUCCESS;
+	int cached[DLOGG_CD_MAX_LINES];
+	unsigned int requested = 0;
+	uint8_t i, synchronized = 0;
+
+	assert(mac != NULL);
+	state = &mac->currentData;
+
+	for (i = 0; i < state->lineCount; i++) {
+		err[i] = dlogg_cd_prepareLine(mac, i, &cached[i]);
+	}
+
+	// Every line's response shares the deadline of a single transaction
+	dlogg_mac_startTransaction(mac);
+	for (i = 0; i < state->lineCount; i++) {
+		if (err[i] == COMMON_TYPE_SUCCESS) {
+			err[i] = dlogg_mac_selectLine(mac, i);
+		}
+		if (err[i] == COMMON_TYPE_SUCCESS) {
+			err[i] = dlogg_cd_requestCurrentData(mac, i);
+		}
+		if (err[i] == COMMON_TYPE_SUCCESS) {
+			requested |= 1u << i;
+		}
+	}
+
+	dlogg_cd_receiveLines(mac, requested, err);
+
+	for (i = 0; i < state->lineCount; i++) {
+		err[i] = dlogg_cd_retryLine(mac, i, err[i], cached[i]);
+
+		if (err[i] == COMMON_TYPE_SUCCESS) {
+			synchronized++;
+		} else {
+			if (state->lineCount > 1 || dlogg_cd_registry.length > 1) {
+				logging_adapter_info("Can't synchronize line %u (err-code: %d)",
+						(unsigned) state->lines[i].lineID, (int) err[i]);
+			}
+			if (ret == COMMON_TYPE_SUCCESS) {
+				ret = err[i];
+			}
+		}
+	}
+
+	return synchronized > 0 ? COMMON_TYPE_SUCCESS : ret;
+}
+
 /**
- * @brief Fetches the meta-data and all available active-data samples
+ * @brief Selects the line and makes sure that it's meta-data may be used
+ * @details The cached meta-data is used if it is valid. The line's current
+ * data is dropped until it is fetched again.
+ * @param context The valid MAC instance
+ * @param activeLine The instance's line id to prepare
+ * @param cached Location receiving whether the cached meta-data is used
  * @return The status of the operation
  */
-common_type_error_t fieldbus_mac_sync() {
+static inline common_type_error_t dlogg_cd_prepareLine(
+		dlogg_mac_context_t *context, uint8_t activeLine, int * cached) {
 	common_type_error_t err;
+	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(context, activeLine);
 
-	err = dlogg_cd_fetchMetaData(0);
-	if (err != COMMON_TYPE_SUCCESS)
-		return err;
+	assert(cached != NULL);
+
+	*cached = 0;
+	if (lineData == NULL )
+		return COMMON_TYPE_ERR_INVALID_ADDRESS;
+
+	lineData->metaData.sampleCount = 0;
 
-	err = dlogg_cd_fetchCurrentData(0);
+	err = dlogg_mac_selectLine(context, activeLine);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
+	*cached = dlogg_cd_isMetaDataValid(context, lineData);
+	if (*cached)
+		return COMMON_TYPE_SUCCESS;
+
+	return dlogg_cd_fetchMetaData(context, activeLine);
+}
+
+/**
+ * @brief Handles the outcome of fetching a line's current data
+ * @details If the current data can't be fetched, the meta-data is invalidated.
+ * If the response was invalid or timed out and cached meta-data was used,
+ * the device may have been reconfigured. A response shorter than the cached
+ * meta-data expects only shows up as a timeout. Hence, the meta-data is fetched
+ * again and the request is retried once.
+ * @param context The valid MAC instance
+ * @param activeLine The instance's line id, currently active
+ * @param err The status of fetching the current data
+ * @param cached Flag indicating that cached meta-data was used
+ * @return The final status of the line
+ */
+static common_type_error_t dlogg_cd_retryLine(dlogg_mac_context_t *context,
+		uint8_t activeLine, common_type_error_t err, int cached) {
+	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(context, activeLine);
+
+	if (lineData == NULL )
+		return COMMON_TYPE_ERR_INVALID_ADDRESS;
+
+	if (err != COMMON_TYPE_SUCCESS) {
+		lineData->metaDataValid = 0;
+	}
+	if ((err == COMMON_TYPE_ERR_INVALID_RESPONSE
+			|| err == COMMON_TYPE_ERR_TIMEOUT) && cached) {
+		logging_adapter_debug("%s response, refresh the meta-data and retry",
+				err == COMMON_TYPE_ERR_TIMEOUT ? "Incomplete" : "Invalid");
+		err = dlogg_mac_selectLine(context, activeLine);
+		if (err == COMMON_TYPE_SUCCESS) {
+			err = dlogg_cd_fetchMetaData(context, activeLine);
+		}
+		if (err == COMMON_TYPE_SUCCESS) {
+			dlogg_mac_startTransaction(context);
+			err = dlogg_cd_requestCurrentData(context, activeLine);
+		}
+		if (err == COMMON_TYPE_SUCCESS) {
+			err = dlogg_cd_receiveCurrentData(context, activeLine);
+		}
+		if (err != COMMON_TYPE_SUCCESS) {
+			lineData->metaDataValid = 0;
+		}
+	}
+
+	if (err != COMMON_TYPE_SUCCESS) {
+		// Don't trust the state in the next invocation
+		dlogg_sc_clear(&context->stateCache, activeLine);
+	}
+
 	return err;
 }
 
 /**
- * @brief Fetches active data values and stores them into the global buffer
- * @details The function assumes that the line's meta-data were previously set.
- * The sampleCount field will be updated according to the read data.
- * @param activeLine The line id, currently active
+ * @brief Returns whether the cached meta-data of the line may be used
+ * @param context The valid MAC instance
+ * @param lineData The valid line data to check
+ * @return 1 if the meta-data is valid and not expired, 0 otherwise
+ */
+static inline int dlogg_cd_isMetaDataValid(dlogg_mac_context_t *context,
+		dlogg_cd_lineData_t * lineData) {
+	int refresh = context->currentData.metaDataRefresh;
+
+	assert(lineData != NULL);
+
+	if (!lineData->metaDataValid)
+		return 0;
+
+	return refresh == 0
+			|| dlogg_cd_getMonotonicTime() - lineData->metaDataTime < refresh;
+}
+
+/**
+ * @brief Returns the seconds elapsed on the monotonic clock
+ * @details The monotonic clock isn't affected by setting the system time.
+ * @return The monotonic time in seconds
+ */
+static inline time_t dlogg_cd_getMonotonicTime(void) {
+	struct timespec now = { 0, 0 };
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+/**
+ * @brief Issues the current-data request at the given line
+ * @details The function assumes that the line's meta-data were previously set,
+ * that the line is selected and that the transaction was started.
+ * @param context The valid MAC instance
+ * @param activeLine The instance's line id, currently active
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_cd_fetchCurrentData(uint8_t activeLine) {
+static inline common_type_error_t dlogg_cd_requestCurrentData(
+		dlogg_mac_context_t *context, uint8_t activeLine) {
 	common_type_error_t err;
-	uint8_t buffer[DLOGG_CD_MAX_SAMPLES_PER_MSG][sizeof(dlogg_cd_sample_t)];
-	int sampleType[DLOGG_CD_MAX_SAMPLES_PER_MSG]; // Decoded internal sample type
-	dlogg_mac_chksum_t chksum;
-	uint8_t sampleCount, i;
-	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(activeLine);
+	uint8_t request = 0xAB;
+	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(context, activeLine);
 
 	if (lineData == NULL )
 		return COMMON_TYPE_ERR_INVALID_ADDRESS;
@@ -113,62 +442,233 @@ static inline common_type_error_t dlogg_cd_fetchCurrentData(uint8_t activeLine)
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
-	//issue current data request
-	buffer[0][0] = 0xAB;
-	err = dlogg_mac_send(buffer[0], sizeof(buffer[0][0]), NULL );
-	if (err != COMMON_TYPE_SUCCESS)
-		return err;
+	return dlogg_mac_send(context, &request, sizeof(request), NULL );
+}
+
+/**
+ * @brief Reads the current-data response and stores the samples into the
+ * line's buffer
+ * @details The function assumes that the request was issued before. The
+ * sampleCount field will be updated according to the read data.
+ * @param context The valid MAC instance
+ * @param activeLine The instance's line id to read
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_cd_receiveCurrentData(
+		dlogg_mac_context_t *context, uint8_t activeLine) {
+	common_type_error_t err[DLOGG_CD_MAX_LINES];
 
-	sampleCount = dlogg_cd_getSampleCount(&lineData->metaData);
-	assert(sampleCount <= DLOGG_CD_MAX_SAMPLES_PER_MSG);
+	assert(activeLine < DLOGG_CD_MAX_LINES);
+
+	dlogg_cd_receiveLines(context, 1u << activeLine, err);
+	return err[activeLine];
+}
+
+/**
+ * @brief Receives the current-data responses of several lines concurrently
+ * @details Every line's receiver is advanced as far as the bytes at hand
+ * allow. Afterwards, the function waits until one of the pending lines has
+ * more bytes to receive. If the transaction's deadline passes, every line still
+ * pending fails. The samples of each line received completely are stored into
+ * the line's buffer.
+ * @param context The valid MAC instance
+ * @param lines The bit mask of the instance's lines to receive, the requests
+ * have to be issued before
+ * @param err The vector receiving the status of each line given
+ */
+static void dlogg_cd_receiveLines(dlogg_mac_context_t *context,
+		unsigned int lines, common_type_error_t *err) {
+	dlogg_cd_receiver_t rx[DLOGG_CD_MAX_LINES];
+	dlogg_cd_lineData_t *lineData;
+	unsigned int pending = 0, ready;
+	common_type_error_t waitErr;
+	uint8_t i;
+
+	assert(context != NULL);
+	assert(err != NULL);
+
+	for (i = 0; i < DLOGG_CD_MAX_LINES; i++) {
+		if (!(lines & (1u << i)))
+			continue;
+
+		lineData = dlogg_cd_getLineData(context, i);
+		if (lineData == NULL) {
+			err[i] = COMMON_TYPE_ERR_INVALID_ADDRESS;
+			continue;
+		}
+		dlogg_cd_startReceiver(&rx[i], lineData);
+		err[i] = COMMON_TYPE_SUCCESS;
+		pending |= 1u << i;
+	}
+
+	ready = pending;
+	while (pending != 0) {
+		for (i = 0; i < DLOGG_CD_MAX_LINES; i++) {
+			if (!(ready & (1u << i)))
+				continue;
+
+			lineData = dlogg_cd_getLineData(context, i);
+			err[i] = dlogg_mac_selectLine(context, i);
+			if (err[i] == COMMON_TYPE_SUCCESS) {
+				err[i] = dlogg_cd_stepReceiver(context, &rx[i], lineData);
+			}
+			if (err[i] != COMMON_TYPE_SUCCESS || rx[i].state == DLOGG_CD_RX_DONE) {
+				pending &= ~(1u << i);
+			}
+		}
+		if (pending == 0)
+			break;
+
+		ready = pending;
+		waitErr = dlogg_mac_awaitLines(context, &ready);
+		if (waitErr != COMMON_TYPE_SUCCESS) {
+			for (i = 0; i < DLOGG_CD_MAX_LINES; i++) {
+				if (pending & (1u << i)) {
+					err[i] = waitErr;
+				}
+			}
+			break;
+		}
+	}
+
+	for (i = 0; i < DLOGG_CD_MAX_LINES; i++) {
+		if ((lines & (1u << i)) && err[i] == COMMON_TYPE_SUCCESS) {
+			dlogg_cd_storeSamples(&rx[i], dlogg_cd_getLineData(context, i));
+		}
+	}
+}
+
+/**
+ * @brief Prepares receiving the current-data response of a line
+ * @details The number of samples expected is given by the line's meta-data.
+ * @param rx The receiver to initialize
+ * @param lineData The valid line data holding up-to-date meta-data
+ */
+static inline void dlogg_cd_startReceiver(dlogg_cd_receiver_t *rx,
+		dlogg_cd_lineData_t *lineData) {
+	assert(rx != NULL);
+	assert(lineData != NULL);
 
 	// clear buffer to ease debugging
-	memset(buffer, 0, sizeof(buffer));
+	memset(rx, 0, sizeof(*rx));
 
-	chksum = 0;
-	for (i = 0; i < sampleCount; i++) {
-		uint8_t deviceID;
+	rx->sampleCount = dlogg_cd_getSampleCount(&lineData->metaData);
+	assert(rx->sampleCount <= DLOGG_CD_MAX_SAMPLES_PER_MSG);
 
-		// Read device ID
-		err = dlogg_mac_read(&deviceID, sizeof(deviceID), &chksum);
-		if (err != COMMON_TYPE_SUCCESS)
-			return err;
+	rx->chksum = DLOGG_MAC_INITIAL_CHKSUM;
+	if (rx->sampleCount > 0) {
+		rx->state = DLOGG_CD_RX_DEVICE_ID;
+		rx->target = &rx->deviceID;
+		rx->expected = sizeof(rx->deviceID);
+	} else {
+		rx->state = DLOGG_CD_RX_CHKSUM;
+		rx->target = (uint8_t *) &rx->chksumRead;
+		rx->expected = sizeof(rx->chksumRead);
+	}
+}
 
-		logging_adapter_debug("Got device ID 0x%x in sample %u",
-				(unsigned) deviceID, (unsigned) i);
+/**
+ * @brief Advances the receiver of the selected line as far as possible
+ * @details The bytes at hand are consumed without waiting for more. If the
+ * response isn't complete yet, the function succeeds leaving the receiver in a
+ * state other than DLOGG_CD_RX_DONE. It has to be called again after more
+ * bytes arrived.
+ * @param context The valid MAC instance having the receiver's line selected
+ * @param rx The line's started receiver
+ * @param lineData The valid line data holding the meta-data
+ * @return The status of the operation
+ */
+static common_type_error_t dlogg_cd_stepReceiver(dlogg_mac_context_t *context,
+		dlogg_cd_receiver_t *rx, dlogg_cd_lineData_t *lineData) {
+	common_type_error_t err;
+	size_t received;
 
-		sampleType[i] = dlogg_cd_getSampleType(deviceID, &lineData->metaData);
-		if (sampleType[i] < 0)
-			return COMMON_TYPE_ERR_INVALID_RESPONSE;
+	assert(rx != NULL);
+	assert(lineData != NULL);
 
-		// Read device data
-		err = dlogg_mac_read(buffer[i], dlogg_cd_getSampleSize(sampleType[i]),
-				&chksum);
+	while (rx->state != DLOGG_CD_RX_DONE) {
+		err = dlogg_mac_receive(context, &rx->target[rx->received],
+				rx->expected - rx->received, &received,
+				rx->state == DLOGG_CD_RX_CHKSUM ? NULL : &rx->chksum);
 		if (err != COMMON_TYPE_SUCCESS)
 			return err;
 
-		dlogg_cd_debug_buffer("raw-sample", buffer[i],
-				dlogg_cd_getSampleSize(sampleType[i]));
+		rx->received += received;
+		if (rx->received < rx->expected)
+			return COMMON_TYPE_SUCCESS; // resume after more bytes arrived
+
+		switch (rx->state) {
+		case DLOGG_CD_RX_DEVICE_ID:
+			logging_adapter_debug("Got device ID 0x%x in sample %u of line %u",
+					(unsigned) rx->deviceID, (unsigned) rx->sample,
+					(unsigned) lineData->lineID);
+
+			rx->sampleType[rx->sample] = dlogg_cd_getSampleType(rx->deviceID,
+					&lineData->metaData);
+			if (rx->sampleType[rx->sample] < 0)
+				return COMMON_TYPE_ERR_INVALID_RESPONSE;
+
+			rx->state = DLOGG_CD_RX_SAMPLE;
+			rx->target = rx->buffer[rx->sample];
+			rx->expected = dlogg_cd_getSampleSize(rx->sampleType[rx->sample]);
+			break;
+		case DLOGG_CD_RX_SAMPLE:
+			dlogg_cd_debug_buffer("raw-sample", rx->buffer[rx->sample],
+					rx->expected);
+
+			rx->sample++;
+			if (rx->sample < rx->sampleCount) {
+				rx->state = DLOGG_CD_RX_DEVICE_ID;
+				rx->target = &rx->deviceID;
+				rx->expected = sizeof(rx->deviceID);
+			} else {
+				rx->state = DLOGG_CD_RX_CHKSUM;
+				rx->target = (uint8_t *) &rx->chksumRead;
+				rx->expected = sizeof(rx->chksumRead);
+			}
+			break;
+		case DLOGG_CD_RX_CHKSUM:
+			err = dlogg_mac_checkChksum(context, rx->chksum, rx->chksumRead);
+			if (err != COMMON_TYPE_SUCCESS)
+				return err;
+
+			rx->state = DLOGG_CD_RX_DONE;
+			break;
+		default:
+			assert(0);
+		}
+		rx->received = 0;
 	}
 
-	err = dlogg_mac_read_chksum(&chksum);
-	if (err != COMMON_TYPE_SUCCESS)
-		return err;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Copies the samples of a completely received response
+ * @details The sampleCount field of the line's meta-data is updated.
+ * @param rx The receiver in the DLOGG_CD_RX_DONE state
+ * @param lineData The valid line data to update
+ */
+static inline void dlogg_cd_storeSamples(const dlogg_cd_receiver_t *rx,
+		dlogg_cd_lineData_t *lineData) {
+	uint8_t i;
+
+	assert(rx != NULL);
+	assert(lineData != NULL);
+	assert(rx->state == DLOGG_CD_RX_DONE);
 
 	// Checks passed, copy data
-	for (i = 0; i < sampleCount; i++) {
-		memcpy(&lineData->samples[i].data, buffer[i],
+	for (i = 0; i < rx->sampleCount; i++) {
+		memcpy(&lineData->samples[i].data, rx->buffer[i],
 				sizeof(lineData->samples[i].data));
-		lineData->samples[i].sampleType = sampleType[i];
+		lineData->samples[i].sampleType = rx->sampleType[i];
 
 		logging_adapter_debug("Buffer sample %u with sampleType 0x%x", (unsigned) i,
-				(unsigned) sampleType[i]);
+				(unsigned) rx->sampleType[i]);
 	}
 
 	// update sample count
-	lineData->metaData.sampleCount = sampleCount;
-
-	return COMMON_TYPE_SUCCESS;
+	lineData->metaData.sampleCount = rx->sampleCount;
 }
 
 /**
@@ -266,8 +766,8 @@ static inline common_type_error_t dlogg_cd_checkDLMode(
 		return COMMON_TYPE_ERR_INVALID_RESPONSE;
 	}
 
-	if (metadata->moduleType.type == DLOGG_CD_MOD_TYPE_DLOGG_1D
-			&& metadata->moduleType.type == DLOGG_CD_MOD_TYPE_DLOGG_2D
+	if ((metadata->moduleType.type == DLOGG_CD_MOD_TYPE_DLOGG_1D
+			|| metadata->moduleType.type == DLOGG_CD_MOD_TYPE_DLOGG_2D)
 			&& metadata->moduleType.firmware < 29) {
 		logging_adapter_info("The device's firmware version %ue-1 isn't supported.",
 				(unsigned) metadata->moduleType.firmware);
@@ -291,28 +791,33 @@ static inline common_type_error_t dlogg_cd_checkDLMode(
 
 /**
  * @brief Fetches the meta-data from the currently active logger
- * @details The data will be stored in the appropriate structure. If the
- * function fails the content of the data structure may be undefined
- * @param activeLine The currently active line identifier
+ * @details The data will be stored in the appropriate structure and marked as
+ * valid. If the function fails the content of the data structure may be
+ * undefined and it is marked as invalid.
+ * @param context The valid MAC instance
+ * @param activeLine The instance's currently active line identifier
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_cd_fetchMetaData(uint8_t activeLine) {
+static inline common_type_error_t dlogg_cd_fetchMetaData(
+		dlogg_mac_context_t *context, uint8_t activeLine) {
 	common_type_error_t err;
-	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(activeLine);
+	dlogg_cd_lineData_t * lineData = dlogg_cd_getLineData(context, activeLine);
 	uint8_t buffer;
 
 	if (lineData == NULL )
 		return COMMON_TYPE_ERR_INVALID_ADDRESS;
 
-	err = dlogg_cd_fetchModuleType(&lineData->metaData.moduleType);
+	lineData->metaDataValid = 0;
+
+	err = dlogg_cd_fetchModuleType(context, &lineData->metaData.moduleType);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
-	err = dlogg_cd_fetchOperationMode(&buffer);
+	err = dlogg_cd_fetchOperationMode(context, &buffer);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
-	err = dlogg_cd_fetchModuleMode(&lineData->metaData.mode);
+	err = dlogg_cd_fetchModuleMode(context, &lineData->metaData.mode);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
@@ -322,16 +827,22 @@ static inline common_type_error_t dlogg_cd_fetchMetaData(uint8_t activeLine) {
 			(unsigned) lineData->metaData.moduleType.firmware,
 			(unsigned) lineData->metaData.mode);
 
+	lineData->metaDataTime = dlogg_cd_getMonotonicTime();
+	lineData->metaDataValid = 1;
+	dlogg_sc_setMetadata(&context->stateCache, activeLine, &lineData->metaData);
+
 	return COMMON_TYPE_SUCCESS;
 }
 
 /**
  * @brief Fetches the current operation mode and stores it in the given mode
  * variable
+ * @param context The valid MAC instance
  * @param mode The reference to the mode destination
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_cd_fetchOperationMode(uint8_t * mode) {
+static inline common_type_error_t dlogg_cd_fetchOperationMode(
+		dlogg_mac_context_t *context, uint8_t * mode) {
 	common_type_error_t err;
 	// request id, second byte from winsol communication
 	uint8_t buffer[2] = { 0x21, 0x43 };
@@ -340,11 +851,12 @@ static inline common_type_error_t dlogg_cd_fetchOperationMode(uint8_t * mode) {
 
 	dlogg_cd_coffeeBreak(); // Won't produce any output otherwise
 
-	err = dlogg_mac_send(buffer, sizeof(buffer), NULL );
+	dlogg_mac_startTransaction(context);
+	err = dlogg_mac_send(context, buffer, sizeof(buffer), NULL );
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
-	err = dlogg_mac_read(mode, sizeof(*mode), NULL );
+	err = dlogg_mac_read(context, mode, sizeof(*mode), NULL );
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
@@ -355,10 +867,12 @@ static inline common_type_error_t dlogg_cd_fetchOperationMode(uint8_t * mode) {
 /**
  * @brief Fetches the current module mode and stores it in the given mode
  * variable
+ * @param context The valid MAC instance
  * @param mode The reference to the mode destination
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_cd_fetchModuleMode(uint8_t * mode) {
+static inline common_type_error_t dlogg_cd_fetchModuleMode(
+		dlogg_mac_context_t *context, uint8_t * mode) {
 	common_type_error_t err;
 	uint8_t buffer = 0x81; // request id
 
@@ -366,11 +880,12 @@ static inline common_type_error_t dlogg_cd_fetchModuleMode(uint8_t * mode) {
 
 	dlogg_cd_coffeeBreak(); // Won't produce any output otherwise
 
-	err = dlogg_mac_send(&buffer, sizeof(buffer), NULL );
+	dlogg_mac_startTransaction(context);
+	err = dlogg_mac_send(context, &buffer, sizeof(buffer), NULL );
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
-	err = dlogg_mac_read(mode, sizeof(*mode), NULL );
+	err = dlogg_mac_read(context, mode, sizeof(*mode), NULL );
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
@@ -380,11 +895,12 @@ static inline common_type_error_t dlogg_cd_fetchModuleMode(uint8_t * mode) {
 
 /**
  * @brief Tries to fetch the currently active module type
+ * @param context The valid MAC instance
  * @param moduleType The destination to write the type
  * @return The status of the operation
  */
 static inline common_type_error_t dlogg_cd_fetchModuleType(
-		dlogg_cd_moduleType_t * moduleType) {
+		dlogg_mac_context_t *context, dlogg_cd_moduleType_t * moduleType) {
 	common_type_error_t err;
 	dlogg_mac_chksum_t chksum;
 	uint8_t buffer[7] = { 0x20, 0x10, 0x18, 0, 0, 0, 0 }; // request data
@@ -394,16 +910,17 @@ static inline common_type_error_t dlogg_cd_fetchModuleType(
 	assert(sizeof(*moduleType) <= sizeof(buffer));
 
 // Issue request
+	dlogg_mac_startTransaction(context);
 	chksum = 0;
-	err = dlogg_mac_send(buffer, sizeof(buffer), &chksum);
+	err = dlogg_mac_send(context, buffer, sizeof(buffer), &chksum);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
-	err = dlogg_mac_send_chksum(&chksum);
+	err = dlogg_mac_send_chksum(context, &chksum);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
 // Fetch Acknowledge
-	err = dlogg_mac_read(buffer, 2, NULL );
+	err = dlogg_mac_read(context, buffer, 2, NULL );
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
@@ -417,12 +934,12 @@ static inline common_type_error_t dlogg_cd_fetchModuleType(
 
 // Fetch module type
 	chksum = 0;
-	err = dlogg_mac_read(buffer, sizeof(*moduleType), &chksum);
+	err = dlogg_mac_read(context, buffer, sizeof(*moduleType), &chksum);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
 	dlogg_cd_debug_buffer("ModuleType", buffer, sizeof(*moduleType));
-	err = dlogg_mac_read_chksum(&chksum);
+	err = dlogg_mac_read_chksum(context, &chksum);
 	if (err != COMMON_TYPE_SUCCESS)
 		return err;
 
@@ -443,18 +960,17 @@ static inline void dlogg_cd_coffeeBreak(void) {
 	(void) nanosleep(&tv, NULL );
 }
 
-dlogg_cd_metadata_t * dlogg_cd_getMetadata(uint8_t lineID) {
-	dlogg_cd_lineData_t *line = dlogg_cd_getLineData(lineID);
-	if (line != NULL ) {
-		return &line->metaData;
-	} else {
-		return NULL ;
-	}
+const dlogg_cd_metadata_t * dlogg_cd_getMetadata(
+		const dlogg_cd_lineData_t *line) {
+	assert(line != NULL);
+	return &line->metaData;
 }
 
-dlogg_cd_sample_t * dlogg_cd_getCurrentData(uint8_t device, uint8_t lineID) {
-	dlogg_cd_lineData_t *line = dlogg_cd_getLineData(lineID);
-	if (line != NULL && device < line->metaData.sampleCount) {
+const dlogg_cd_sample_t * dlogg_cd_getCurrentData(
+		const dlogg_cd_lineData_t *line, uint8_t device) {
+	assert(line != NULL);
+
+	if (device < line->metaData.sampleCount) {
 		return &line->samples[device];
 	} else {
 		return NULL;
@@ -463,13 +979,40 @@ dlogg_cd_sample_t * dlogg_cd_getCurrentData(uint8_t device, uint8_t lineID) {
 
 /**
  * @brief Function used to fetch a line's data.
- * @details currently only lineID == 0 is supported
- * @param lineID The communication line's unique identifier
- * @return The line's data or NULL it the line wasn't registered before
+ * @param context The valid MAC instance
+ * @param activeLine The line's identifier relative to the instance
+ * @return The line's data or NULL it the line isn't served by the instance
  */
-static dlogg_cd_lineData_t * dlogg_cd_getLineData(uint8_t lineID) {
-	assert(lineID == 0);
-	return &dlogg_cd_data;
+static dlogg_cd_lineData_t * dlogg_cd_getLineData(
+		dlogg_mac_context_t *context, uint8_t activeLine) {
+	assert(context != NULL);
+
+	if (activeLine >= context->currentData.lineCount)
+		return NULL;
+	return &context->currentData.lines[activeLine];
+}
+
+const dlogg_cd_lineData_t * dlogg_cd_getLine(uint8_t lineID) {
+	dlogg_mac_context_t *context = dlogg_cd_getLineContext(lineID);
+
+	if (context == NULL)
+		return NULL;
+	return &context->currentData.lines[lineID
+			- context->currentData.firstLine];
+}
+
+dlogg_mac_context_t * dlogg_cd_getLineContext(uint8_t lineID) {
+	dlogg_cd_state_t *state;
+	unsigned int i;
+
+	for (i = 0; i < dlogg_cd_registry.length; i++) {
+		state = &dlogg_cd_registry.contexts[i]->currentData;
+		if (lineID >= state->firstLine
+				&& lineID < state->firstLine + state->lineCount) {
+			return dlogg_cd_registry.contexts[i];
+		}
+	}
+	return NULL;
 }
 
 /**
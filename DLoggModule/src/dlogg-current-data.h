@@ -25,7 +25,12 @@
 #ifndef DLOGG_CURRENT_DATA_H_
 #define DLOGG_CURRENT_DATA_H_
 
+#include "dlogg-mac.h"
+
+#include <common-type.h>
+#include <libconfig.h>
 #include <stdint.h>
+#include <time.h>
 
 /** @brief The module-type request acknowledgment code */
 #define DLOGG_CD_MOD_TYPE_ACK (0x4321)
@@ -52,6 +57,19 @@
 /** @brief No device registered */
 #define DLOGG_CD_DEVICE_NO (0xAB)
 
+/**
+ * @brief The maximum number of lines served by a single MAC instance
+ * @details Each line corresponds to a D-LOGG device attached to its own
+ * interface.
+ */
+#define DLOGG_CD_MAX_LINES (8)
+
+/** @brief The maximum number of lines served by every MAC instance together */
+#define DLOGG_CD_MAX_GLOBAL_LINES (256)
+
+/** @brief The maximum number of data samples per active-data message */
+#define DLOGG_CD_MAX_SAMPLES_PER_MSG (2)
+
 /** @brief UVR 61-3 protocol version 1.4 sample type */
 #define DLOGG_CD_SAMPLE_UVR_61_3_V14 (0)
 
@@ -186,27 +204,111 @@ typedef struct {
 	} data;
 } dlogg_cd_sample_t;
 
+/**
+ * @brief Encapsulates the data fetched from one data line.
+ * @details Each line communicates with different control equipment. The sample
+ * count of the meta-data is zero, if the line's current data isn't available.
+ */
+typedef struct {
+	/** @brief The line's global identifier */
+	uint8_t lineID;
+	/** @brief The line's meta-data */
+	dlogg_cd_metadata_t metaData;
+	/** @brief The monotonic time in seconds the meta-data was fetched */
+	time_t metaDataTime;
+	/** @brief Flag indicating that the cached meta-data may be used */
+	unsigned int metaDataValid :1;
+	/** @brief The device's data */
+	dlogg_cd_sample_t samples[DLOGG_CD_MAX_SAMPLES_PER_MSG];
+} dlogg_cd_lineData_t;
+
+/** @brief Structure encapsulating the current data of a MAC instance */
+typedef struct {
+	/** @brief The currently buffered data of each line */
+	dlogg_cd_lineData_t lines[DLOGG_CD_MAX_LINES];
+	/** @brief The number of lines served by the instance */
+	uint8_t lineCount;
+	/** @brief The global identifier of the instance's first line */
+	unsigned int firstLine;
+	/**
+	 * @brief The number of seconds the meta-data is cached
+	 * @details Zero disables refreshing the meta-data periodically.
+	 */
+	int metaDataRefresh;
+	/** @brief Flag indicating that the instance's lines are registered */
+	unsigned int registered :1;
+} dlogg_cd_state_t;
+
 /* ************************************************************************** */
 /* Function prototypes                                                        */
 /* ************************************************************************** */
 
+/**
+ * @brief Initializes the current data buffer of a MAC instance
+ * @details The function has to be called by the MAC layer's init function. It
+ * reads the optional "metadata-refresh" directive of the MAC configuration
+ * specifying the number of seconds the meta-data is cached. By default, the
+ * meta-data is only fetched again if a response doesn't fit. Every line served
+ * by the instance is fetched on each sync. The instance's lines are numbered
+ * after the lines of every instance initialized before, the first line of the
+ * first instance is zero.
+ * @param context The valid MAC instance
+ * @param configuration The valid MAC configuration group
+ * @param lineCount The number of lines served, [1,DLOGG_CD_MAX_LINES]
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_cd_init(dlogg_mac_context_t *context,
+		config_setting_t *configuration, uint8_t lineCount);
+
+/**
+ * @brief Withdraws the lines of a MAC instance
+ * @details The function has to be called by the MAC layer's free function. The
+ * global identifiers of other instances' lines remain unchanged.
+ * @param context The valid MAC instance
+ */
+void dlogg_cd_free(dlogg_mac_context_t *context);
+
+/**
+ * @brief Looks up the data of a line served by any MAC instance
+ * @details The lines are looked up across every MAC instance, which mustn't be
+ * created or freed concurrently. The reference remains valid until the serving
+ * instance is freed, so it may be looked up once in advance. The line's data
+ * is only modified by the instance's sync function. Thus, several threads may
+ * read it concurrently as long as the instance isn't synchronized. The caller
+ * mustn't modify the data.
+ * @param lineID The communication line's global identifier
+ * @return The line's data or NULL if the line isn't served
+ */
+const dlogg_cd_lineData_t * dlogg_cd_getLine(uint8_t lineID);
+
+/**
+ * @brief Looks up the MAC instance serving a line
+ * @details See dlogg_cd_getLine for more details.
+ * @param lineID The communication line's global identifier
+ * @return The serving instance or NULL if the line isn't served
+ */
+dlogg_mac_context_t * dlogg_cd_getLineContext(uint8_t lineID);
+
 /**
  * @brief returns the previously read meta data section.
  * @details before accessing the meta-data the sync function must be called.
- * The caller must not write to the meta-data section passed.
- * @param lineID The communication line's unique identifier
- * @return The currently active meta-data section
+ * See dlogg_cd_getLine for more details.
+ * @param line The valid line's data returned by dlogg_cd_getLine
+ * @return The line's meta-data section
  */
-dlogg_cd_metadata_t * dlogg_cd_getMetadata(uint8_t lineID);
+const dlogg_cd_metadata_t * dlogg_cd_getMetadata(
+		const dlogg_cd_lineData_t *line);
 
 /**
  * @brief Returns the currently buffered sample
  * @details It is assumed that the sync function was called successfully before.
- * The caller mustn't modify the given data structure.
+ * If the line couldn't be synchronized, no sample is available. See
+ * dlogg_cd_getLine for more details.
+ * @param line The valid line's data returned by dlogg_cd_getLine
  * @param device The device number or logger's channel
- * @param lineID The communication line's id.
- * @return The available sample
+ * @return The available sample or NULL
  */
-dlogg_cd_sample_t * dlogg_cd_getCurrentData(uint8_t device, uint8_t lineID);
+const dlogg_cd_sample_t * dlogg_cd_getCurrentData(
+		const dlogg_cd_lineData_t *line, uint8_t device);
 
 #endif /* DLOGG_CURRENT_DATA_H_ */
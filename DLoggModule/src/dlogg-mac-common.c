@@ -27,26 +27,52 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 #include <logging-adapter.h>
 
-common_type_error_t dlogg_mac_send_chksum(dlogg_mac_chksum_t * chksum) {
-	return dlogg_mac_send((uint8_t *) chksum, sizeof(*chksum), NULL );
+dlogg_mac_context_t * dlogg_mac_newContext(void) {
+	dlogg_mac_context_t *context;
+
+	context = calloc(1, sizeof(*context));
+	if (context == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return NULL;
+	}
+
+	context->timeout = DLOGG_MAC_DEF_TIMEOUT;
+	return context;
+}
+
+common_type_error_t dlogg_mac_send_chksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t * chksum) {
+	return dlogg_mac_send(context, (uint8_t *) chksum, sizeof(*chksum), NULL );
 }
 
-common_type_error_t dlogg_mac_read_chksum(dlogg_mac_chksum_t * chksum) {
+common_type_error_t dlogg_mac_read_chksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t * chksum) {
 	common_type_error_t err;
 	dlogg_mac_chksum_t chksumRead;
 
+	assert(context != NULL);
 	assert(chksum != NULL);
 
-	err = dlogg_mac_read((uint8_t *) &chksumRead, sizeof(chksumRead), NULL );
+	err = dlogg_mac_read(context, (uint8_t *) &chksumRead, sizeof(chksumRead),
+			NULL );
 	if (err != COMMON_TYPE_SUCCESS) {
 		return err;
 	}
 
-	if (*chksum != chksumRead) {
+	return dlogg_mac_checkChksum(context, *chksum, chksumRead);
+}
+
+common_type_error_t dlogg_mac_checkChksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t expected, dlogg_mac_chksum_t received) {
+	assert(context != NULL);
+
+	if (expected != received) {
 		logging_adapter_info("Received invalid checksum %u, %u expected.",
-				(unsigned int) chksumRead, (unsigned int) *chksum);
+				(unsigned int) received, (unsigned int) expected);
+		context->statistics.checksumErrors++;
 		return COMMON_TYPE_ERR_INVALID_RESPONSE;
 	}
 	return COMMON_TYPE_SUCCESS;
@@ -64,3 +90,61 @@ void dlogg_mac_updateChksum(uint8_t * buffer, size_t length,
 		}
 	}
 }
+
+const dlogg_mac_statistics_t * dlogg_mac_getStatistics(
+		const dlogg_mac_context_t *context) {
+	assert(context != NULL);
+	return &context->statistics;
+}
+
+void dlogg_mac_logStatistics(const dlogg_mac_context_t *context) {
+	const dlogg_mac_statistics_t *statistics;
+
+	assert(context != NULL);
+
+	statistics = &context->statistics;
+	if (statistics->timeouts == 0 && statistics->checksumErrors == 0
+			&& statistics->ioErrors == 0) {
+		return;
+	}
+
+	logging_adapter_info("D-LOGG transmission errors: %lu timeout(s), %lu "
+			"checksum error(s), %lu I/O error(s)", statistics->timeouts,
+			statistics->checksumErrors, statistics->ioErrors);
+}
+
+common_type_error_t dlogg_mac_initTimeout(dlogg_mac_context_t *context,
+		config_setting_t *configuration) {
+	int timeout = DLOGG_MAC_DEF_TIMEOUT;
+
+	assert(context != NULL);
+	assert(configuration != NULL);
+
+	if (config_setting_lookup_int(configuration, DLOGG_MAC_CONFIG_TIMEOUT,
+			&timeout) && timeout < 1) {
+		logging_adapter_info("The %s configuration directive has to be positive: "
+				"%d", DLOGG_MAC_CONFIG_TIMEOUT, timeout);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	context->timeout = timeout;
+	return COMMON_TYPE_SUCCESS;
+}
+
+void dlogg_mac_startTransaction(dlogg_mac_context_t *context) {
+	assert(context != NULL);
+	context->deadline = dlogg_mac_getMonotonicTime()
+			+ (int64_t) context->timeout * 1000;
+}
+
+long dlogg_mac_remainingTime(const dlogg_mac_context_t *context) {
+	assert(context != NULL);
+	return (long) (context->deadline - dlogg_mac_getMonotonicTime());
+}
+
+int64_t dlogg_mac_getMonotonicTime(void) {
+	struct timespec now = { 0, 0 };
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
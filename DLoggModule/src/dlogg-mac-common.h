@@ -26,6 +26,53 @@
 #define DLOGG_MAC_COMMON_H_
 
 #include "dlogg-mac.h"
+#include "dlogg-capture.h"
+#include "dlogg-current-data.h"
+#include "dlogg-state-cache.h"
+
+#include <libconfig.h>
+#include <stdint.h>
+
+/** @brief The transaction timeout directive */
+#define DLOGG_MAC_CONFIG_TIMEOUT "timeout"
+
+/** @brief The default transaction timeout in milliseconds */
+#define DLOGG_MAC_DEF_TIMEOUT (2000)
+
+/**
+ * @brief The state of the interface specific MAC implementation
+ * @details The structure is defined by each implementation separately.
+ */
+struct dlogg_mac_backend;
+
+/** @brief The state of a single MAC module instance */
+struct dlogg_mac_context {
+	/** @brief The error counters updated by the MAC layer implementations */
+	dlogg_mac_statistics_t statistics;
+	/** @brief The transaction timeout in milliseconds */
+	int timeout;
+	/**
+	 * @brief The absolute deadline of the current transaction
+	 * @details The deadline is given in microseconds of the monotonic clock.
+	 */
+	int64_t deadline;
+	/** @brief The buffered current data of the instance's lines */
+	dlogg_cd_state_t currentData;
+	/** @brief The state cached between invocations */
+	dlogg_sc_state_t stateCache;
+	/** @brief The state of the traffic capture */
+	dlogg_cap_state_t capture;
+	/** @brief The implementation specific state */
+	struct dlogg_mac_backend *backend;
+};
+
+/**
+ * @brief Allocates a new MAC instance
+ * @details Every member is zero initialized except the default timeout. The
+ * implementation has to set the backend.
+ * @return The new instance or NULL if there isn't enough memory
+ */
+dlogg_mac_context_t * dlogg_mac_newContext(void);
 
 /**
  * @brief Updates the checksum value, if any
@@ -40,5 +87,54 @@
 void dlogg_mac_updateChksum(uint8_t * buffer, size_t length,
 		dlogg_mac_chksum_t* chksum);
 
+/**
+ * @brief Compares the checksum received with the one calculated
+ * @details A mismatch is reported and counted.
+ * @param context The valid MAC instance
+ * @param expected The checksum calculated over the response
+ * @param received The checksum received
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_mac_checkChksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t expected, dlogg_mac_chksum_t received);
+
+/**
+ * @brief Reports the error counters, if any error occurred
+ * @param context The valid MAC instance
+ */
+void dlogg_mac_logStatistics(const dlogg_mac_context_t *context);
+
+/**
+ * @brief Reads the optional transaction timeout of the MAC configuration
+ * @param context The valid MAC instance
+ * @param configuration The valid MAC configuration group
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_mac_initTimeout(dlogg_mac_context_t *context,
+		config_setting_t *configuration);
+
+/**
+ * @brief Sets the absolute deadline of a new transaction
+ * @details The deadline is based on the monotonic clock, so changing the
+ * system time doesn't affect it. The function has to be called once before
+ * sending a request. Every fragment sent and every byte received until the
+ * response is complete share the deadline.
+ * @param context The valid MAC instance
+ */
+void dlogg_mac_startTransaction(dlogg_mac_context_t *context);
+
+/**
+ * @brief Returns the time left until the current transaction's deadline
+ * @param context The valid MAC instance
+ * @return The remaining time in microseconds, zero or negative if the deadline
+ * passed
+ */
+long dlogg_mac_remainingTime(const dlogg_mac_context_t *context);
+
+/**
+ * @brief Returns the current time of the monotonic clock
+ * @return The time in microseconds
+ */
+int64_t dlogg_mac_getMonotonicTime(void);
 
 #endif /* DLOGG_MAC_COMMON_H_ */
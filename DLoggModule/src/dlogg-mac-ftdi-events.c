@@ -0,0 +1,44 @@
+/**
+ * @file dlogg-mac-ftdi-events.c
+ * @brief Implements the access to libftdi's transfer structures
+ * @details The file has to be compiled without -fpack-struct.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dlogg-mac-ftdi-events.h"
+
+#include <assert.h>
+#include <libusb.h>
+#include <stdlib.h>
+
+int dlogg_mac_ftdiHandleEvents(struct ftdi_context *ftdi,
+		struct ftdi_transfer_control *transferCtrl, struct timeval *tv) {
+	assert(ftdi != NULL);
+	assert(transferCtrl != NULL);
+	assert(tv != NULL);
+
+	return libusb_handle_events_timeout_completed(ftdi->usb_ctx, tv,
+			&transferCtrl->completed);
+}
+
+int dlogg_mac_ftdiIsCompleted(const struct ftdi_transfer_control *transferCtrl) {
+	assert(transferCtrl != NULL);
+
+	return transferCtrl->completed;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file dlogg-mac-ftdi-events.h
+ * @brief The header file specifies the access to libftdi's transfer structures
+ * @details The MAC layer is compiled using -fpack-struct, which changes the
+ * layout of the library's structures. The functions of this module are compiled
+ * without packing and read the structures on behalf of the MAC layer. Hence,
+ * the module mustn't include any of the MAC layer's packed types. The
+ * definitions of this module arn't meant to be used outside the MAC layer.
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DLOGG_MAC_FTDI_EVENTS_H_
+#define DLOGG_MAC_FTDI_EVENTS_H_
+
+#include <ftdi.h>
+#include <sys/time.h>
+
+/**
+ * @brief Handles pending USB events until the transfer completes or the
+ * timeout expires
+ * @param ftdi The valid library context the transfer was submitted to
+ * @param transferCtrl The valid, submitted transfer
+ * @param tv The maximum time to wait
+ * @return The libusb status code, zero on success
+ */
+int dlogg_mac_ftdiHandleEvents(struct ftdi_context *ftdi,
+		struct ftdi_transfer_control *transferCtrl, struct timeval *tv);
+
+/**
+ * @brief Checks whether the given transfer is completed
+ * @param transferCtrl The valid, submitted transfer
+ * @return Non-zero if the transfer is completed
+ */
+int dlogg_mac_ftdiIsCompleted(const struct ftdi_transfer_control *transferCtrl);
+
+#endif /* DLOGG_MAC_FTDI_EVENTS_H_ */
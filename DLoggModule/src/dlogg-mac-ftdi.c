@@ -9,6 +9,11 @@
  * <p>To use the alternative MAC the kernel module ftdi_sio may need to be
  * unloaded and the libraries libftdi1.1 and libusb1.0 need to be available.
  * </p>
+ * <p>Each transfer is submitted asynchronously and libusb's events are handled
+ * until the transfer completes or the transaction's deadline passes. Hence, the
+ * response is processed as soon as the adapter forwards it. The adapter's
+ * latency timer is lowered to forward the short D-LOGG frames quickly.</p>
+ * <p>The FTDI MAC serves a single D-LOGG device, i.e. line 0 only.</p>
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -33,11 +38,17 @@
 
 #include <assert.h>
 #include <ftdi.h>
+#include <libusb.h>
 #include <stdint.h>
-#include <time.h>
+#include <stdlib.h>
+#include <sys/time.h>
 
 #include "dlogg-mac.h"
 #include "dlogg-mac-common.h"
+#include "dlogg-capture.h"
+#include "dlogg-mac-ftdi-events.h"
+#include "dlogg-current-data.h"
+#include "dlogg-state-cache.h"
 
 /** @brief Configuration directive specifying the internal device number */
 #define DLOGG_MAC_CONFIG_DEV_NR "device-nr"
@@ -45,28 +56,56 @@
 /** @brief The d-logg's transmission baud-rate */
 #define DLOGG_MAC_BAUDRATE (115200)
 
-/** @brief Number of poll requests while reading data */
-#define DLOGG_MAC_RETRY (20)
+/**
+ * @brief The adapter's latency timer in milliseconds
+ * @details The adapter forwards incomplete packets after the latency timer
+ * expires. The default value of 16ms dominates the transmission time of the
+ * short D-LOGG frames.
+ */
+#define DLOGG_MAC_LATENCY_TIMER (2)
 
-/** @brief Pointer to the main ftdi library context structure */
-static struct ftdi_context * dlogg_mac_ftdi = NULL;
+/**
+ * @brief The size of a single USB read request in bytes
+ * @details One full-speed bulk packet holds a whole D-LOGG frame plus the two
+ * modem status bytes. Larger requests don't speed up the short frames.
+ */
+#define DLOGG_MAC_READ_CHUNK_SIZE (64)
 
-/** @brief structure encapsulating common data */
-static struct {
+/** @brief The time in microseconds a cancelled transfer may take to finish */
+#define DLOGG_MAC_CANCEL_TIMEOUT (100000)
+
+/** @brief The libftdi specific state of a MAC instance */
+struct dlogg_mac_backend {
+	/** @brief Pointer to the main ftdi library context structure */
+	struct ftdi_context * ftdi;
 	/** @brief Flag indicating that the USB device was previously opened */
 	unsigned devOpened :1;
-} dlogg_mac_cData;
+};
 
 /* Function prototypes */
-static inline common_type_error_t dlogg_mac_initUART(int ttyID);
-static inline common_type_error_t dlogg_mac_openUSBDevice(int ttyID);
-static inline common_type_error_t dlogg_mac_setUARTParams(void);
-
-common_type_error_t fieldbus_mac_init(config_setting_t* configuration) {
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		int devNr);
+static inline common_type_error_t dlogg_mac_initUART(
+		dlogg_mac_context_t *context, int ttyID);
+static inline common_type_error_t dlogg_mac_openUSBDevice(
+		dlogg_mac_context_t *context, int ttyID);
+static inline int dlogg_mac_openCachedUSBDevice(dlogg_mac_context_t *context,
+		int ttyID);
+static inline common_type_error_t dlogg_mac_setUARTParams(
+		struct ftdi_context *ftdi);
+static common_type_error_t dlogg_mac_awaitTransfer(
+		dlogg_mac_context_t *context, struct ftdi_transfer_control *transferCtrl,
+		size_t length);
+
+common_type_error_t fieldbus_mac_initContext(config_setting_t* configuration,
+		fieldbus_mac_context_t *context) {
+	dlogg_mac_context_t *mac;
 	common_type_error_t err;
 	int devNr = -1;
 
 	assert(configuration != NULL);
+	assert(context != NULL);
 
 	if (config_setting_lookup_int(configuration, DLOGG_MAC_CONFIG_DEV_NR, &devNr)
 			&& devNr < 1) {
@@ -76,14 +115,66 @@ common_type_error_t fieldbus_mac_init(config_setting_t* configuration) {
 	}
 	devNr--;
 
-	err = dlogg_mac_initUART(devNr);
+	mac = dlogg_mac_newContext();
+	if (mac == NULL) {
+		return COMMON_TYPE_ERR;
+	}
+
+	err = dlogg_mac_initInstance(mac, configuration, devNr);
 	if (err != COMMON_TYPE_SUCCESS) {
+		(void) fieldbus_mac_freeContext(mac);
 		return err;
 	}
 
+	*context = mac;
 	return COMMON_TYPE_SUCCESS;
 }
 
+/**
+ * @brief Initializes the freshly allocated MAC instance
+ * @details The instance has to be freed by the caller if the function fails.
+ * @param context The valid MAC instance
+ * @param configuration The valid MAC configuration group
+ * @param devNr The number of the device to use or -1 if no device number is set
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		int devNr) {
+	common_type_error_t err;
+
+	assert(context != NULL);
+	assert(context->backend == NULL);
+
+	context->backend = calloc(1, sizeof(*context->backend));
+	if (context->backend == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	err = dlogg_mac_initTimeout(context, configuration);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	err = dlogg_sc_init(&context->stateCache, configuration);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	err = dlogg_cd_init(context, configuration, 1);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	err = dlogg_cap_init(&context->capture, configuration);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	return dlogg_mac_initUART(context, devNr);
+}
+
 /**
  * @brief Initializes the USB UART adapter of the D-LOGG device
  * @details If the ttyID is negative, the first fitting USB device will be used.
@@ -91,10 +182,13 @@ common_type_error_t fieldbus_mac_init(config_setting_t* configuration) {
  * order of the adapters is determined by libftdi and 0 specifies the first
  * device available. The differentiation between unset and valid numbers is used
  * to issue an appropriate warning, if multiple devices are available.
+ * @param context The valid MAC instance
  * @param ttyID The number of the device to use or -1 if no device number is set
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_mac_initUART(int ttyID) {
+static inline common_type_error_t dlogg_mac_initUART(
+		dlogg_mac_context_t *context, int ttyID) {
+	struct dlogg_mac_backend *backend = context->backend;
 	common_type_error_t err;
 	struct ftdi_version_info ftdiVersion;
 
@@ -105,18 +199,18 @@ static inline common_type_error_t dlogg_mac_initUART(int ttyID) {
 			ftdiVersion.version_str, ftdiVersion.major, ftdiVersion.minor,
 			ftdiVersion.micro, ftdiVersion.snapshot_str);
 
-	dlogg_mac_ftdi = ftdi_new();
-	if (dlogg_mac_ftdi == NULL ) {
+	backend->ftdi = ftdi_new();
+	if (backend->ftdi == NULL ) {
 		logging_adapter_info("Can't create a new ftdi context structure");
 		return COMMON_TYPE_ERR;
 	}
 
-	err = dlogg_mac_openUSBDevice(ttyID);
+	err = dlogg_mac_openUSBDevice(context, ttyID);
 	if (err != COMMON_TYPE_SUCCESS) {
 		return err;
 	}
 
-	return dlogg_mac_setUARTParams();
+	return dlogg_mac_setUARTParams(backend->ftdi);
 }
 
 /**
@@ -124,26 +218,37 @@ static inline common_type_error_t dlogg_mac_initUART(int ttyID) {
  * @details Lists available devices and chooses the device corresponding to the
  * ttyID. if ttyID < 0, the device number is treated as unset and the first
  * suitable device will be selected. The first device has the identifier zero.
- * The function assumes that the ftdi context was properly initialized.
+ * The function assumes that the ftdi context was properly initialized. If the
+ * device used by the previous invocation is known, it is opened directly
+ * without listing the devices. The device finally opened is stored in the
+ * state cache.
+ * @param context The valid MAC instance
  * @param ttyID The device id
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_mac_openUSBDevice(int ttyID) {
+static inline common_type_error_t dlogg_mac_openUSBDevice(
+		dlogg_mac_context_t *context, int ttyID) {
+	struct dlogg_mac_backend *backend = context->backend;
 	struct ftdi_device_list * devList = NULL;
 	struct ftdi_device_list * tmpDevEntry;
+	dlogg_sc_usbDevice_t usbDevice;
 	int retCode, i;
 
-	assert(dlogg_mac_ftdi != NULL);
+	assert(backend->ftdi != NULL);
 
-	retCode = ftdi_set_interface(dlogg_mac_ftdi, INTERFACE_ANY);
+	retCode = ftdi_set_interface(backend->ftdi, INTERFACE_ANY);
 	if (retCode) {
 		logging_adapter_info("Can't set the FTDI channel to any channel (%d)",
 				retCode);
 		return COMMON_TYPE_ERR;
 	}
 
+	if (dlogg_mac_openCachedUSBDevice(context, ttyID)) {
+		return COMMON_TYPE_SUCCESS;
+	}
+
 	// Query devices
-	retCode = ftdi_usb_find_all(dlogg_mac_ftdi, &devList, 0, 0);
+	retCode = ftdi_usb_find_all(backend->ftdi, &devList, 0, 0);
 	if (retCode < 0) {
 		logging_adapter_info("Can't query USB adapters (%d)", retCode);
 		return COMMON_TYPE_ERR_IO;
@@ -171,148 +276,297 @@ static inline common_type_error_t dlogg_mac_openUSBDevice(int ttyID) {
 	}
 
 	// Open device
-	retCode = ftdi_usb_open_dev(dlogg_mac_ftdi, tmpDevEntry->dev);
+	usbDevice.index = ttyID;
+	usbDevice.bus = libusb_get_bus_number(tmpDevEntry->dev);
+	usbDevice.address = libusb_get_device_address(tmpDevEntry->dev);
+	retCode = ftdi_usb_open_dev(backend->ftdi, tmpDevEntry->dev);
 	ftdi_list_free(&devList);
 	if (retCode) {
 		logging_adapter_info("Can't open USB device %d (%d)", ttyID + 1, retCode);
 		return COMMON_TYPE_ERR_IO;
 	}
 
-	dlogg_mac_cData.devOpened = 1;
+	backend->devOpened = 1;
+	dlogg_sc_setUSBDevice(&context->stateCache, &usbDevice);
 
 	return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Tries to open the USB device used by the previous invocation
+ * @details The cached device is only used if it has the configured device
+ * number or if no number is configured. Any failure is silently ignored since
+ * the caller falls back to listing the devices.
+ * @param context The valid MAC instance
+ * @param ttyID The configured device id or -1 if it is unset
+ * @return 1 if the device was opened, 0 otherwise
+ */
+static inline int dlogg_mac_openCachedUSBDevice(dlogg_mac_context_t *context,
+		int ttyID) {
+	struct dlogg_mac_backend *backend = context->backend;
+	dlogg_sc_usbDevice_t usbDevice;
+	int retCode;
+
+	assert(backend->ftdi != NULL);
+
+	if (!dlogg_sc_getUSBDevice(&context->stateCache, &usbDevice)
+			|| (ttyID >= 0 && ttyID != usbDevice.index)) {
+		return 0;
+	}
+
+	retCode = ftdi_usb_open_bus_addr(backend->ftdi, usbDevice.bus,
+			usbDevice.address);
+	if (retCode) {
+		logging_adapter_debug("Can't open the cached USB device %u:%u (%d), list "
+				"the devices", (unsigned) usbDevice.bus, (unsigned) usbDevice.address,
+				retCode);
+		return 0;
+	}
+
+	logging_adapter_debug("Opened the cached USB device %u:%u",
+			(unsigned) usbDevice.bus, (unsigned) usbDevice.address);
+	backend->devOpened = 1;
+	return 1;
+}
+
 /**
  * @brief Sets the UART's transmission parameters
  * @details Assumes that the USB UART device was properly initialized and opened
  * before.
+ * @param ftdi The instance's valid ftdi context
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_mac_setUARTParams() {
+static inline common_type_error_t dlogg_mac_setUARTParams(
+		struct ftdi_context *ftdi) {
 	int retCode;
 
-	assert(dlogg_mac_ftdi != NULL);
+	assert(ftdi != NULL);
 
-	retCode = ftdi_set_line_property(dlogg_mac_ftdi, BITS_8, STOP_BIT_1, NONE);
+	retCode = ftdi_set_line_property(ftdi, BITS_8, STOP_BIT_1, NONE);
 	if (retCode) {
 		logging_adapter_info("Can't set the line properties (%d)", retCode);
 		return COMMON_TYPE_ERR_IO;
 	}
 
-	retCode = ftdi_set_baudrate(dlogg_mac_ftdi, DLOGG_MAC_BAUDRATE);
+	retCode = ftdi_set_baudrate(ftdi, DLOGG_MAC_BAUDRATE);
 	if (retCode) {
 		logging_adapter_info("Can't set the baud-rate (%d)", retCode);
 		return COMMON_TYPE_ERR_IO;
 	}
 
-	retCode = ftdi_setdtr(dlogg_mac_ftdi, 1);
+	retCode = ftdi_setdtr(ftdi, 1);
 	if (retCode) {
 		logging_adapter_info("Can't set the DTR line (%d)", retCode);
 		return COMMON_TYPE_ERR_IO;
 	}
 
-	retCode = ftdi_setrts(dlogg_mac_ftdi, 0);
+	retCode = ftdi_setrts(ftdi, 0);
 	if (retCode) {
 		logging_adapter_info("Can't clear the RTS line (%d)", retCode);
 		return COMMON_TYPE_ERR_IO;
 	}
 
+	retCode = ftdi_set_latency_timer(ftdi, DLOGG_MAC_LATENCY_TIMER);
+	if (retCode) {
+		logging_adapter_info("Can't set the latency timer (%d)", retCode);
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	retCode = ftdi_read_data_set_chunksize(ftdi,
+			DLOGG_MAC_READ_CHUNK_SIZE);
+	if (retCode) {
+		logging_adapter_info("Can't set the read chunk size (%d)", retCode);
+		return COMMON_TYPE_ERR_IO;
+	}
+
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t dlogg_mac_send(uint8_t *buffer, size_t length,
-		dlogg_mac_chksum_t * chksum) {
-	int retCode;
+common_type_error_t dlogg_mac_selectLine(dlogg_mac_context_t *context,
+		uint8_t lineID) {
+	if (lineID != 0) {
+		logging_adapter_info("The line %u isn't served, the FTDI MAC serves line 0 "
+				"only", (unsigned) lineID);
+		return COMMON_TYPE_ERR_INVALID_ADDRESS;
+	}
+	return COMMON_TYPE_SUCCESS;
+}
 
+common_type_error_t dlogg_mac_send(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
+	struct ftdi_transfer_control *transferCtrl;
+	common_type_error_t err;
+
+	assert(context != NULL);
 	assert(buffer != NULL);
-	assert(dlogg_mac_ftdi != NULL);
+	assert(context->backend->ftdi != NULL);
 
-	retCode = ftdi_write_data(dlogg_mac_ftdi, buffer, length);
-	if (retCode != length) {
-		logging_adapter_info("Cant't write to the USB device (%d)", retCode);
+	transferCtrl = ftdi_write_data_submit(context->backend->ftdi, buffer,
+			length);
+	if (transferCtrl == NULL) {
+		logging_adapter_info("Error during submitting write request");
+		context->statistics.ioErrors++;
 		return COMMON_TYPE_ERR_IO;
 	}
 
+	err = dlogg_mac_awaitTransfer(context, transferCtrl, length);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_SEND, buffer, length);
 	dlogg_mac_updateChksum(buffer, length, chksum);
 
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t dlogg_mac_read(uint8_t *buffer, size_t length,
-		dlogg_mac_chksum_t * chksum) {
+common_type_error_t dlogg_mac_read(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
 	struct ftdi_transfer_control *transferCtrl;
-	struct timespec tv;
-	int retCode;
-	int retryCnt = DLOGG_MAC_RETRY;
+	common_type_error_t err;
 
+	assert(context != NULL);
 	assert(buffer != NULL);
-	assert(dlogg_mac_ftdi != NULL);
+	assert(context->backend->ftdi != NULL);
 
-	transferCtrl = ftdi_read_data_submit(dlogg_mac_ftdi, buffer, length);
-	if(transferCtrl == NULL){
+	transferCtrl = ftdi_read_data_submit(context->backend->ftdi, buffer, length);
+	if (transferCtrl == NULL) {
 		logging_adapter_info("Error during submitting read request");
+		context->statistics.ioErrors++;
 		return COMMON_TYPE_ERR_IO;
 	}
 
-	// workaround for the missing read-timeout
-	tv.tv_nsec = ((long)length) * 1000000000L / DLOGG_MAC_BAUDRATE;
-	tv.tv_sec = tv.tv_nsec / 999999999;
-	tv.tv_nsec = tv.tv_nsec % 999999999;
+	err = dlogg_mac_awaitTransfer(context, transferCtrl, length);
+	if (err != COMMON_TYPE_SUCCESS) {
+		return err;
+	}
+
+	dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer, length);
+	dlogg_mac_updateChksum(buffer, length, chksum);
 
-	do{
-		retryCnt --;
+	return COMMON_TYPE_SUCCESS;
+}
 
-		retCode = nanosleep(&tv,NULL);
-		if(retCode){
-			logging_adapter_info("Caught interrupt while reading data");
-			return COMMON_TYPE_ERR;
-		}
+/**
+ * @details The FTDI MAC serves a single line only, so the whole length is
+ * awaited.
+ */
+common_type_error_t dlogg_mac_receive(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, size_t *received,
+		dlogg_mac_chksum_t * chksum) {
+	common_type_error_t err;
 
-		// set timeout near device response time (just a guess)
-		tv.tv_sec = 0;
-		tv.tv_nsec = 100000;
+	assert(received != NULL);
 
-		retCode = ftdi_transfer_data_done(transferCtrl);
-		if(retCode < 0){
-			logging_adapter_info("Can't read from the USB device (%d)", retCode);
-			return COMMON_TYPE_ERR_IO;
+	*received = 0;
+	err = dlogg_mac_read(context, buffer, length, chksum);
+	if (err == COMMON_TYPE_SUCCESS) {
+		*received = length;
+	}
+	return err;
+}
+
+/**
+ * @details Receiving doesn't depend on waiting before, so the lines are
+ * always reported to be ready.
+ */
+common_type_error_t dlogg_mac_awaitLines(dlogg_mac_context_t *context,
+		unsigned int *lines) {
+	assert(lines != NULL);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Handles libusb's events until the given transfer completes
+ * @details If the transaction's deadline passes before, the transfer is
+ * cancelled. In any case, the transfer control structure is freed and mustn't
+ * be used anymore.
+ * @param context The valid MAC instance
+ * @param transferCtrl The valid, submitted transfer
+ * @param length The number of bytes to transfer
+ * @return The status of the operation
+ */
+static common_type_error_t dlogg_mac_awaitTransfer(
+		dlogg_mac_context_t *context, struct ftdi_transfer_control *transferCtrl,
+		size_t length) {
+	struct timeval tv;
+	long remaining;
+	int retCode;
+
+	assert(transferCtrl != NULL);
+
+	while (!dlogg_mac_ftdiIsCompleted(transferCtrl)) {
+		remaining = dlogg_mac_remainingTime(context);
+		if (remaining <= 0) {
+			tv.tv_sec = 0;
+			tv.tv_usec = DLOGG_MAC_CANCEL_TIMEOUT;
+			ftdi_transfer_data_cancel(transferCtrl, &tv);
+			logging_adapter_info("Timeout while accessing the USB device");
+			context->statistics.timeouts++;
+			return COMMON_TYPE_ERR_TIMEOUT;
 		}
-	}while(retCode < length && retryCnt >= 0);
 
-	if(retCode < length){
-		logging_adapter_info("Can't read all data (only %d of %d)",retCode, length);
-		return COMMON_TYPE_ERR_TIMEOUT;
+		tv.tv_sec = remaining / 1000000L;
+		tv.tv_usec = remaining % 1000000L;
+		retCode = dlogg_mac_ftdiHandleEvents(context->backend->ftdi, transferCtrl,
+				&tv);
+		if (retCode < 0 && retCode != LIBUSB_ERROR_INTERRUPTED) {
+			tv.tv_sec = 0;
+			tv.tv_usec = DLOGG_MAC_CANCEL_TIMEOUT;
+			ftdi_transfer_data_cancel(transferCtrl, &tv);
+			logging_adapter_info("Can't handle USB events (%d)", retCode);
+			context->statistics.ioErrors++;
+			return COMMON_TYPE_ERR_IO;
+		}
 	}
 
-	logging_adapter_debug("DLOGG-MAC: %d/%d retries left", (retryCnt + 1),
-			DLOGG_MAC_RETRY);
-
-	dlogg_mac_updateChksum(buffer, length, chksum);
+	// The transfer is complete, so the call doesn't block anymore
+	retCode = ftdi_transfer_data_done(transferCtrl);
+	if (retCode < 0 || (size_t) retCode != length) {
+		logging_adapter_info("Can't transfer all data (only %d of %u)", retCode,
+				(unsigned) length);
+		context->statistics.ioErrors++;
+		return COMMON_TYPE_ERR_IO;
+	}
 
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t fieldbus_mac_free() {
+common_type_error_t fieldbus_mac_freeContext(fieldbus_mac_context_t context) {
 	int retCode;
 	common_type_error_t err = COMMON_TYPE_SUCCESS;
+	dlogg_mac_context_t *mac = context;
+	struct dlogg_mac_backend *backend;
+
+	assert(mac != NULL);
 
-	if (dlogg_mac_ftdi != NULL ) {
+	backend = mac->backend;
+	if (backend != NULL && backend->ftdi != NULL ) {
 
 		// close opened device
-		if (dlogg_mac_cData.devOpened) {
-			retCode = ftdi_usb_close(dlogg_mac_ftdi);
+		if (backend->devOpened) {
+			retCode = ftdi_usb_close(backend->ftdi);
 			if (retCode) {
 				logging_adapter_info("Can't successfully close the USB device (%d)",
 						retCode);
 				err = COMMON_TYPE_ERR_IO;
 			}
-			dlogg_mac_cData.devOpened = 0;
+			backend->devOpened = 0;
 		}
 
-		ftdi_free(dlogg_mac_ftdi);
-		dlogg_mac_ftdi = NULL;
+		ftdi_free(backend->ftdi);
+	}
+	free(backend);
+	dlogg_mac_logStatistics(mac);
+
+	dlogg_cd_free(mac);
+	if (dlogg_sc_free(&mac->stateCache) != COMMON_TYPE_SUCCESS) {
+		err = COMMON_TYPE_ERR_IO;
+	}
+	if (dlogg_cap_free(&mac->capture) != COMMON_TYPE_SUCCESS) {
+		err = COMMON_TYPE_ERR_IO;
 	}
+	free(mac);
 
 	return err;
 }
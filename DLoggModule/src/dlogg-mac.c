@@ -6,6 +6,17 @@
  * hardware connections are out-sourced to dlogg-mac-common.c. Placing these
  * functions in a different file enhances re-usability of the code, if another
  * hardware access API is used.
+ * Received bytes are buffered within a ring buffer. Every read system call
+ * fetches as many bytes as available, so consecutive dlogg_mac_read calls of
+ * a single response are usually served from memory.
+ * The device is accessed in non-blocking mode. Each transaction, started by
+ * sending a request, has an absolute deadline. Waiting for the response is
+ * done using poll() until the deadline passes, so a stalled adapter can't
+ * block a sample for longer than the configured timeout.
+ * The interface directive may list several devices. Each device serves one
+ * line, numbered by its position in the list. Every line has its own receive
+ * buffer. Responses of several lines are received concurrently by polling
+ * every pending line at once and taking the bytes at hand.
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -31,87 +42,271 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <termios.h>
+#include <sys/uio.h>
 #include "dlogg-mac.h"
 #include "dlogg-mac-common.h"
+#include "dlogg-capture.h"
+#include "dlogg-current-data.h"
+#include "dlogg-state-cache.h"
 
 /* Configuration directives */
 #define DLOGG_MAC_CONFIG_INTERFACE "interface"
 
-/** @brief The timeout value in tenth of seconds */
-#define DLOGG_MAC_TIMEOUT (20)
+/** @brief The size of the receive buffer, has to be a power of two */
+#define DLOGG_MAC_RX_BUFFER_SIZE (256)
 
-/** @brief The file handler used to access the tty */
-static int dlogg_mac_ttyFD = -1;
-
-/** @brief The old terminal device settings */
-static struct termios dlogg_mac_oldTio;
-
-/** @brief Structure containing encapsulated data */
-static struct {
+/** @brief Structure encapsulating the state of a single line */
+typedef struct {
+	/** @brief The file handler used to access the tty */
+	int ttyFD;
 	/**
 	 * @brief Flag indicating that the oldTio structure was successfully obtained.
 	 */
 	unsigned int restoreTioSettings :1;
-} dlogg_mac_cData;
+	/**
+	 * @brief Flag indicating that poll reported the tty ready since the last
+	 * read
+	 * @details Since VMIN and VTIME are zero, reading no byte is only an end of
+	 * file, e.g. a hang-up, if the tty was reported ready.
+	 */
+	unsigned int pollReady :1;
+	/** @brief Flag indicating that poll reported a hang-up or an error */
+	unsigned int pollFailed :1;
+	/**
+	 * @brief The receive ring buffer
+	 * @details The head and tail counters are free running and only masked while
+	 * accessing the data. Hence, the buffer is empty iff head equals tail.
+	 */
+	struct {
+		/** @brief The buffered bytes */
+		uint8_t data[DLOGG_MAC_RX_BUFFER_SIZE];
+		/** @brief The number of bytes consumed so far */
+		unsigned int head;
+		/** @brief The number of bytes received so far */
+		unsigned int tail;
+	} rxBuffer;
+} dlogg_mac_line_t;
+
+/** @brief The termios specific state of a MAC instance */
+struct dlogg_mac_backend {
+	/** @brief The state of every line */
+	dlogg_mac_line_t lines[DLOGG_CD_MAX_LINES];
+	/**
+	 * @brief The old terminal device settings of every line
+	 * @details The settings are allocated outside the packed structure to access
+	 * them properly aligned.
+	 */
+	struct termios *oldTio;
+	/** @brief The number of lines opened */
+	uint8_t lineCount;
+	/** @brief The selected line */
+	dlogg_mac_line_t *line;
+};
 
 /* Function Prototypes */
-static inline common_type_error_t dlogg_mac_initTTY(const char* interface);
-
-common_type_error_t fieldbus_mac_init(config_setting_t* configuration) {
-	const char* interface;
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		config_setting_t* interfaces);
+static inline common_type_error_t dlogg_mac_initLines(
+		struct dlogg_mac_backend *backend, config_setting_t* interfaces);
+static inline common_type_error_t dlogg_mac_initTTY(
+		struct dlogg_mac_backend *backend, uint8_t lineID,
+		const char* interface);
+static inline ssize_t dlogg_mac_fillRxBuffer(dlogg_mac_context_t *context);
+static ssize_t dlogg_mac_readRxBuffer(dlogg_mac_line_t *line);
+static inline size_t dlogg_mac_takeRxBuffer(dlogg_mac_line_t *line,
+		uint8_t *buffer, size_t length);
+static int dlogg_mac_waitDeadline(dlogg_mac_context_t *context, short events);
+
+common_type_error_t fieldbus_mac_initContext(config_setting_t* configuration,
+		fieldbus_mac_context_t *context) {
+	config_setting_t* interfaces;
+	dlogg_mac_context_t *mac;
+	common_type_error_t err;
 
 	assert(configuration != NULL);
+	assert(context != NULL);
 
 	if (!config_setting_is_group(configuration)) {
 		logging_adapter_info("The MAC configuration isn't a group");
 		return COMMON_TYPE_ERR_CONFIG;
 	}
 
-	if (!config_setting_lookup_string(configuration, DLOGG_MAC_CONFIG_INTERFACE,
-			&interface)) {
-		logging_adapter_info("Can't find the \"%s\" string configuration directive "
+	interfaces = config_setting_get_member(configuration,
+			DLOGG_MAC_CONFIG_INTERFACE);
+	if (interfaces == NULL) {
+		logging_adapter_info("Can't find the \"%s\" configuration directive "
 				"inside MAC group", DLOGG_MAC_CONFIG_INTERFACE);
 		return COMMON_TYPE_ERR_CONFIG;
 	}
 
-	return dlogg_mac_initTTY(interface);
+	mac = dlogg_mac_newContext();
+	if (mac == NULL)
+		return COMMON_TYPE_ERR;
+
+	err = dlogg_mac_initInstance(mac, configuration, interfaces);
+	if (err != COMMON_TYPE_SUCCESS) {
+		(void) fieldbus_mac_freeContext(mac);
+		return err;
+	}
+
+	*context = mac;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Initializes the freshly allocated MAC instance
+ * @details The instance has to be freed by the caller if the function fails.
+ * @param context The valid MAC instance
+ * @param configuration The valid MAC configuration group
+ * @param interfaces The valid interface setting
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		config_setting_t* interfaces) {
+	common_type_error_t err;
+
+	assert(context != NULL);
+	assert(context->backend == NULL);
+
+	context->backend = calloc(1, sizeof(*context->backend));
+	if (context->backend == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+	context->backend->line = &context->backend->lines[0];
+	context->backend->oldTio = calloc(DLOGG_CD_MAX_LINES,
+			sizeof(context->backend->oldTio[0]));
+	if (context->backend->oldTio == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	err = dlogg_mac_initTimeout(context, configuration);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	err = dlogg_sc_init(&context->stateCache, configuration);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	err = dlogg_cap_init(&context->capture, configuration);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	err = dlogg_mac_initLines(context->backend, interfaces);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	return dlogg_cd_init(context, configuration, context->backend->lineCount);
+}
+
+/**
+ * @brief Opens every interface listed
+ * @details The interface setting is either a single string or a list of
+ * strings. The position within the list determines the line id.
+ * @param backend The instance's valid termios state
+ * @param interfaces The valid interface setting
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_mac_initLines(
+		struct dlogg_mac_backend *backend, config_setting_t* interfaces) {
+	const char* interface;
+	common_type_error_t err;
+	int count, i, isList;
+
+	assert(backend != NULL);
+	assert(interfaces != NULL);
+	assert(backend->lineCount == 0);
+
+	isList = config_setting_is_list(interfaces)
+			|| config_setting_is_array(interfaces);
+	if (isList) {
+		count = config_setting_length(interfaces);
+	} else if (config_setting_get_string(interfaces) != NULL) {
+		count = 1;
+	} else {
+		count = 0;
+	}
+
+	if (count < 1 || count > DLOGG_CD_MAX_LINES) {
+		logging_adapter_info("The \"%s\" directive has to be a string or a list of "
+				"up to %u strings", DLOGG_MAC_CONFIG_INTERFACE,
+				(unsigned) DLOGG_CD_MAX_LINES);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (isList) {
+			interface = config_setting_get_string(
+					config_setting_get_elem(interfaces, i));
+		} else {
+			interface = config_setting_get_string(interfaces);
+		}
+		if (interface == NULL) {
+			logging_adapter_info("The %u. element of the \"%s\" directive isn't a "
+					"string", (unsigned) i + 1, DLOGG_MAC_CONFIG_INTERFACE);
+			return COMMON_TYPE_ERR_CONFIG;
+		}
+
+		// Count the line before opening it, so it is freed in any case
+		backend->lines[i].ttyFD = -1;
+		backend->lineCount++;
+
+		err = dlogg_mac_initTTY(backend, i, interface);
+		if (err != COMMON_TYPE_SUCCESS)
+			return err;
+	}
+
+	backend->line = &backend->lines[0];
+	return COMMON_TYPE_SUCCESS;
 }
 
 /**
- * @brief initializes the tty interface
- * @details It assumes that the global file descriptor is currently closed (-1)
+ * @brief initializes the tty interface of a line
+ * @details It assumes that the line's file descriptor is currently closed (-1)
  * and that the given interface string is valid. After successfully opening the
- * device the termois settings will be saved globally.
+ * device the termois settings will be saved.
+ * @param backend The instance's valid termios state
+ * @param lineID The line served by the interface
  * @param interface The interface path to open
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_mac_initTTY(const char* interface) {
+static inline common_type_error_t dlogg_mac_initTTY(
+		struct dlogg_mac_backend *backend, uint8_t lineID,
+		const char* interface) {
 	struct termios ttySettings, controlSettings;
-	assert(dlogg_mac_ttyFD < 0);
+	dlogg_mac_line_t *line = &backend->lines[lineID];
+
+	assert(lineID < DLOGG_CD_MAX_LINES);
+	assert(line->ttyFD < 0);
 	assert(interface != NULL);
-	assert(!dlogg_mac_cData.restoreTioSettings);
+	assert(!line->restoreTioSettings);
 
 	errno = 0;
-	dlogg_mac_ttyFD = open(interface, O_RDWR | O_NOCTTY);
-	if (dlogg_mac_ttyFD < 0) {
+	line->ttyFD = open(interface, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (line->ttyFD < 0) {
 		logging_adapter_info("Can't open the device \"%s\": %s", interface,
 				strerror(errno));
 		return COMMON_TYPE_ERR_DEVICE_NOT_FOUND;
 	}
 
-	logging_adapter_debug("Successfully opened d-logg device \"%s\"", interface);
+	logging_adapter_debug("Successfully opened d-logg device \"%s\" at line %u",
+			interface, (unsigned) lineID);
 
 	// save old state
-	if (tcgetattr(dlogg_mac_ttyFD, &dlogg_mac_oldTio)) {
+	if (tcgetattr(line->ttyFD, &backend->oldTio[lineID])) {
 		logging_adapter_info("Can't obtain the \"%s\" devices settings: %s",
 				interface, strerror(errno));
 		return COMMON_TYPE_ERR_IO;
 	}
-	dlogg_mac_cData.restoreTioSettings = 1;
+	line->restoreTioSettings = 1;
 
 	// Assemble new settings
 	memset(&ttySettings, 0, sizeof(ttySettings));
@@ -124,16 +319,17 @@ static inline common_type_error_t dlogg_mac_initTTY(const char* interface) {
 	}
 
 	// Use non canonical mode, 8 bits, no parity, 1 stop bit, DTR: on, RTS: off
+	// Timeouts are handled by poll()
 	ttySettings.c_cc[VMIN] = 0;
-	ttySettings.c_cc[VTIME] = DLOGG_MAC_TIMEOUT;
+	ttySettings.c_cc[VTIME] = 0;
 	ttySettings.c_cflag |= CS8 | CREAD | CLOCAL;
 
-	if (tcsetattr(dlogg_mac_ttyFD, TCSAFLUSH, &ttySettings)) {
+	if (tcsetattr(line->ttyFD, TCSAFLUSH, &ttySettings)) {
 		logging_adapter_info("Can't change the \"%s\" device's settings: %s",
 				interface, strerror(errno));
 		return COMMON_TYPE_ERR_IO;
 	}
-	if (tcgetattr(dlogg_mac_ttyFD, &controlSettings)) {
+	if (tcgetattr(line->ttyFD, &controlSettings)) {
 		logging_adapter_info("Can't obtain the \"%s\" devices settings: %s",
 				interface, strerror(errno));
 		return COMMON_TYPE_ERR_IO;
@@ -150,69 +346,398 @@ static inline common_type_error_t dlogg_mac_initTTY(const char* interface) {
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t dlogg_mac_send(uint8_t *buffer, size_t length,
-		dlogg_mac_chksum_t * chksum) {
+common_type_error_t dlogg_mac_selectLine(dlogg_mac_context_t *context,
+		uint8_t lineID) {
+	struct dlogg_mac_backend *backend;
+
+	assert(context != NULL);
+	backend = context->backend;
 
+	if (lineID >= backend->lineCount) {
+		logging_adapter_info("The line %u isn't served, %u line(s) configured",
+				(unsigned) lineID, (unsigned) backend->lineCount);
+		return COMMON_TYPE_ERR_INVALID_ADDRESS;
+	}
+
+	backend->line = &backend->lines[lineID];
+	dlogg_cap_selectLine(&context->capture, lineID);
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t dlogg_mac_send(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
+	dlogg_mac_line_t *line;
+	size_t remaining = length;
+	ssize_t wr;
+	int ready;
+
+	assert(context != NULL);
 	assert(buffer != NULL);
 
-	if (write(dlogg_mac_ttyFD, buffer, length) != length) {
-		logging_adapter_info("Can't write to the d-logg interface: %s",
+	line = context->backend->line;
+
+	// Bytes still buffered belong to a previous, failed exchange
+	if (line->rxBuffer.head != line->rxBuffer.tail) {
+		logging_adapter_debug("Discard %u stale bytes",
+				line->rxBuffer.tail - line->rxBuffer.head);
+		line->rxBuffer.head = line->rxBuffer.tail;
+	}
+	if (tcflush(line->ttyFD, TCIFLUSH) != 0) {
+		logging_adapter_debug("Can't discard the stale input: %s",
 				strerror(errno));
-		return COMMON_TYPE_ERR_IO;
+	}
+	line->pollReady = 0;
+	line->pollFailed = 0;
+
+	while (remaining > 0) {
+		wr = write(line->ttyFD, &buffer[length - remaining], remaining);
+		if (wr > 0) {
+			remaining -= wr;
+			continue;
+		}
+
+		if (wr < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			logging_adapter_info("Can't write to the d-logg interface: %s",
+					strerror(errno));
+			context->statistics.ioErrors++;
+			return COMMON_TYPE_ERR_IO;
+		}
+
+		ready = dlogg_mac_waitDeadline(context, POLLOUT);
+		if (ready == 0) {
+			logging_adapter_info("Timeout while writing to d-logg. %u more bytes "
+					"to send.", (unsigned) remaining);
+			context->statistics.timeouts++;
+			return COMMON_TYPE_ERR_TIMEOUT;
+		} else if (ready < 0) {
+			logging_adapter_info("Can't wait for the d-logg interface: %s",
+					strerror(errno));
+			context->statistics.ioErrors++;
+			return COMMON_TYPE_ERR_IO;
+		}
 	}
 
+	dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_SEND, buffer, length);
 	dlogg_mac_updateChksum(buffer, length, chksum);
 
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t dlogg_mac_read(uint8_t *buffer, size_t length,
-		dlogg_mac_chksum_t * chksum) {
-	size_t remaining = length;
+common_type_error_t dlogg_mac_read(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
+	size_t remaining = length, taken;
 	ssize_t rd;
 
+	assert(context != NULL);
 	assert(buffer != NULL);
 
 	while (remaining > 0) {
-		rd = read(dlogg_mac_ttyFD, &buffer[length - remaining], remaining);
+		taken = dlogg_mac_takeRxBuffer(context->backend->line,
+				&buffer[length - remaining], remaining);
+		dlogg_mac_updateChksum(&buffer[length - remaining], taken, chksum);
+		remaining -= taken;
+		if (remaining == 0)
+			break;
+
+		rd = dlogg_mac_fillRxBuffer(context);
 		if (rd == 0) {
 			logging_adapter_info("Timeout while reading from d-logg. %u more bytes "
 					"expected, got %u so far.", (unsigned) remaining,
 					(unsigned) length - remaining);
+			context->statistics.timeouts++;
+			dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer,
+					length - remaining);
 			return COMMON_TYPE_ERR_TIMEOUT;
 		} else if (rd < 0) {
 			logging_adapter_info("Can't read %u more bytes of data from d-logg: %s",
 					(unsigned) remaining, strerror(errno));
+			context->statistics.ioErrors++;
+			dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer,
+					length - remaining);
 			return COMMON_TYPE_ERR_IO;
 		}
-		remaining -= rd;
 	}
 
-	dlogg_mac_updateChksum(buffer, length, chksum);
+	dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer, length);
+	return COMMON_TYPE_SUCCESS;
+}
 
+common_type_error_t dlogg_mac_receive(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, size_t *received,
+		dlogg_mac_chksum_t * chksum) {
+	dlogg_mac_line_t *line;
+	size_t taken;
+
+	assert(context != NULL);
+	assert(buffer != NULL);
+	assert(received != NULL);
+
+	line = context->backend->line;
+	taken = dlogg_mac_takeRxBuffer(line, buffer, length);
+	if (taken < length) {
+		if (dlogg_mac_readRxBuffer(line) < 0) {
+			logging_adapter_info("Can't read %u more bytes of data from d-logg: %s",
+					(unsigned) (length - taken), strerror(errno));
+			context->statistics.ioErrors++;
+			dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer,
+					taken);
+			return COMMON_TYPE_ERR_IO;
+		}
+		taken += dlogg_mac_takeRxBuffer(line, &buffer[taken], length - taken);
+	}
+
+	if (taken > 0) {
+		dlogg_cap_record(&context->capture, DLOGG_CAP_DIR_RECEIVE, buffer, taken);
+		dlogg_mac_updateChksum(buffer, taken, chksum);
+	}
+	*received = taken;
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t fieldbus_mac_free() {
-	common_type_error_t err = COMMON_TYPE_SUCCESS;
+common_type_error_t dlogg_mac_awaitLines(dlogg_mac_context_t *context,
+		unsigned int *lines) {
+	struct dlogg_mac_backend *backend;
+	struct pollfd pfd[DLOGG_CD_MAX_LINES];
+	uint8_t lineIDs[DLOGG_CD_MAX_LINES];
+	unsigned int ready = 0, count = 0, i;
+	long remaining;
+	int ret;
+
+	assert(context != NULL);
+	assert(lines != NULL);
+	backend = context->backend;
+
+	for (i = 0; i < backend->lineCount; i++) {
+		if (!(*lines & (1u << i)))
+			continue;
+
+		// Bytes still buffered don't need to be waited for
+		if (backend->lines[i].rxBuffer.head != backend->lines[i].rxBuffer.tail) {
+			ready |= 1u << i;
+		}
+		pfd[count].fd = backend->lines[i].ttyFD;
+		pfd[count].events = POLLIN;
+		lineIDs[count++] = i;
+	}
+
+	while (ready == 0 && count > 0) {
+		remaining = dlogg_mac_remainingTime(context);
+		if (remaining <= 0) {
+			logging_adapter_info("Timeout while reading from %u d-logg line(s)",
+					count);
+			context->statistics.timeouts += count;
+			return COMMON_TYPE_ERR_TIMEOUT;
+		}
+
+		for (i = 0; i < count; i++) {
+			pfd[i].revents = 0;
+		}
+		ret = poll(pfd, count, (int) ((remaining + 999L) / 1000L));
+		if (ret < 0 && errno != EINTR) {
+			logging_adapter_info("Can't wait for the d-logg interfaces: %s",
+					strerror(errno));
+			context->statistics.ioErrors++;
+			return COMMON_TYPE_ERR_IO;
+		}
+
+		for (i = 0; ret > 0 && i < count; i++) {
+			// Hang-ups and errors are reported by reading the line
+			if (pfd[i].revents != 0) {
+				backend->lines[lineIDs[i]].pollReady = 1;
+				ready |= 1u << lineIDs[i];
+			}
+			if (pfd[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+				backend->lines[lineIDs[i]].pollFailed = 1;
+			}
+		}
+	}
+
+	*lines = ready;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Reads as many bytes as available into the selected line's receive
+ * buffer
+ * @details If no byte is available, the function waits until at least one
+ * byte arrives or the transaction's deadline passes.
+ * @param context The valid MAC instance
+ * @return The number of bytes read, 0 on timeout or -1 on error
+ */
+static inline ssize_t dlogg_mac_fillRxBuffer(dlogg_mac_context_t *context) {
+	ssize_t rd;
+	int ready;
+
+	for (;;) {
+		rd = dlogg_mac_readRxBuffer(context->backend->line);
+		if (rd != 0) {
+			return rd;
+		}
+
+		ready = dlogg_mac_waitDeadline(context, POLLIN);
+		if (ready <= 0) {
+			return ready;
+		}
+	}
+}
 
-	// Deallocate TTY
-	if (dlogg_mac_ttyFD >= 0) {
-		if (dlogg_mac_cData.restoreTioSettings) {
-			if (tcsetattr(dlogg_mac_ttyFD, TCSADRAIN, &dlogg_mac_oldTio)) {
+/**
+ * @brief Reads the bytes available into the line's receive buffer
+ * @details A single read system call fetches every byte available without
+ * waiting. The free space may wrap around the end of the buffer, so both parts
+ * are passed at once. If the line was reported ready but no byte is read, the
+ * tty hung up or failed and EIO is returned. Bytes received before a hang-up
+ * are still read.
+ * @param line The valid line to read
+ * @return The number of bytes read, 0 if no byte is available or -1 on error
+ */
+static ssize_t dlogg_mac_readRxBuffer(dlogg_mac_line_t *line) {
+	struct iovec vector[2];
+	unsigned int tailIndex, freeSpace;
+	ssize_t rd;
+
+	tailIndex = line->rxBuffer.tail & (DLOGG_MAC_RX_BUFFER_SIZE - 1);
+	freeSpace = DLOGG_MAC_RX_BUFFER_SIZE
+			- (line->rxBuffer.tail - line->rxBuffer.head);
+	if (freeSpace == 0) {
+		return 0;
+	}
+
+	vector[0].iov_base = &line->rxBuffer.data[tailIndex];
+	vector[0].iov_len = DLOGG_MAC_RX_BUFFER_SIZE - tailIndex;
+	if (vector[0].iov_len > freeSpace)
+		vector[0].iov_len = freeSpace;
+	vector[1].iov_base = &line->rxBuffer.data[0];
+	vector[1].iov_len = freeSpace - vector[0].iov_len;
+
+	rd = readv(line->ttyFD, vector, vector[1].iov_len > 0 ? 2 : 1);
+	if (rd > 0) {
+		line->pollReady = 0;
+		line->rxBuffer.tail += rd;
+		return rd;
+	} else if (rd < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		return -1;
+	} else if ((rd == 0 && line->pollReady) || line->pollFailed) {
+		line->pollReady = 0;
+		errno = EIO;
+		return -1;
+	}
+	line->pollReady = 0;
+	return 0;
+}
+
+/**
+ * @brief Waits until the selected line's tty is ready or the transaction's deadline passes
+ * @details Interrupted waits are resumed, the deadline remains unchanged.
+ * @param context The valid MAC instance
+ * @param events The poll events to wait for
+ * @return 1 if the tty is ready, 0 on timeout and -1 on error
+ */
+static int dlogg_mac_waitDeadline(dlogg_mac_context_t *context, short events) {
+	struct pollfd pfd;
+	long remaining;
+	int ret;
+
+	pfd.fd = context->backend->line->ttyFD;
+	pfd.events = events;
+
+	for (;;) {
+		remaining = dlogg_mac_remainingTime(context);
+		if (remaining <= 0) {
+			return 0;
+		}
+
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, (int) ((remaining + 999L) / 1000L));
+		if (ret > 0) {
+			if (pfd.revents & (POLLERR | POLLNVAL)) {
+				errno = EIO;
+				return -1;
+			}
+			if (events & POLLIN) {
+				context->backend->line->pollReady = 1;
+			}
+			if (pfd.revents & POLLHUP) {
+				context->backend->line->pollFailed = 1;
+			}
+			return 1;
+		} else if (ret < 0 && errno != EINTR) {
+			return -1;
+		}
+	}
+}
+
+/**
+ * @brief Copies buffered bytes to the given buffer
+ * @param line The valid line to take the bytes of
+ * @param buffer The destination holding at least length bytes
+ * @param length The maximum number of bytes to copy
+ * @return The number of bytes copied, which may be zero
+ */
+static inline size_t dlogg_mac_takeRxBuffer(dlogg_mac_line_t *line,
+		uint8_t *buffer, size_t length) {
+	unsigned int headIndex, available, first;
+
+	assert(buffer != NULL);
+
+	available = line->rxBuffer.tail - line->rxBuffer.head;
+	if (length > available)
+		length = available;
+
+	headIndex = line->rxBuffer.head & (DLOGG_MAC_RX_BUFFER_SIZE - 1);
+	first = DLOGG_MAC_RX_BUFFER_SIZE - headIndex;
+	if (first > length)
+		first = length;
+
+	memcpy(buffer, &line->rxBuffer.data[headIndex], first);
+	memcpy(&buffer[first], &line->rxBuffer.data[0], length - first);
+	line->rxBuffer.head += length;
+
+	return length;
+}
+
+common_type_error_t fieldbus_mac_freeContext(fieldbus_mac_context_t context) {
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+	dlogg_mac_context_t *mac = context;
+	struct dlogg_mac_backend *backend;
+	dlogg_mac_line_t *line;
+	uint8_t i;
+
+	assert(mac != NULL);
+
+	// Deallocate TTYs
+	backend = mac->backend;
+	for (i = 0; backend != NULL && i < backend->lineCount; i++) {
+		line = &backend->lines[i];
+		if (line->ttyFD < 0)
+			continue;
+
+		if (line->restoreTioSettings) {
+			if (tcsetattr(line->ttyFD, TCSADRAIN, &backend->oldTio[i])) {
 				logging_adapter_info("Can't successfully restore the tty settings: %s",
 						strerror(errno));
 				err = COMMON_TYPE_ERR_IO;
 			}
 		}
-		dlogg_mac_cData.restoreTioSettings = 0;
 
-		if (close(dlogg_mac_ttyFD)) {
+		if (close(line->ttyFD)) {
 			logging_adapter_info("Can't close the tty device: %s", strerror(errno));
 			err = COMMON_TYPE_ERR_IO;
 		}
-		dlogg_mac_ttyFD = -1;
 	}
+	if (backend != NULL) {
+		free(backend->oldTio);
+		free(backend);
+	}
+	dlogg_mac_logStatistics(mac);
+
+	dlogg_cd_free(mac);
+	if (dlogg_sc_free(&mac->stateCache) != COMMON_TYPE_SUCCESS) {
+		err = COMMON_TYPE_ERR_IO;
+	}
+	if (dlogg_cap_free(&mac->capture) != COMMON_TYPE_SUCCESS) {
+		err = COMMON_TYPE_ERR_IO;
+	}
+	free(mac);
 	return err;
 }
-
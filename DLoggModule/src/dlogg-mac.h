@@ -33,45 +33,124 @@ typedef uint8_t dlogg_mac_chksum_t;
 /** @brief The initial checksum value */
 #define DLOGG_MAC_INITIAL_CHKSUM (0)
 
+/**
+ * @brief The state of a single MAC module instance
+ * @details Every instance drives its own set of lines, so instances may be
+ * used concurrently by different threads. The structure is defined within
+ * dlogg-mac-common.h.
+ */
+typedef struct dlogg_mac_context dlogg_mac_context_t;
+
+/** @brief Structure counting the failed transmissions by their cause */
+typedef struct {
+	/** @brief The number of transactions exceeding their deadline */
+	unsigned long timeouts;
+	/** @brief The number of responses received with an invalid checksum */
+	unsigned long checksumErrors;
+	/** @brief The number of failed system or library calls */
+	unsigned long ioErrors;
+} dlogg_mac_statistics_t;
+
 /**
  * @brief Sends the given content
  * @details If chksum is null, no checksum will be calculated. Otherwise the
  * newly generated checksum will be written to the location. The initial value
  * (take zero on the first packet's fragment) is taken to initialize the
- * checksum generation.
+ * checksum generation. The transaction has to be started before sending
+ * the request's first fragment.
+ * @param context The valid MAC instance
  * @param buffer The location of the fragment to send
  * @param length The number of bytes to send
  * @param chksum The checksum location
  * @return The status of the operation
  */
-common_type_error_t dlogg_mac_send(uint8_t *buffer, size_t length,
-		dlogg_mac_chksum_t * chksum);
+common_type_error_t dlogg_mac_send(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum);
 
 /**
  * @brief Sends the given checksum
+ * @param context The valid MAC instance
  * @param chksum A valid pointer to the checksum structure
  * @return The status of the operation
  */
-common_type_error_t dlogg_mac_send_chksum(dlogg_mac_chksum_t * chksum);
+common_type_error_t dlogg_mac_send_chksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t * chksum);
 
 /**
  * @brief Reads the given number of bytes
  * @details It is assumed that the buffer is capable of holding at least length
  * bytes
+ * @param context The valid MAC instance
  * @param buffer The data buffer to store the read data
  * @param length The number of bytes to read
  * @param chksum The checksum value location. See dlogg_send for more details
  * on using this value
  * @return The status of the operation
  */
-common_type_error_t dlogg_mac_read(uint8_t *buffer, size_t length,
+common_type_error_t dlogg_mac_read(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum);
+
+/**
+ * @brief Reads the bytes of the selected line available without waiting
+ * @details The function behaves like dlogg_mac_read, but it returns as soon as
+ * no more bytes are at hand. Thus, a response may be received piecewise while
+ * other lines are served in between. Interfaces unable to tell whether bytes
+ * are available wait until every byte is received or the deadline passes.
+ * @param context The valid MAC instance
+ * @param buffer The data buffer to store the read data
+ * @param length The maximum number of bytes to read
+ * @param received Location receiving the number of bytes read
+ * @param chksum The checksum value location. See dlogg_send for more details
+ * on using this value
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_mac_receive(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, size_t *received,
 		dlogg_mac_chksum_t * chksum);
 
+/**
+ * @brief Waits until at least one of the given lines has bytes to receive
+ * @details The lines are given by a bit mask, the least significant bit
+ * denoting line 0. On success, the mask is reduced to the lines ready. If the
+ * transaction's deadline passes, a timeout is counted for every line given.
+ * Interfaces unable to tell whether bytes are available return immediately
+ * leaving the mask unchanged.
+ * @param context The valid MAC instance
+ * @param lines The location of the bit mask of lines to wait for
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_mac_awaitLines(dlogg_mac_context_t *context,
+		unsigned int *lines);
+
 /**
  * @brief validates the checksum
+ * @param context The valid MAC instance
  * @param chksum The valid checksum value calculated so far
  * @return The status of the operation
  */
-common_type_error_t dlogg_mac_read_chksum(dlogg_mac_chksum_t * chksum);
+common_type_error_t dlogg_mac_read_chksum(dlogg_mac_context_t *context,
+		dlogg_mac_chksum_t * chksum);
+
+/**
+ * @brief Selects the line subsequent transmissions refer to
+ * @details Each line is served by a separate device, so requests sent to
+ * different lines are processed concurrently. The responses of a line have to
+ * be read after selecting the line again. Initially, line 0 is selected.
+ * @param context The valid MAC instance
+ * @param lineID The line's identifier relative to the instance
+ * @return The status of the operation, COMMON_TYPE_ERR_INVALID_ADDRESS if the
+ * line isn't served
+ */
+common_type_error_t dlogg_mac_selectLine(dlogg_mac_context_t *context,
+		uint8_t lineID);
+
+/**
+ * @brief Returns the error counters since creating the instance
+ * @details The caller mustn't modify the returned structure.
+ * @param context The valid MAC instance
+ * @return A valid reference to the counters
+ */
+const dlogg_mac_statistics_t * dlogg_mac_getStatistics(
+		const dlogg_mac_context_t *context);
 
 #endif /* DLOGG_MAC_H_ */
@@ -0,0 +1,667 @@
+/**
+ * @file dlogg-replay.c
+ * @brief Alternative MAC serving a previously captured session
+ * @details <p>The MAC uses the same interfaces as the standard MAC but doesn't
+ * access any device. Instead, it reads a capture file written by the standard
+ * MAC layers and answers each request with the response captured. Hence,
+ * sessions of real installations can be reproduced to profile the decoding
+ * and the logging pipeline without any device.</p>
+ * <p>Each request is matched against the next request captured. If it doesn't
+ * match, e.g. because the meta-data is cached differently, the next matching
+ * request of the capture is searched. The responses are delayed like the
+ * captured ones, divided by the configured speed factor. If the captured
+ * response is incomplete, the read operation times out. At the end of the
+ * capture, the replay fails or starts again.</p>
+ * <p>Captures of several lines are replayed by tracking a separate position
+ * for each line. The number of lines served is given by the capture.</p>
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fieldbus-mac.h>
+#include <logging-adapter.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dlogg-mac.h"
+#include "dlogg-mac-common.h"
+#include "dlogg-capture.h"
+#include "dlogg-current-data.h"
+#include "dlogg-state-cache.h"
+
+/* Configuration directives */
+#define DLOGG_MAC_CONFIG_REPLAY_FILE "replay-file"
+#define DLOGG_MAC_CONFIG_REPLAY_SPEED "replay-speed"
+#define DLOGG_MAC_CONFIG_REPLAY_LOOP "replay-loop"
+
+/** @brief The default speed factor, replays at the captured speed */
+#define DLOGG_MAC_DEF_REPLAY_SPEED (1.0)
+
+/** @brief The initial number of records allocated */
+#define DLOGG_MAC_INITIAL_RECORDS (64)
+
+/** @brief Structure describing a single captured record */
+typedef struct {
+	/** @brief The record's data within the capture file's content */
+	const uint8_t *data;
+	/** @brief The number of data bytes */
+	size_t length;
+	/** @brief The time since the session's start in microseconds */
+	uint64_t time;
+	/** @brief The direction code */
+	uint8_t direction;
+	/** @brief The line the record belongs to */
+	uint8_t lineID;
+} dlogg_mac_record_t;
+
+/** @brief Structure describing the position of a line within the capture */
+typedef struct {
+	/** @brief The index of the current record */
+	size_t record;
+	/** @brief The number of bytes of the current record consumed */
+	size_t position;
+	/** @brief The captured time of the last request in microseconds */
+	uint64_t requestCaptureTime;
+	/** @brief The monotonic time the last request was sent in microseconds */
+	int64_t requestTime;
+} dlogg_mac_cursor_t;
+
+/** @brief The replay specific state of a MAC instance */
+struct dlogg_mac_backend {
+	/** @brief The content of the capture file */
+	uint8_t *content;
+	/** @brief The vector of captured records */
+	struct {
+		/** @brief The records */
+		dlogg_mac_record_t *records;
+		/** @brief The number of records used */
+		size_t length;
+		/** @brief The number of records allocated */
+		size_t capacity;
+	} capture;
+	/** @brief The current position of each line within the capture */
+	dlogg_mac_cursor_t cursors[DLOGG_CD_MAX_LINES];
+	/** @brief The number of lines within the capture */
+	uint8_t lineCount;
+	/** @brief The index of the selected line */
+	uint8_t activeLine;
+	/** @brief The position of the selected line */
+	dlogg_mac_cursor_t *cursor;
+	/** @brief The speed factor or 0 if the responses aren't delayed */
+	double speed;
+	/** @brief Flag indicating that the replay restarts at the end of the capture */
+	int loop;
+	/** @brief Counters describing the replay */
+	struct {
+		/** @brief The number of requests replayed */
+		unsigned long requests;
+		/** @brief The number of requests not matching the capture */
+		unsigned long mismatches;
+		/** @brief The number of times the replay restarted */
+		unsigned long restarts;
+	} replayStatistics;
+};
+
+/* Function Prototypes */
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		const char *path);
+static inline common_type_error_t dlogg_mac_loadCapture(
+		struct dlogg_mac_backend *backend, const char *path);
+static common_type_error_t dlogg_mac_parseCapture(
+		struct dlogg_mac_backend *backend, const uint8_t *content, size_t length);
+static inline uint64_t dlogg_mac_getLE(const uint8_t *buffer, size_t length);
+static int dlogg_mac_findRequest(struct dlogg_mac_backend *backend,
+		const uint8_t *buffer, size_t length);
+static int dlogg_mac_matchesRequest(const struct dlogg_mac_backend *backend,
+		size_t record, const uint8_t *buffer, size_t length);
+static inline size_t dlogg_mac_nextRecord(struct dlogg_mac_backend *backend);
+static void dlogg_mac_delay(const struct dlogg_mac_backend *backend,
+		uint64_t captureTime);
+
+common_type_error_t fieldbus_mac_initContext(config_setting_t* configuration,
+		fieldbus_mac_context_t *context) {
+	const char *path;
+	dlogg_mac_context_t *mac;
+	common_type_error_t err;
+
+	assert(configuration != NULL);
+	assert(context != NULL);
+
+	if (!config_setting_is_group(configuration)) {
+		logging_adapter_info("The MAC configuration isn't a group");
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	if (!config_setting_lookup_string(configuration, DLOGG_MAC_CONFIG_REPLAY_FILE,
+			&path)) {
+		logging_adapter_info("Can't find the \"%s\" string configuration directive "
+				"inside MAC group", DLOGG_MAC_CONFIG_REPLAY_FILE);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	mac = dlogg_mac_newContext();
+	if (mac == NULL)
+		return COMMON_TYPE_ERR;
+
+	err = dlogg_mac_initInstance(mac, configuration, path);
+	if (err != COMMON_TYPE_SUCCESS) {
+		(void) fieldbus_mac_freeContext(mac);
+		return err;
+	}
+
+	*context = mac;
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Initializes the freshly allocated MAC instance
+ * @details The instance has to be freed by the caller if the function fails.
+ * @param context The valid MAC instance
+ * @param configuration The valid MAC configuration group
+ * @param path The valid path of the capture file
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_mac_initInstance(
+		dlogg_mac_context_t *context, config_setting_t* configuration,
+		const char *path) {
+	struct dlogg_mac_backend *backend;
+	common_type_error_t err;
+	double speed = DLOGG_MAC_DEF_REPLAY_SPEED;
+	int loop = 0;
+
+	assert(context != NULL);
+	assert(context->backend == NULL);
+
+	if (config_setting_lookup_float(configuration, DLOGG_MAC_CONFIG_REPLAY_SPEED,
+			&speed) && speed < 0) {
+		logging_adapter_info("The %s configuration directive mustn't be negative: "
+				"%f", DLOGG_MAC_CONFIG_REPLAY_SPEED, speed);
+		return COMMON_TYPE_ERR_CONFIG;
+	}
+
+	(void) config_setting_lookup_bool(configuration, DLOGG_MAC_CONFIG_REPLAY_LOOP,
+			&loop);
+
+	backend = calloc(1, sizeof(*backend));
+	if (backend == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+	backend->speed = speed;
+	backend->loop = loop;
+	backend->lineCount = 1;
+	backend->cursor = &backend->cursors[0];
+	context->backend = backend;
+
+	err = dlogg_sc_init(&context->stateCache, configuration);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	err = dlogg_mac_loadCapture(backend, path);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	return dlogg_cd_init(context, configuration, backend->lineCount);
+}
+
+/**
+ * @brief Reads the whole capture file and indexes its records
+ * @param backend The instance's valid replay state
+ * @param path The valid path of the capture file
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_mac_loadCapture(
+		struct dlogg_mac_backend *backend, const char *path) {
+	FILE *file;
+	long length;
+	common_type_error_t err;
+
+	assert(path != NULL);
+	assert(backend->content == NULL);
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		logging_adapter_info("Can't open the capture file \"%s\": %s", path,
+				strerror(errno));
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	if (fseek(file, 0, SEEK_END) || (length = ftell(file)) < 0
+			|| fseek(file, 0, SEEK_SET)) {
+		logging_adapter_info("Can't determine the size of \"%s\": %s", path,
+				strerror(errno));
+		(void) fclose(file);
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	backend->content = malloc(length > 0 ? length : 1);
+	if (backend->content == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		(void) fclose(file);
+		return COMMON_TYPE_ERR;
+	}
+
+	if (length > 0 && fread(backend->content, length, 1, file) != 1) {
+		logging_adapter_info("Can't read the capture file \"%s\": %s", path,
+				strerror(errno));
+		(void) fclose(file);
+		return COMMON_TYPE_ERR_IO;
+	}
+	(void) fclose(file);
+
+	err = dlogg_mac_parseCapture(backend, backend->content, length);
+	if (err != COMMON_TYPE_SUCCESS)
+		return err;
+
+	logging_adapter_debug("Replay %u records of %u line(s) of \"%s\" with speed "
+			"factor %g", (unsigned) backend->capture.length,
+			(unsigned) backend->lineCount, path, backend->speed);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Indexes the records of the capture file's content
+ * @details A truncated last record, e.g. of an interrupted capture, is
+ * ignored. Line records aren't indexed, the line is stored within each record
+ * instead.
+ * @param backend The instance's valid replay state
+ * @param content The valid content of the capture file
+ * @param length The number of bytes of the content
+ * @return The status of the operation
+ */
+static common_type_error_t dlogg_mac_parseCapture(
+		struct dlogg_mac_backend *backend, const uint8_t *content, size_t length) {
+	dlogg_mac_record_t *record;
+	size_t position = 0;
+	uint8_t lineID = 0;
+	void *tmp;
+
+	assert(content != NULL);
+
+	backend->lineCount = 1;
+	backend->activeLine = 0;
+	backend->cursor = &backend->cursors[0];
+
+	while (position < length) {
+		if (length - position >= DLOGG_CAP_MAGIC_LENGTH + 1
+				&& memcmp(&content[position], DLOGG_CAP_MAGIC, DLOGG_CAP_MAGIC_LENGTH)
+						== 0) {
+			if (content[position + DLOGG_CAP_MAGIC_LENGTH] != DLOGG_CAP_VERSION) {
+				logging_adapter_info("Unsupported capture version %u",
+						(unsigned) content[position + DLOGG_CAP_MAGIC_LENGTH]);
+				return COMMON_TYPE_ERR_INVALID_RESPONSE;
+			}
+			position += DLOGG_CAP_MAGIC_LENGTH + 1;
+			lineID = 0;
+			continue;
+		}
+
+		if (position == 0) {
+			logging_adapter_info("The file isn't a D-LOGG capture");
+			return COMMON_TYPE_ERR_INVALID_RESPONSE;
+		}
+
+		if (length - position < DLOGG_CAP_RECORD_HEADER_LENGTH
+				|| length - position - DLOGG_CAP_RECORD_HEADER_LENGTH
+						< dlogg_mac_getLE(&content[position + 9], 2)) {
+			logging_adapter_info("Ignore the truncated record at offset %lu",
+					(unsigned long) position);
+			break;
+		}
+
+		if (content[position] == DLOGG_CAP_DIR_LINE
+				&& dlogg_mac_getLE(&content[position + 9], 2) == 1) {
+			lineID = content[position + DLOGG_CAP_RECORD_HEADER_LENGTH];
+			if (lineID >= DLOGG_CD_MAX_LINES) {
+				logging_adapter_info("Invalid line %u at offset %lu", (unsigned) lineID,
+						(unsigned long) position);
+				return COMMON_TYPE_ERR_INVALID_RESPONSE;
+			}
+			if (lineID >= backend->lineCount) {
+				backend->lineCount = lineID + 1;
+			}
+			position += DLOGG_CAP_RECORD_HEADER_LENGTH + 1;
+			continue;
+		}
+
+		if (content[position] != DLOGG_CAP_DIR_SEND
+				&& content[position] != DLOGG_CAP_DIR_RECEIVE) {
+			logging_adapter_info("Invalid record direction 0x%02x at offset %lu",
+					(unsigned) content[position], (unsigned long) position);
+			return COMMON_TYPE_ERR_INVALID_RESPONSE;
+		}
+
+		if (backend->capture.length >= backend->capture.capacity) {
+			backend->capture.capacity =
+					backend->capture.capacity > 0 ?
+							2 * backend->capture.capacity : DLOGG_MAC_INITIAL_RECORDS;
+			tmp = realloc(backend->capture.records,
+					backend->capture.capacity * sizeof(backend->capture.records[0]));
+			if (tmp == NULL) {
+				logging_adapter_info("Can't obtain more memory");
+				return COMMON_TYPE_ERR;
+			}
+			backend->capture.records = tmp;
+		}
+
+		record = &backend->capture.records[backend->capture.length++];
+		record->direction = content[position];
+		record->lineID = lineID;
+		record->time = dlogg_mac_getLE(&content[position + 1], 8);
+		record->length = dlogg_mac_getLE(&content[position + 9], 2);
+		record->data = &content[position + DLOGG_CAP_RECORD_HEADER_LENGTH];
+		position += DLOGG_CAP_RECORD_HEADER_LENGTH + record->length;
+	}
+
+	if (dlogg_mac_findRequest(backend, NULL, 0) < 0) {
+		logging_adapter_info("The capture doesn't contain any request");
+		return COMMON_TYPE_ERR_INVALID_RESPONSE;
+	}
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Reads a little endian value
+ * @param buffer The valid buffer containing the value
+ * @param length The number of bytes of the value
+ * @return The value read
+ */
+static inline uint64_t dlogg_mac_getLE(const uint8_t *buffer, size_t length) {
+	uint64_t value = 0;
+
+	while (length-- > 0) {
+		value = (value << 8) | buffer[length];
+	}
+	return value;
+}
+
+common_type_error_t dlogg_mac_send(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
+	struct dlogg_mac_backend *backend;
+	int record;
+
+	assert(context != NULL);
+	assert(buffer != NULL);
+
+	backend = context->backend;
+	record = dlogg_mac_findRequest(backend, buffer, length);
+	if (record < 0) {
+		logging_adapter_info("The end of the capture is reached");
+		context->statistics.ioErrors++;
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	if (record < backend->cursor->record) {
+		logging_adapter_debug("Restart the replay");
+		backend->replayStatistics.restarts++;
+	}
+	backend->cursor->record = record + 1;
+	backend->cursor->position = 0;
+	backend->replayStatistics.requests++;
+
+	backend->cursor->requestTime = dlogg_mac_getMonotonicTime();
+	backend->cursor->requestCaptureTime = backend->capture.records[record].time;
+
+	dlogg_mac_updateChksum(buffer, length, chksum);
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Searches the request of the selected line to replay next
+ * @details The next request captured is preferred. If it doesn't match, the
+ * next matching one is searched. If none matches, the next request is taken
+ * anyway. If the replay is looped, the search wraps around at the end of the
+ * capture.
+ * @param backend The instance's valid replay state
+ * @param buffer The request to search or NULL to find any request
+ * @param length The number of bytes of the request
+ * @return The index of the request record or -1 if none is available
+ */
+static int dlogg_mac_findRequest(struct dlogg_mac_backend *backend,
+		const uint8_t *buffer, size_t length) {
+	size_t i, record, count;
+	int first = -1;
+
+	if (backend->capture.length == 0)
+		return -1;
+
+	count = backend->capture.length;
+	if (!backend->loop) {
+		count -= backend->cursor->record;
+	}
+
+	for (i = 0; i < count; i++) {
+		record = (backend->cursor->record + i) % backend->capture.length;
+		if (backend->capture.records[record].direction != DLOGG_CAP_DIR_SEND
+				|| backend->capture.records[record].lineID != backend->activeLine)
+			continue;
+
+		if (buffer == NULL
+				|| dlogg_mac_matchesRequest(backend, record, buffer, length)) {
+			if (first >= 0) {
+				logging_adapter_debug("Request doesn't match the capture, skip to "
+						"record %u", (unsigned) record);
+				backend->replayStatistics.mismatches++;
+			}
+			return (int) record;
+		}
+
+		if (first < 0) {
+			first = (int) record;
+		}
+	}
+
+	if (first >= 0) {
+		logging_adapter_debug("Request doesn't match any captured one, continue at "
+				"record %u", (unsigned) first);
+		backend->replayStatistics.mismatches++;
+	}
+	return first;
+}
+
+/**
+ * @brief Checks whether the captured request equals the given one
+ * @param backend The instance's valid replay state
+ * @param record The index of a valid request record
+ * @param buffer The valid request
+ * @param length The number of bytes of the request
+ * @return Non-zero if the request matches
+ */
+static int dlogg_mac_matchesRequest(const struct dlogg_mac_backend *backend,
+		size_t record, const uint8_t *buffer, size_t length) {
+	assert(record < backend->capture.length);
+	assert(buffer != NULL);
+
+	return backend->capture.records[record].length == length
+			&& memcmp(backend->capture.records[record].data, buffer, length) == 0;
+}
+
+common_type_error_t dlogg_mac_selectLine(dlogg_mac_context_t *context,
+		uint8_t lineID) {
+	struct dlogg_mac_backend *backend;
+
+	assert(context != NULL);
+	backend = context->backend;
+
+	if (lineID >= backend->lineCount) {
+		logging_adapter_info("The line %u isn't served, the capture contains %u "
+				"line(s)", (unsigned) lineID, (unsigned) backend->lineCount);
+		return COMMON_TYPE_ERR_INVALID_ADDRESS;
+	}
+
+	backend->activeLine = lineID;
+	backend->cursor = &backend->cursors[lineID];
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_error_t dlogg_mac_read(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, dlogg_mac_chksum_t * chksum) {
+	struct dlogg_mac_backend *backend;
+	const dlogg_mac_record_t *record;
+	size_t copied = 0, chunk, next;
+
+	assert(context != NULL);
+	assert(buffer != NULL);
+
+	backend = context->backend;
+	while (copied < length) {
+		next = dlogg_mac_nextRecord(backend);
+		if (next >= backend->capture.length
+				|| backend->capture.records[next].direction != DLOGG_CAP_DIR_RECEIVE) {
+			// The captured response is incomplete
+			if (next < backend->capture.length) {
+				dlogg_mac_delay(backend, backend->capture.records[next].time);
+			}
+			logging_adapter_info("Timeout while reading from d-logg. %u more bytes "
+					"expected, got %u so far.", (unsigned) (length - copied),
+					(unsigned) copied);
+			context->statistics.timeouts++;
+			return COMMON_TYPE_ERR_TIMEOUT;
+		}
+
+		record = &backend->capture.records[next];
+		chunk = record->length - backend->cursor->position;
+		if (chunk > length - copied) {
+			chunk = length - copied;
+		}
+
+		dlogg_mac_delay(backend, record->time);
+		memcpy(&buffer[copied], &record->data[backend->cursor->position], chunk);
+		copied += chunk;
+		backend->cursor->position += chunk;
+
+		if (backend->cursor->position >= record->length) {
+			backend->cursor->record++;
+			backend->cursor->position = 0;
+		}
+	}
+
+	dlogg_mac_updateChksum(buffer, length, chksum);
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @details The replayed response is delayed as captured, so the whole length
+ * is awaited.
+ */
+common_type_error_t dlogg_mac_receive(dlogg_mac_context_t *context,
+		uint8_t *buffer, size_t length, size_t *received,
+		dlogg_mac_chksum_t * chksum) {
+	common_type_error_t err;
+
+	assert(received != NULL);
+
+	*received = 0;
+	err = dlogg_mac_read(context, buffer, length, chksum);
+	if (err == COMMON_TYPE_SUCCESS) {
+		*received = length;
+	}
+	return err;
+}
+
+/**
+ * @details Receiving doesn't depend on waiting before, so the lines are
+ * always reported to be ready.
+ */
+common_type_error_t dlogg_mac_awaitLines(dlogg_mac_context_t *context,
+		unsigned int *lines) {
+	assert(lines != NULL);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Skips the records of other lines
+ * @details The cursor of the selected line is moved to the line's next record.
+ * Records of other lines are never partially consumed by the selected line.
+ * @param backend The instance's valid replay state
+ * @return The index of the selected line's next record or the number of
+ * records at the end of the capture
+ */
+static inline size_t dlogg_mac_nextRecord(struct dlogg_mac_backend *backend) {
+	while (backend->cursor->record < backend->capture.length
+			&& backend->capture.records[backend->cursor->record].lineID
+					!= backend->activeLine) {
+		assert(backend->cursor->position == 0);
+		backend->cursor->record++;
+	}
+	return backend->cursor->record;
+}
+
+/**
+ * @brief Waits until the captured time of a response is reached
+ * @details The time is relative to the selected line's last request. It is
+ * scaled by the inverse speed factor. Interrupts will be gracefully ignored.
+ * @param backend The instance's valid replay state
+ * @param captureTime The captured time of the response in microseconds
+ */
+static void dlogg_mac_delay(const struct dlogg_mac_backend *backend,
+		uint64_t captureTime) {
+	struct timespec tv;
+	uint64_t requestCaptureTime = backend->cursor->requestCaptureTime;
+	double delay;
+
+	if (backend->speed <= 0 || captureTime <= requestCaptureTime)
+		return;
+
+	delay = (captureTime - requestCaptureTime) / backend->speed
+			- (dlogg_mac_getMonotonicTime() - backend->cursor->requestTime);
+	if (delay <= 0)
+		return;
+
+	tv.tv_sec = (time_t) (delay / 1e6);
+	tv.tv_nsec = (long) ((delay - tv.tv_sec * 1e6) * 1e3);
+	(void) nanosleep(&tv, NULL);
+}
+
+common_type_error_t fieldbus_mac_freeContext(fieldbus_mac_context_t context) {
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+	dlogg_mac_context_t *mac = context;
+	struct dlogg_mac_backend *backend;
+
+	assert(mac != NULL);
+
+	backend = mac->backend;
+	if (backend != NULL) {
+		if (backend->replayStatistics.requests > 0) {
+			logging_adapter_info("Replayed %lu request(s), %lu mismatch(es), %lu "
+					"restart(s)", backend->replayStatistics.requests,
+					backend->replayStatistics.mismatches,
+					backend->replayStatistics.restarts);
+		}
+		free(backend->capture.records);
+		free(backend->content);
+		free(backend);
+	}
+	dlogg_mac_logStatistics(mac);
+
+	dlogg_cd_free(mac);
+	if (dlogg_sc_free(&mac->stateCache) != COMMON_TYPE_SUCCESS) {
+		err = COMMON_TYPE_ERR_IO;
+	}
+	free(mac);
+	return err;
+}
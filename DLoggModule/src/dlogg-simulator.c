@@ -0,0 +1,657 @@
+/**
+ * @file dlogg-simulator.c
+ * @brief Simulates a D-LOGG device connected to a UVR 61-3 controller
+ * @details <p>The program opens a pseudo terminal and answers the requests of
+ * the termios based MAC layer like a D-LOGG device. The name of the pseudo
+ * terminal's slave side is printed on startup and may be used as "interface"
+ * directive of the MAC configuration. Optionally, a symbolic link pointing to
+ * the slave side is created, so the configuration doesn't have to be changed
+ * on every start.</p>
+ * <p>The simulator supports the 1DL and 2DL modes. The sample data slowly
+ * changes over time. To test the error handling, the responses may be delayed
+ * and faults may be injected randomly. The simulator runs until it is
+ * terminated and prints the number of answered requests on exit.</p>
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/** @brief The pseudo terminal multiplexer */
+#define DLOGG_SIM_PTMX "/dev/ptmx"
+
+/** @brief The module type request's length including the checksum */
+#define DLOGG_SIM_MOD_TYPE_REQ_LENGTH (8)
+/** @brief The operation mode request's length */
+#define DLOGG_SIM_OP_MODE_REQ_LENGTH (2)
+
+/** @brief The module type code reported in 1DL mode */
+#define DLOGG_SIM_MOD_TYPE_1DL (0xA8)
+/** @brief The module type code reported in 2DL mode */
+#define DLOGG_SIM_MOD_TYPE_2DL (0xD1)
+/** @brief The default firmware version reported, 30 = 3.0 */
+#define DLOGG_SIM_DEF_FIRMWARE (30)
+/** @brief The UVR 61-3 device code */
+#define DLOGG_SIM_DEVICE_UVR61_3 (0x90)
+/** @brief The size of a single UVR 61-3 sample in bytes */
+#define DLOGG_SIM_SAMPLE_SIZE (53)
+/** @brief The number of inputs of a UVR 61-3 sample */
+#define DLOGG_SIM_INPUTS (15)
+
+/** @brief The fault injected kinds enabled by default */
+#define DLOGG_SIM_DEF_FAULTS "cdt"
+
+/** @brief The size of the receive buffer */
+#define DLOGG_SIM_RX_BUFFER_SIZE (64)
+
+/** @brief Enumeration of the requests answered */
+typedef enum {
+	DLOGG_SIM_REQ_MOD_TYPE = 0,
+	DLOGG_SIM_REQ_OP_MODE,
+	DLOGG_SIM_REQ_MOD_MODE,
+	DLOGG_SIM_REQ_CURRENT_DATA,
+	DLOGG_SIM_REQ_INVALID,
+	DLOGG_SIM_REQ_COUNT
+} dlogg_sim_request_t;
+
+/** @brief The names of the requests used while printing */
+static const char * const dlogg_sim_requestNames[DLOGG_SIM_REQ_COUNT] = {
+		"module type", "operation mode", "module mode", "current data",
+		"invalid" };
+
+/** @brief Structure encapsulating the program options */
+static struct {
+	/** @brief The name of the program */
+	const char *progname;
+	/** @brief The path of the symbolic link to create or NULL */
+	const char *link;
+	/** @brief The response delay in milliseconds */
+	long delay;
+	/** @brief The maximum, random additional delay in milliseconds */
+	long jitter;
+	/** @brief The percentage of faulty responses */
+	int faultRate;
+	/** @brief The fault kinds enabled */
+	const char *faultKinds;
+	/** @brief The firmware version reported */
+	int firmware;
+	/** @brief The seed of the random number generator */
+	unsigned seed;
+	/** @brief Flag indicating that both data lines are simulated */
+	unsigned twoLines :1;
+	/** @brief Flag indicating that every request is printed */
+	unsigned verbose :1;
+	/** @brief Flag indicating that the help message has to be printed */
+	unsigned help :1;
+} dlogg_sim_progOpt;
+
+/** @brief The master side of the pseudo terminal */
+static int dlogg_sim_master = -1;
+/** @brief The slave side kept open to survive disconnecting clients */
+static int dlogg_sim_slave = -1;
+
+/** @brief The receive buffer */
+static struct {
+	/** @brief The received bytes */
+	uint8_t data[DLOGG_SIM_RX_BUFFER_SIZE];
+	/** @brief The number of bytes received */
+	size_t length;
+} dlogg_sim_rxBuffer;
+
+/** @brief The number of requests answered by type */
+static unsigned long dlogg_sim_requests[DLOGG_SIM_REQ_COUNT];
+/** @brief The number of faults injected */
+static unsigned long dlogg_sim_faults;
+/** @brief The number of current data frames sent so far */
+static unsigned long dlogg_sim_frame;
+
+/** @brief Flag set by the signal handler to terminate the program */
+static volatile sig_atomic_t dlogg_sim_terminate = 0;
+
+/* Function prototypes */
+static void dlogg_sim_parseProgOpts(int argc, char **argv);
+static void dlogg_sim_printHelp(void);
+static void dlogg_sim_bailOut(const char *format, ...);
+static void dlogg_sim_handleSignal(int signum);
+static void dlogg_sim_openPTY(void);
+static void dlogg_sim_receive(void);
+static size_t dlogg_sim_processRequest(void);
+static void dlogg_sim_respond(dlogg_sim_request_t request, uint8_t *response,
+		size_t length);
+static inline uint8_t dlogg_sim_chksum(const uint8_t *buffer, size_t length);
+static void dlogg_sim_fillSample(uint8_t *sample, unsigned line);
+static inline void dlogg_sim_setInput(uint8_t *input, unsigned type,
+		int value);
+static void dlogg_sim_sleep(long milliseconds);
+
+int main(int argc, char **argv) {
+	struct sigaction action;
+	struct pollfd pfd;
+	unsigned i;
+
+	dlogg_sim_progOpt.progname = argv[0];
+	dlogg_sim_progOpt.faultKinds = DLOGG_SIM_DEF_FAULTS;
+	dlogg_sim_progOpt.firmware = DLOGG_SIM_DEF_FIRMWARE;
+	dlogg_sim_progOpt.seed = (unsigned) time(NULL);
+	dlogg_sim_parseProgOpts(argc, argv);
+
+	if (dlogg_sim_progOpt.help) {
+		dlogg_sim_printHelp();
+		return EXIT_SUCCESS;
+	}
+
+	srand(dlogg_sim_progOpt.seed);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = dlogg_sim_handleSignal;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGINT, &action, NULL) || sigaction(SIGTERM, &action, NULL)) {
+		dlogg_sim_bailOut("Can't register the signal handler");
+	}
+
+	dlogg_sim_openPTY();
+
+	pfd.fd = dlogg_sim_master;
+	pfd.events = POLLIN;
+	while (!dlogg_sim_terminate) {
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			dlogg_sim_bailOut("Can't wait for requests");
+		}
+		dlogg_sim_receive();
+	}
+
+	if (dlogg_sim_progOpt.link != NULL) {
+		(void) unlink(dlogg_sim_progOpt.link);
+	}
+	(void) close(dlogg_sim_slave);
+	(void) close(dlogg_sim_master);
+
+	(void) printf("Requests answered:\n");
+	for (i = 0; i < DLOGG_SIM_REQ_COUNT; i++) {
+		(void) printf("  %-15s %lu\n", dlogg_sim_requestNames[i],
+				dlogg_sim_requests[i]);
+	}
+	(void) printf("Faults injected: %lu\n", dlogg_sim_faults);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Parses the given program options and populates the global
+ * dlogg_sim_progOpt structure
+ * @param argc The number of passed arguments
+ * @param argv The argument vector
+ */
+static void dlogg_sim_parseProgOpts(int argc, char **argv) {
+	int nextOpt;
+	char *end;
+
+	while ((nextOpt = getopt(argc, argv, "2d:e:f:hj:k:l:s:v")) > 0) {
+		switch (nextOpt) {
+		case '2':
+			dlogg_sim_progOpt.twoLines = 1;
+			break;
+		case 'd':
+			dlogg_sim_progOpt.delay = strtol(optarg, &end, 10);
+			if (*end != '\0' || dlogg_sim_progOpt.delay < 0) {
+				dlogg_sim_bailOut("Invalid delay \"%s\"", optarg);
+			}
+			break;
+		case 'e':
+			dlogg_sim_progOpt.faultRate = (int) strtol(optarg, &end, 10);
+			if (*end != '\0' || dlogg_sim_progOpt.faultRate < 0
+					|| dlogg_sim_progOpt.faultRate > 100) {
+				dlogg_sim_bailOut("Invalid fault rate \"%s\"", optarg);
+			}
+			break;
+		case 'f':
+			dlogg_sim_progOpt.firmware = (int) strtol(optarg, &end, 10);
+			if (*end != '\0' || dlogg_sim_progOpt.firmware < 0
+					|| dlogg_sim_progOpt.firmware > 0xFF) {
+				dlogg_sim_bailOut("Invalid firmware version \"%s\"", optarg);
+			}
+			break;
+		case 'h':
+			dlogg_sim_progOpt.help = 1;
+			break;
+		case 'j':
+			dlogg_sim_progOpt.jitter = strtol(optarg, &end, 10);
+			if (*end != '\0' || dlogg_sim_progOpt.jitter < 0) {
+				dlogg_sim_bailOut("Invalid jitter \"%s\"", optarg);
+			}
+			break;
+		case 'k':
+			if (optarg[0] == '\0' || strspn(optarg, "cdts") != strlen(optarg)) {
+				dlogg_sim_bailOut("Invalid fault kinds \"%s\"", optarg);
+			}
+			dlogg_sim_progOpt.faultKinds = optarg;
+			break;
+		case 'l':
+			dlogg_sim_progOpt.link = optarg;
+			break;
+		case 's':
+			dlogg_sim_progOpt.seed = (unsigned) strtoul(optarg, &end, 10);
+			if (*end != '\0') {
+				dlogg_sim_bailOut("Invalid seed \"%s\"", optarg);
+			}
+			break;
+		case 'v':
+			dlogg_sim_progOpt.verbose = 1;
+			break;
+		case '?':
+			dlogg_sim_bailOut("Invalid option '%c'", (char) optopt);
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if (optind < argc) {
+		dlogg_sim_bailOut("%i additional arguments found but none expected",
+				argc - optind);
+	}
+}
+
+/**
+ * @brief Prints a simple help message
+ * @details The output is written to stdout
+ */
+static void dlogg_sim_printHelp(void) {
+	(void) printf("Usage:\n");
+	(void) printf("  %s [-2] [-f <version>] [-l <link>] [-d <ms>] [-j <ms>]\n"
+			"      [-e <percent>] [-k <kinds>] [-s <seed>] [-v] [-h]\n\n",
+			dlogg_sim_progOpt.progname);
+	(void) printf("  -2           Simulates two data lines (2DL mode)\n");
+	(void) printf("  -f <version> Reports the firmware <version>, default %d\n",
+			DLOGG_SIM_DEF_FIRMWARE);
+	(void) printf("  -l <link>    Creates a symbolic <link> to the pseudo "
+			"terminal\n");
+	(void) printf("  -d <ms>      Delays each response\n");
+	(void) printf("  -j <ms>      Adds a random delay of up to <ms> to each "
+			"response\n");
+	(void) printf("  -e <percent> Injects faults into <percent> of the "
+			"responses\n");
+	(void) printf("  -k <kinds>   The fault kinds injected, default \"%s\":\n",
+			DLOGG_SIM_DEF_FAULTS);
+	(void) printf("               c: invalid checksum, d: dropped response,\n");
+	(void) printf("               t: truncated response, s: stale extra byte\n");
+	(void) printf("  -s <seed>    Seeds the random number generator\n");
+	(void) printf("  -v           Prints every request\n\n");
+	(void) printf("Simulates a D-LOGG device connected to UVR 61-3 controllers "
+			"using a pseudo\n");
+	(void) printf("terminal\n");
+}
+
+/**
+ * @brief Prints the error message and exits
+ * @details If the errno variable is set to a non zero value the corresponding
+ * message will also be printed.
+ * @param format The printf-styled format string
+ */
+static void dlogg_sim_bailOut(const char *format, ...) {
+	va_list args;
+	int errnoSave = errno;
+
+	(void) fprintf(stderr, "%s: ", dlogg_sim_progOpt.progname);
+	va_start(args, format);
+	(void) vfprintf(stderr, format, args);
+	va_end(args);
+	if (errnoSave != 0) {
+		(void) fprintf(stderr, ": %s", strerror(errnoSave));
+	}
+	(void) fprintf(stderr, "\n");
+
+	if (dlogg_sim_progOpt.link != NULL && dlogg_sim_master >= 0) {
+		(void) unlink(dlogg_sim_progOpt.link);
+	}
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Requests terminating the program
+ * @param signum The signal number received
+ */
+static void dlogg_sim_handleSignal(int signum) {
+	dlogg_sim_terminate = 1;
+}
+
+/**
+ * @brief Opens the pseudo terminal and prints the slave's name
+ * @details The slave side is opened as well and set to raw mode. Hence, bytes
+ * sent before the MAC layer configures the terminal aren't echoed and the
+ * master side stays valid if the MAC layer closes the terminal.
+ */
+static void dlogg_sim_openPTY(void) {
+	struct termios tio;
+	const char *slaveName;
+
+	errno = 0;
+	dlogg_sim_master = open(DLOGG_SIM_PTMX, O_RDWR | O_NOCTTY);
+	if (dlogg_sim_master < 0) {
+		dlogg_sim_bailOut("Can't open \"%s\"", DLOGG_SIM_PTMX);
+	}
+	if (grantpt(dlogg_sim_master) || unlockpt(dlogg_sim_master)) {
+		dlogg_sim_bailOut("Can't unlock the pseudo terminal");
+	}
+	slaveName = ptsname(dlogg_sim_master);
+	if (slaveName == NULL) {
+		dlogg_sim_bailOut("Can't obtain the pseudo terminal's name");
+	}
+
+	dlogg_sim_slave = open(slaveName, O_RDWR | O_NOCTTY);
+	if (dlogg_sim_slave < 0) {
+		dlogg_sim_bailOut("Can't open \"%s\"", slaveName);
+	}
+	if (tcgetattr(dlogg_sim_slave, &tio)) {
+		dlogg_sim_bailOut("Can't read the terminal attributes");
+	}
+	cfmakeraw(&tio);
+	if (tcsetattr(dlogg_sim_slave, TCSANOW, &tio)) {
+		dlogg_sim_bailOut("Can't set the terminal attributes");
+	}
+
+	if (dlogg_sim_progOpt.link != NULL) {
+		(void) unlink(dlogg_sim_progOpt.link);
+		if (symlink(slaveName, dlogg_sim_progOpt.link)) {
+			dlogg_sim_bailOut("Can't create the link \"%s\"",
+					dlogg_sim_progOpt.link);
+		}
+	}
+
+	(void) printf("Simulating a %s D-LOGG at %s\n",
+			dlogg_sim_progOpt.twoLines ? "2DL" : "1DL",
+			dlogg_sim_progOpt.link != NULL ? dlogg_sim_progOpt.link : slaveName);
+	(void) fflush(stdout);
+}
+
+/**
+ * @brief Reads the bytes available and answers every complete request
+ */
+static void dlogg_sim_receive(void) {
+	ssize_t rd;
+	size_t consumed;
+
+	rd = read(dlogg_sim_master,
+			&dlogg_sim_rxBuffer.data[dlogg_sim_rxBuffer.length],
+			sizeof(dlogg_sim_rxBuffer.data) - dlogg_sim_rxBuffer.length);
+	if (rd < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		dlogg_sim_bailOut("Can't read from the pseudo terminal");
+	}
+	dlogg_sim_rxBuffer.length += rd;
+
+	while (dlogg_sim_rxBuffer.length > 0) {
+		consumed = dlogg_sim_processRequest();
+		if (consumed == 0)
+			break;
+
+		dlogg_sim_rxBuffer.length -= consumed;
+		memmove(dlogg_sim_rxBuffer.data, &dlogg_sim_rxBuffer.data[consumed],
+				dlogg_sim_rxBuffer.length);
+	}
+}
+
+/**
+ * @brief Answers the request at the beginning of the receive buffer
+ * @return The number of bytes consumed or 0 if the request is incomplete
+ */
+static size_t dlogg_sim_processRequest(void) {
+	uint8_t response[2 * (DLOGG_SIM_SAMPLE_SIZE + 1) + 1];
+	uint8_t *request = dlogg_sim_rxBuffer.data;
+	uint8_t modType;
+	size_t length = 0;
+	unsigned line;
+
+	assert(dlogg_sim_rxBuffer.length > 0);
+
+	modType = dlogg_sim_progOpt.twoLines ? DLOGG_SIM_MOD_TYPE_2DL :
+			DLOGG_SIM_MOD_TYPE_1DL;
+
+	switch (request[0]) {
+	case 0x20:
+		if (dlogg_sim_rxBuffer.length < DLOGG_SIM_MOD_TYPE_REQ_LENGTH)
+			return 0;
+
+		if (request[1] != 0x10 || request[2] != 0x18
+				|| dlogg_sim_chksum(request, DLOGG_SIM_MOD_TYPE_REQ_LENGTH - 1)
+						!= request[DLOGG_SIM_MOD_TYPE_REQ_LENGTH - 1]) {
+			response[0] = 0xFF;
+			response[1] = 0x00;
+			dlogg_sim_respond(DLOGG_SIM_REQ_INVALID, response, 2);
+		} else {
+			response[0] = 0x21;
+			response[1] = 0x43;
+			response[2] = modType;
+			response[3] = (uint8_t) dlogg_sim_progOpt.firmware;
+			response[4] = dlogg_sim_chksum(&response[2], 2);
+			dlogg_sim_respond(DLOGG_SIM_REQ_MOD_TYPE, response, 5);
+		}
+		return DLOGG_SIM_MOD_TYPE_REQ_LENGTH;
+
+	case 0x21:
+		if (dlogg_sim_rxBuffer.length < DLOGG_SIM_OP_MODE_REQ_LENGTH)
+			return 0;
+
+		response[0] = modType;
+		dlogg_sim_respond(DLOGG_SIM_REQ_OP_MODE, response, 1);
+		return DLOGG_SIM_OP_MODE_REQ_LENGTH;
+
+	case 0x81:
+		response[0] = modType;
+		dlogg_sim_respond(DLOGG_SIM_REQ_MOD_MODE, response, 1);
+		return 1;
+
+	case 0xAB:
+		dlogg_sim_frame++;
+		for (line = 0; line < (dlogg_sim_progOpt.twoLines ? 2u : 1u); line++) {
+			response[length++] = DLOGG_SIM_DEVICE_UVR61_3;
+			dlogg_sim_fillSample(&response[length], line);
+			length += DLOGG_SIM_SAMPLE_SIZE;
+		}
+		response[length] = dlogg_sim_chksum(response, length);
+		length++;
+		dlogg_sim_respond(DLOGG_SIM_REQ_CURRENT_DATA, response, length);
+		return 1;
+
+	default:
+		if (dlogg_sim_progOpt.verbose) {
+			(void) fprintf(stderr, "Ignore unknown request byte 0x%02x\n",
+					(unsigned) request[0]);
+		}
+		dlogg_sim_requests[DLOGG_SIM_REQ_INVALID]++;
+		return 1;
+	}
+}
+
+/**
+ * @brief Sends the response after the configured delay
+ * @details The response may be modified or dropped to inject a fault. The last
+ * byte of the response is assumed to be the checksum, if any.
+ * @param request The request answered
+ * @param response The valid response
+ * @param length The number of bytes to send
+ */
+static void dlogg_sim_respond(dlogg_sim_request_t request, uint8_t *response,
+		size_t length) {
+	const char *fault = NULL;
+	uint8_t stale = 0x55;
+	int staleByte = 0;
+	ssize_t wr;
+
+	assert(response != NULL);
+	assert(length > 0);
+
+	dlogg_sim_requests[request]++;
+
+	if (dlogg_sim_progOpt.faultRate > 0
+			&& rand() % 100 < dlogg_sim_progOpt.faultRate) {
+		dlogg_sim_faults++;
+		switch (dlogg_sim_progOpt.faultKinds[rand()
+				% strlen(dlogg_sim_progOpt.faultKinds)]) {
+		case 'c':
+			response[length - 1] ^= 0x01;
+			fault = "invalid checksum";
+			break;
+		case 'd':
+			length = 0;
+			fault = "dropped response";
+			break;
+		case 't':
+			length /= 2;
+			fault = "truncated response";
+			break;
+		case 's':
+			staleByte = 1;
+			fault = "stale extra byte";
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if (dlogg_sim_progOpt.verbose) {
+		(void) fprintf(stderr, "Answer %s request (%u bytes)%s%s\n",
+				dlogg_sim_requestNames[request], (unsigned) length,
+				fault != NULL ? ", inject " : "", fault != NULL ? fault : "");
+	}
+
+	dlogg_sim_sleep(dlogg_sim_progOpt.delay
+			+ (dlogg_sim_progOpt.jitter > 0 ?
+					rand() % (dlogg_sim_progOpt.jitter + 1) : 0));
+
+	while (length > 0) {
+		wr = write(dlogg_sim_master, response, length);
+		if (wr < 0) {
+			if (errno == EINTR)
+				continue;
+			dlogg_sim_bailOut("Can't write to the pseudo terminal");
+		}
+		response += wr;
+		length -= wr;
+	}
+
+	if (staleByte) {
+		(void) write(dlogg_sim_master, &stale, sizeof(stale));
+	}
+}
+
+/**
+ * @brief Calculates the checksum of the given buffer
+ * @param buffer The valid buffer
+ * @param length The number of bytes to sum up
+ * @return The sum of the bytes mod 256
+ */
+static inline uint8_t dlogg_sim_chksum(const uint8_t *buffer, size_t length) {
+	uint8_t chksum = 0;
+
+	while (length-- > 0) {
+		chksum += *buffer++;
+	}
+	return chksum;
+}
+
+/**
+ * @brief Writes a UVR 61-3 sample (protocol version 1.4)
+ * @details The values slowly change with every frame sent. The first six
+ * inputs are temperature sensors, followed by a digital input, a volume flow,
+ * a solar radiation and a room temperature sensor. The remaining inputs are
+ * unused.
+ * @param sample The destination of the sample's 53 bytes
+ * @param line The data line number used to vary the values
+ */
+static void dlogg_sim_fillSample(uint8_t *sample, unsigned line) {
+	unsigned long frame = dlogg_sim_frame;
+	uint32_t energy;
+	unsigned i;
+
+	memset(sample, 0, DLOGG_SIM_SAMPLE_SIZE);
+
+	// Temperatures in 0.1 degree Celsius, the last one below zero
+	for (i = 0; i < 6; i++) {
+		dlogg_sim_setInput(&sample[2 * i], 2,
+				(i == 5 ? -45 : 200 + 100 * (int) i) + 50 * (int) line
+						+ (int) ((frame + 7 * i) % 40) - 20);
+	}
+	dlogg_sim_setInput(&sample[12], 1, (int) ((frame / 10) % 2));
+	dlogg_sim_setInput(&sample[14], 3, 25 + (int) (frame % 5)); // 4l/h steps
+	dlogg_sim_setInput(&sample[16], 6, 300 + (int) (frame % 100)); // W/m^2
+	dlogg_sim_setInput(&sample[18], 7, 215 + (int) (frame % 10));
+
+	sample[2 * DLOGG_SIM_INPUTS] = 0x05; // outputs 1 and 3 active
+	sample[2 * DLOGG_SIM_INPUTS + 1] = 20; // speed step 20, active
+	sample[2 * DLOGG_SIM_INPUTS + 2] = 50; // 5.0V, active
+	sample[2 * DLOGG_SIM_INPUTS + 3] = 0x80; // inactive
+	sample[2 * DLOGG_SIM_INPUTS + 4] = 0x01; // heat meter 1 active
+
+	// Heat meter 1: 1.5kW, 0.1kWh and MWh counters
+	energy = 12345 + frame;
+	sample[2 * DLOGG_SIM_INPUTS + 5] = 15;
+	sample[2 * DLOGG_SIM_INPUTS + 6] = 0;
+	sample[2 * DLOGG_SIM_INPUTS + 7] = (energy % 10000) & 0xFF;
+	sample[2 * DLOGG_SIM_INPUTS + 8] = ((energy % 10000) >> 8) & 0xFF;
+	sample[2 * DLOGG_SIM_INPUTS + 9] = (energy / 10000) & 0xFF;
+	sample[2 * DLOGG_SIM_INPUTS + 10] = ((energy / 10000) >> 8) & 0xFF;
+}
+
+/**
+ * @brief Encodes a single input value
+ * @param input The destination of the input's two bytes
+ * @details Digital inputs store their state in the sign bit.
+ * @param type The input type code
+ * @param value The value in the type's resolution, 12 bits plus sign
+ */
+static inline void dlogg_sim_setInput(uint8_t *input, unsigned type,
+		int value) {
+	unsigned raw = (unsigned) value & 0x0FFF;
+	int sign = (type == 1) ? (value != 0) : (value < 0);
+
+	input[0] = raw & 0xFF;
+	input[1] = ((raw >> 8) & 0x0F) | ((type & 0x07) << 4) | (sign ? 0x80 : 0x00);
+}
+
+/**
+ * @brief Sleeps for the given time
+ * @details Interrupts are gracefully ignored.
+ * @param milliseconds The time to sleep
+ */
+static void dlogg_sim_sleep(long milliseconds) {
+	struct timespec tv;
+
+	if (milliseconds <= 0)
+		return;
+
+	tv.tv_sec = milliseconds / 1000;
+	tv.tv_nsec = (milliseconds % 1000) * 1000000L;
+	while (nanosleep(&tv, &tv) && errno == EINTR && !dlogg_sim_terminate)
+		;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file dlogg-state-cache.c
+ * @brief Implements the persistent state of the D-LOGG MAC layer
+ * @details The state file is a small text file. The first line holds a
+ * version tag, each further line holds one cached item. Unknown lines are
+ * ignored, so the file may be deleted or edited at any time.
+ *
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dlogg-state-cache.h"
+
+#include <logging-adapter.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief The state file directive */
+#define DLOGG_SC_CONFIG_CACHE_FILE "cache-file"
+
+/** @brief The first line of a valid state file */
+#define DLOGG_SC_VERSION_TAG "dlogg-state 2"
+/** @brief The suffix of the temporary file written before replacing */
+#define DLOGG_SC_TMP_SUFFIX ".tmp"
+/** @brief The maximum length of a line within the state file */
+#define DLOGG_SC_LINE_LENGTH (128)
+
+/* Function prototypes */
+static inline void dlogg_sc_load(dlogg_sc_state_t *state);
+static inline void dlogg_sc_parseLine(dlogg_sc_state_t *state,
+		const char *line);
+static inline common_type_error_t dlogg_sc_store(dlogg_sc_state_t *state);
+
+common_type_error_t dlogg_sc_init(dlogg_sc_state_t *state,
+		config_setting_t *configuration) {
+	const char *path;
+
+	assert(state != NULL);
+	assert(configuration != NULL);
+	assert(state->path == NULL);
+
+	memset(state, 0, sizeof(*state));
+
+	if (!config_setting_lookup_string(configuration, DLOGG_SC_CONFIG_CACHE_FILE,
+			&path)) {
+		return COMMON_TYPE_SUCCESS; // The cache is optional
+	}
+
+	// The configuration may be destroyed before the state is written
+	state->path = strdup(path);
+	if (state->path == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	dlogg_sc_load(state);
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Reads the state file, if any
+ * @details Every error is reported at debug level only. The items read so far
+ * are kept.
+ * @param state The valid state to populate
+ */
+static inline void dlogg_sc_load(dlogg_sc_state_t *state) {
+	FILE *file;
+	char line[DLOGG_SC_LINE_LENGTH];
+
+	assert(state->path != NULL);
+
+	file = fopen(state->path, "r");
+	if (file == NULL) {
+		logging_adapter_debug("No state file \"%s\" loaded: %s",
+				state->path, strerror(errno));
+		return;
+	}
+
+	if (fgets(line, sizeof(line), file) == NULL
+			|| strncmp(line, DLOGG_SC_VERSION_TAG, strlen(DLOGG_SC_VERSION_TAG))
+					!= 0) {
+		logging_adapter_debug("Ignore the state file \"%s\" of an unknown version",
+				state->path);
+		(void) fclose(file);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		dlogg_sc_parseLine(state, line);
+	}
+
+	(void) fclose(file);
+
+	logging_adapter_debug("Loaded state file \"%s\" (meta-data: 0x%02x, USB "
+			"device: %s)", state->path,
+			(unsigned) state->metadataValid,
+			state->usbDeviceValid ? "yes" : "no");
+}
+
+/**
+ * @brief Parses a single item of the state file
+ * @param state The valid state to populate
+ * @param line The valid, zero terminated line
+ */
+static inline void dlogg_sc_parseLine(dlogg_sc_state_t *state,
+		const char *line) {
+	unsigned lineID, type, firmware, mode, bus, address;
+	int index;
+
+	assert(line != NULL);
+
+	if (sscanf(line, "metadata %u %x %x %x", &lineID, &type, &firmware, &mode)
+			== 4 && lineID < DLOGG_CD_MAX_LINES && type <= 0xFF && firmware <= 0xFF
+			&& mode <= 0xFF) {
+		state->metadata[lineID].moduleType.type = type;
+		state->metadata[lineID].moduleType.firmware = firmware;
+		state->metadata[lineID].mode = mode;
+		state->metadataValid |= 1u << lineID;
+	} else if (sscanf(line, "usb %d %u %u", &index, &bus, &address) == 3
+			&& index >= 0 && bus <= 0xFF && address <= 0xFF) {
+		state->usbDevice.index = index;
+		state->usbDevice.bus = bus;
+		state->usbDevice.address = address;
+		state->usbDeviceValid = 1;
+	}
+}
+
+int dlogg_sc_getMetadata(const dlogg_sc_state_t *state, uint8_t lineID,
+		dlogg_cd_metadata_t *metadata) {
+	assert(state != NULL);
+	assert(metadata != NULL);
+	assert(lineID < DLOGG_CD_MAX_LINES);
+
+	if (!(state->metadataValid & (1u << lineID)))
+		return 0;
+
+	metadata->moduleType = state->metadata[lineID].moduleType;
+	metadata->mode = state->metadata[lineID].mode;
+	return 1;
+}
+
+void dlogg_sc_setMetadata(dlogg_sc_state_t *state, uint8_t lineID,
+		const dlogg_cd_metadata_t *metadata) {
+	dlogg_cd_metadata_t *cached;
+
+	assert(state != NULL);
+	assert(metadata != NULL);
+	assert(lineID < DLOGG_CD_MAX_LINES);
+
+	if (state->path == NULL)
+		return;
+
+	cached = &state->metadata[lineID];
+	if (!(state->metadataValid & (1u << lineID))
+			|| cached->moduleType.type != metadata->moduleType.type
+			|| cached->moduleType.firmware != metadata->moduleType.firmware
+			|| cached->mode != metadata->mode) {
+		cached->moduleType = metadata->moduleType;
+		cached->mode = metadata->mode;
+		state->metadataValid |= 1u << lineID;
+		state->dirty = 1;
+	}
+}
+
+int dlogg_sc_getUSBDevice(const dlogg_sc_state_t *state,
+		dlogg_sc_usbDevice_t *device) {
+	assert(state != NULL);
+	assert(device != NULL);
+
+	if (!state->usbDeviceValid)
+		return 0;
+
+	*device = state->usbDevice;
+	return 1;
+}
+
+void dlogg_sc_setUSBDevice(dlogg_sc_state_t *state,
+		const dlogg_sc_usbDevice_t *device) {
+	assert(state != NULL);
+	assert(device != NULL);
+
+	if (state->path == NULL)
+		return;
+
+	if (!state->usbDeviceValid
+			|| state->usbDevice.index != device->index
+			|| state->usbDevice.bus != device->bus
+			|| state->usbDevice.address != device->address) {
+		state->usbDevice = *device;
+		state->usbDeviceValid = 1;
+		state->dirty = 1;
+	}
+}
+
+void dlogg_sc_clear(dlogg_sc_state_t *state, uint8_t lineID) {
+	assert(state != NULL);
+	assert(lineID < DLOGG_CD_MAX_LINES);
+
+	if ((state->metadataValid & (1u << lineID))
+			|| state->usbDeviceValid) {
+		state->metadataValid &= ~(1u << lineID);
+		state->usbDeviceValid = 0;
+		state->dirty = (state->path != NULL);
+	}
+}
+
+common_type_error_t dlogg_sc_free(dlogg_sc_state_t *state) {
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+
+	assert(state != NULL);
+
+	if (state->path != NULL && state->dirty) {
+		err = dlogg_sc_store(state);
+	}
+
+	free(state->path);
+	memset(state, 0, sizeof(*state));
+
+	return err;
+}
+
+/**
+ * @brief Writes the cached state to a temporary file and replaces the state
+ * file afterwards
+ * @param state The valid state to write
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_sc_store(dlogg_sc_state_t *state) {
+	FILE *file;
+	char *tmpPath;
+	int failed;
+	unsigned lineID;
+
+	assert(state->path != NULL);
+
+	tmpPath = malloc(strlen(state->path) + sizeof(DLOGG_SC_TMP_SUFFIX));
+	if (tmpPath == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+	strcpy(tmpPath, state->path);
+	strcat(tmpPath, DLOGG_SC_TMP_SUFFIX);
+
+	file = fopen(tmpPath, "w");
+	if (file == NULL) {
+		logging_adapter_info("Can't write the state file \"%s\": %s", tmpPath,
+				strerror(errno));
+		free(tmpPath);
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	failed = fprintf(file, "%s\n", DLOGG_SC_VERSION_TAG) < 0;
+	for (lineID = 0; lineID < DLOGG_CD_MAX_LINES; lineID++) {
+		if (state->metadataValid & (1u << lineID)) {
+			failed |= fprintf(file, "metadata %u %02x %02x %02x\n", lineID,
+					(unsigned) state->metadata[lineID].moduleType.type,
+					(unsigned) state->metadata[lineID].moduleType.firmware,
+					(unsigned) state->metadata[lineID].mode) < 0;
+		}
+	}
+	if (state->usbDeviceValid) {
+		failed |= fprintf(file, "usb %d %u %u\n", state->usbDevice.index,
+				(unsigned) state->usbDevice.bus,
+				(unsigned) state->usbDevice.address) < 0;
+	}
+	failed |= fclose(file) != 0;
+
+	if (failed || rename(tmpPath, state->path) != 0) {
+		logging_adapter_info("Can't write the state file \"%s\": %s",
+				state->path, strerror(errno));
+		(void) remove(tmpPath);
+		free(tmpPath);
+		return COMMON_TYPE_ERR_IO;
+	}
+
+	logging_adapter_debug("Stored state file \"%s\"", state->path);
+	free(tmpPath);
+	return COMMON_TYPE_SUCCESS;
+}
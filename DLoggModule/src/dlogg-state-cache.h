@@ -0,0 +1,136 @@
+/**
+ * @file dlogg-state-cache.h
+ * @brief The header file specifies the persistent state of the D-LOGG MAC
+ * layer.
+ * @details If the program is invoked periodically, each invocation would have
+ * to discover the USB device and fetch the logger's meta-data again. The state
+ * cache keeps both in a small file between invocations. The cached values are
+ * hints only. If they don't fit anymore, the full discovery is done and the
+ * cache is updated. The definitions of this module arn't meant to be used
+ * outside the MAC layer.
+ * @author Michael Spiegel, michael.h.spiegel@gmail.com
+ *
+ * Copyright (C) 2019 Michael Spiegel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DLOGG_STATE_CACHE_H_
+#define DLOGG_STATE_CACHE_H_
+
+#include "dlogg-current-data.h"
+
+#include <common-type.h>
+#include <libconfig.h>
+#include <stdint.h>
+
+/** @brief Structure describing the USB device used last time */
+typedef struct {
+	/** @brief The index of the device within libftdi's device list */
+	int index;
+	/** @brief The USB bus number */
+	uint8_t bus;
+	/** @brief The device address on the bus */
+	uint8_t address;
+} dlogg_sc_usbDevice_t;
+
+/** @brief structure encapsulating the cached state of a MAC instance */
+typedef struct {
+	/** @brief The path of the state file or NULL if the cache is disabled */
+	char *path;
+	/** @brief The cached meta-data of each line */
+	dlogg_cd_metadata_t metadata[DLOGG_CD_MAX_LINES];
+	/** @brief The cached USB device */
+	dlogg_sc_usbDevice_t usbDevice;
+	/** @brief Bit mask of the lines whose meta-data is cached */
+	unsigned metadataValid :DLOGG_CD_MAX_LINES;
+	/** @brief Flag indicating that the USB device is cached */
+	unsigned usbDeviceValid :1;
+	/** @brief Flag indicating that the state has to be written */
+	unsigned dirty :1;
+} dlogg_sc_state_t;
+
+/**
+ * @brief Initializes the state cache and loads the state file
+ * @details The file's path is taken from the optional "cache-file" directive
+ * of the MAC configuration. If the directive is missing, the cache is disabled
+ * and every other function behaves as if nothing was cached. A missing or
+ * malformed state file isn't treated as an error. Each MAC instance needs its
+ * own state file.
+ * @param state The instance's zero initialized state
+ * @param configuration The valid MAC configuration group
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_sc_init(dlogg_sc_state_t *state,
+		config_setting_t *configuration);
+
+/**
+ * @brief Copies the cached meta-data of the last run
+ * @details Only the module type and the mode are restored. The sample count is
+ * left untouched.
+ * @param state The instance's valid state
+ * @param lineID The line's identifier, less than DLOGG_CD_MAX_LINES
+ * @param metadata The destination of the meta-data
+ * @return 1 if the meta-data was cached, 0 otherwise
+ */
+int dlogg_sc_getMetadata(const dlogg_sc_state_t *state, uint8_t lineID,
+		dlogg_cd_metadata_t *metadata);
+
+/**
+ * @brief Stores the freshly fetched meta-data
+ * @param state The instance's valid state
+ * @param lineID The line's identifier, less than DLOGG_CD_MAX_LINES
+ * @param metadata The valid meta-data
+ */
+void dlogg_sc_setMetadata(dlogg_sc_state_t *state, uint8_t lineID,
+		const dlogg_cd_metadata_t *metadata);
+
+/**
+ * @brief Copies the USB device used by the last run
+ * @param state The instance's valid state
+ * @param device The destination of the device description
+ * @return 1 if a device was cached, 0 otherwise
+ */
+int dlogg_sc_getUSBDevice(const dlogg_sc_state_t *state,
+		dlogg_sc_usbDevice_t *device);
+
+/**
+ * @brief Stores the USB device currently used
+ * @param state The instance's valid state
+ * @param device The valid device description
+ */
+void dlogg_sc_setUSBDevice(dlogg_sc_state_t *state,
+		const dlogg_sc_usbDevice_t *device);
+
+/**
+ * @brief Drops the cached items of a line
+ * @details The function has to be called if the cached state doesn't fit the
+ * line's device anymore. The next invocation does the full discovery of the
+ * line. The cached USB device is dropped as well. The meta-data of other lines
+ * is kept.
+ * @param state The instance's valid state
+ * @param lineID The line's identifier, less than DLOGG_CD_MAX_LINES
+ */
+void dlogg_sc_clear(dlogg_sc_state_t *state, uint8_t lineID);
+
+/**
+ * @brief Writes the state file if the state changed and frees used resources
+ * @details The file is replaced atomically, so an interrupted write doesn't
+ * leave a truncated file behind.
+ * @param state The instance's state
+ * @return The status of the operation
+ */
+common_type_error_t dlogg_sc_free(dlogg_sc_state_t *state);
+
+#endif /* DLOGG_STATE_CACHE_H_ */
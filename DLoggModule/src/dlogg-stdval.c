@@ -7,6 +7,13 @@
  * against a sample-type dependent profile and the addressed value is extracted.
  * For each type of channel a separate function exists encapsulating different
  * access functionality. (This is why there are so many functions ;-) )
+ * Every address is compiled in advance, so parsing the user input, checking
+ * the static address ranges and looking up the addressed line is done once
+ * only. Fetching several compiled addresses at once additionally shares
+ * looking up the addressed sample. The compiled addresses are kept within the
+ * module's context and fetching values doesn't modify any state. Hence,
+ * several threads may fetch values concurrently. Values transmitted as integer
+ * multiples of a decimal step are returned as exact fixed-point values.
  *
  * @author Michael Spiegel, michael.h.spiegel@gmail.com
  *
@@ -31,6 +38,7 @@
 #include "dlogg-current-data.h"
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* The configuration directive names used */
@@ -76,8 +84,18 @@ typedef struct {
 	uint8_t channelID;
 	/** @brief The d-logg's input channel starting at zero */
 	unsigned controllerID :1;
+	/** @brief The addressed line's data or NULL, if the line isn't served */
+	const dlogg_cd_lineData_t *line;
 } dlogg_stdval_addr_t;
 
+/** @brief Structure encapsulating the module's context */
+typedef struct {
+	/** @brief The vector of compiled addresses handed out */
+	dlogg_stdval_addr_t **compiledVector;
+	/** @brief The number of compiled addresses */
+	unsigned int compiledVectorLength;
+} dlogg_stdval_context_t;
+
 /**
  * @brief Array containing the maximum number of available input channels per
  * sampleType and channel prefix.
@@ -94,79 +112,189 @@ static inline common_type_error_t dlogg_stdval_parseAddress(
 		dlogg_stdval_addr_t* addr, config_setting_t *addressConfig);
 static inline common_type_error_t dlogg_stdval_getPrefixID(
 		dlogg_stdval_prefix_t* prefix, const char* confVal);
-static inline common_type_error_t dlogg_stdval_checkAddress(
+static inline common_type_error_t dlogg_stdval_checkStaticAddress(
 		dlogg_stdval_addr_t * addr);
-static inline common_type_t dlogg_stdval_fetchValue(dlogg_stdval_addr_t * addr);
+static inline common_type_error_t dlogg_stdval_lookupSample(
+		const dlogg_stdval_addr_t * addr, const dlogg_cd_sample_t **sample);
+static inline common_type_error_t dlogg_stdval_checkChannel(
+		const dlogg_stdval_addr_t * addr, const dlogg_cd_sample_t *sample);
+static inline common_type_t dlogg_stdval_decodeValue(
+		const dlogg_stdval_addr_t * addr, const dlogg_cd_sample_t *sample);
 static inline common_type_t dlogg_stdval_fetchSChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchEChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchAChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchADChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchAAChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchWMZEChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static inline common_type_t dlogg_stdval_fetchWMZPChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID);
+		const dlogg_cd_sample_t* sample, uint8_t channelID);
 static common_type_t dlogg_stdval_input2common(dlogg_cd_input_t input);
 static common_type_t dlogg_stdval_outputDrive2common(
 		dlogg_cd_outputDrive_t outputDrive);
 static common_type_t dlogg_stdval_analogOutput2common(
 		dlogg_cd_analogOutput_t analogOutput);
 static common_type_t dlogg_stdval_heatMeterSmall2commonEnergy(
-		dlogg_cd_heatMeterSmall_t * heatMeter);
+		const dlogg_cd_heatMeterSmall_t * heatMeter);
 static common_type_t dlogg_stdval_heatMeterSmall2commonPower(
-		dlogg_cd_heatMeterSmall_t * heatMeter);
+		const dlogg_cd_heatMeterSmall_t * heatMeter);
+static inline common_type_t dlogg_stdval_fixed2common(int32_t mantissa,
+		int32_t exponent);
 
-common_type_error_t fieldbus_application_init(void) {
-	// Nothing to be done
+common_type_error_t fieldbus_application_initContext(
+		fieldbus_application_context_t *context) {
+	dlogg_stdval_context_t *stdval;
+
+	assert(context != NULL);
+
+	stdval = calloc(1, sizeof(*stdval));
+	if (stdval == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	*context = stdval;
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t fieldbus_application_sync(void) {
+common_type_error_t fieldbus_application_syncContext(
+		fieldbus_application_context_t context) {
 	// Nothing to be done
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_t fieldbus_application_fetchValue(config_setting_t *address) {
-	common_type_t ret;
-	dlogg_stdval_addr_t addr;
+common_type_error_t fieldbus_application_compileContext(
+		fieldbus_application_context_t context, config_setting_t *address,
+		fieldbus_application_handle_t *handle) {
+	dlogg_stdval_context_t *stdval = context;
+	common_type_error_t err;
+	dlogg_stdval_addr_t *addr, **newVector;
 
+	assert(stdval != NULL);
 	assert(address != NULL);
+	assert(handle != NULL);
+
+	newVector = realloc(stdval->compiledVector,
+			(stdval->compiledVectorLength + 1) * sizeof(newVector[0]));
+	if (newVector == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+	stdval->compiledVector = newVector;
+
+	addr = malloc(sizeof(*addr));
+	if (addr == NULL) {
+		logging_adapter_info("Can't obtain more memory");
+		return COMMON_TYPE_ERR;
+	}
+
+	err = dlogg_stdval_parseAddress(addr, address);
+	if (err == COMMON_TYPE_SUCCESS) {
+		err = dlogg_stdval_checkStaticAddress(addr);
+	}
+	if (err != COMMON_TYPE_SUCCESS) {
+		free(addr);
+		return err;
+	}
+
+	// Unknown lines are reported on fetching the value
+	addr->line = dlogg_cd_getLine(addr->lineID);
+
+	stdval->compiledVector[stdval->compiledVectorLength++] = addr;
+	*handle = addr;
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+common_type_t fieldbus_application_fetchContext(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle) {
+	common_type_t ret;
+	const dlogg_stdval_addr_t *addr = handle;
+	const dlogg_cd_sample_t *sample;
 
-	ret.type = COMMON_TYPE_ERR;
-	ret.data.errVal = COMMON_TYPE_ERR_CONFIG;
+	assert(addr != NULL);
 
-	ret.data.errVal = dlogg_stdval_parseAddress(&addr, address);
+	ret.type = COMMON_TYPE_ERROR;
+	ret.data.errVal = dlogg_stdval_lookupSample(addr, &sample);
 	if (ret.data.errVal != COMMON_TYPE_SUCCESS)
 		return ret;
 
-	ret.data.errVal = dlogg_stdval_checkAddress(&addr);
+	ret.data.errVal = dlogg_stdval_checkChannel(addr, sample);
 	if (ret.data.errVal != COMMON_TYPE_SUCCESS)
 		return ret;
 
-	return dlogg_stdval_fetchValue(&addr);
+	return dlogg_stdval_decodeValue(addr, sample);
+}
+
+fieldbus_mac_context_t fieldbus_application_getMacContext(
+		fieldbus_application_context_t context,
+		fieldbus_application_handle_t handle) {
+	const dlogg_stdval_addr_t *addr = handle;
+
+	assert(addr != NULL);
+
+	return dlogg_cd_getLineContext(addr->lineID);
+}
+
+void fieldbus_application_fetchValuesContext(
+		fieldbus_application_context_t context,
+		const fieldbus_application_handle_t *handles, common_type_t *results,
+		unsigned int count) {
+	unsigned int i;
+	const dlogg_stdval_addr_t *addr, *lastAddr = NULL;
+	const dlogg_cd_sample_t *sample = NULL;
+	common_type_error_t err = COMMON_TYPE_SUCCESS;
+
+	assert(handles != NULL || count == 0);
+	assert(results != NULL || count == 0);
+
+	for (i = 0; i < count; i++) {
+		addr = handles[i];
+		assert(addr != NULL);
+
+		// Channels of the same controller share the sample lookup
+		if (lastAddr == NULL || lastAddr->lineID != addr->lineID
+				|| lastAddr->controllerID != addr->controllerID) {
+			err = dlogg_stdval_lookupSample(addr, &sample);
+			lastAddr = addr;
+		}
+
+		results[i].type = COMMON_TYPE_ERROR;
+		results[i].data.errVal = err;
+		if (err != COMMON_TYPE_SUCCESS)
+			continue;
+
+		results[i].data.errVal = dlogg_stdval_checkChannel(addr, sample);
+		if (results[i].data.errVal != COMMON_TYPE_SUCCESS)
+			continue;
+
+		results[i] = dlogg_stdval_decodeValue(addr, sample);
+	}
 }
 
 /**
- * @brief Fetches the value specified by the given address and returns it.
- * @details it assumes that the given address is valid and previously checked.
+ * @brief Decodes the value specified by the given address from the sample
+ * @details it assumes that the given address is valid and previously checked
+ * against the given sample.
  * @param addr A valid reference to an address structure
+ * @param sample The sample of the addressed controller
  * @return The fetched result or an appropriate error code.
  */
-static inline common_type_t dlogg_stdval_fetchValue(dlogg_stdval_addr_t * addr) {
+static inline common_type_t dlogg_stdval_decodeValue(
+		const dlogg_stdval_addr_t * addr, const dlogg_cd_sample_t *sample) {
 	common_type_t ret;
-	dlogg_cd_sample_t * sample;
 
 	assert(addr != NULL);
+	assert(sample != NULL);
 
 	ret.type = COMMON_TYPE_ERROR;
 	ret.data.errVal = COMMON_TYPE_ERR;
-	sample = dlogg_cd_getCurrentData(addr->controllerID, addr->lineID);
-	assert(sample!=NULL);
 
 	switch (addr->prefixID) {
 	case DLOGG_STDVAL_PRE_S:
@@ -205,7 +333,7 @@ static inline common_type_t dlogg_stdval_fetchValue(dlogg_stdval_addr_t * addr)
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchSChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -232,7 +360,7 @@ static inline common_type_t dlogg_stdval_fetchSChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchEChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -260,7 +388,7 @@ static inline common_type_t dlogg_stdval_fetchEChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchAChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -289,7 +417,7 @@ static inline common_type_t dlogg_stdval_fetchAChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchADChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -316,7 +444,7 @@ static inline common_type_t dlogg_stdval_fetchADChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchAAChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -344,7 +472,7 @@ static inline common_type_t dlogg_stdval_fetchAAChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchWMZEChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -381,7 +509,7 @@ static inline common_type_t dlogg_stdval_fetchWMZEChannel(
  * @return The result of the operation
  */
 static inline common_type_t dlogg_stdval_fetchWMZPChannel(
-		dlogg_cd_sample_t* sample, uint8_t channelID) {
+		const dlogg_cd_sample_t* sample, uint8_t channelID) {
 	common_type_t ret;
 
 	assert(sample != NULL);
@@ -418,18 +546,17 @@ static inline common_type_t dlogg_stdval_fetchWMZPChannel(
  * @return The conversion result
  */
 static common_type_t dlogg_stdval_heatMeterSmall2commonEnergy(
-		dlogg_cd_heatMeterSmall_t * heatMeter) {
-	common_type_t ret;
+		const dlogg_cd_heatMeterSmall_t * heatMeter) {
+	int32_t tenthKwh;
 
 	assert(heatMeter != NULL);
 
-	ret.type = COMMON_TYPE_DOUBLE;
-	ret.data.doubleVal = (((uint16_t) heatMeter->val.kwh[0])
-			+ (((uint16_t) heatMeter->val.kwh[1]) << 8)) * 0.1;
-	ret.data.doubleVal += (((uint16_t) heatMeter->val.mwh[0])
-			+ (((uint16_t) heatMeter->val.mwh[1]) << 8)) * 1000.0;
+	tenthKwh = ((uint16_t) heatMeter->val.kwh[0])
+			+ (((uint16_t) heatMeter->val.kwh[1]) << 8);
+	tenthKwh += (((uint16_t) heatMeter->val.mwh[0])
+			+ (((uint16_t) heatMeter->val.mwh[1]) << 8)) * 10000;
 
-	return ret;
+	return dlogg_stdval_fixed2common(tenthKwh, -1);
 }
 
 /**
@@ -440,16 +567,11 @@ static common_type_t dlogg_stdval_heatMeterSmall2commonEnergy(
  * @return The conversion result
  */
 static common_type_t dlogg_stdval_heatMeterSmall2commonPower(
-		dlogg_cd_heatMeterSmall_t * heatMeter) {
-	common_type_t ret;
-
+		const dlogg_cd_heatMeterSmall_t * heatMeter) {
 	assert(heatMeter != NULL);
 
-	ret.type = COMMON_TYPE_DOUBLE;
-	ret.data.doubleVal = (((uint16_t) heatMeter->val.cur[0])
-			+ (((uint16_t) heatMeter->val.cur[1]) << 8)) * 0.1;
-
-	return ret;
+	return dlogg_stdval_fixed2common(((uint16_t) heatMeter->val.cur[0])
+			+ (((uint16_t) heatMeter->val.cur[1]) << 8), -1);
 }
 
 /**
@@ -464,8 +586,7 @@ static common_type_t dlogg_stdval_analogOutput2common(
 	common_type_t ret;
 
 	if (!analogOutput.val.activeN && analogOutput.val.voltage <= 100) {
-		ret.type = COMMON_TYPE_DOUBLE;
-		ret.data.doubleVal = analogOutput.val.voltage * 0.01;
+		ret = dlogg_stdval_fixed2common(analogOutput.val.voltage, -2);
 	} else {
 		logging_adapter_info("An analog output requested isn't set by the "
 				"controller");
@@ -533,20 +654,16 @@ static common_type_t dlogg_stdval_input2common(dlogg_cd_input_t input) {
 		ret.data.longVal = input.val.sign;
 		break;
 	case 2: // temperature
-		ret.type = COMMON_TYPE_DOUBLE;
-		ret.data.doubleVal = signedValue * 0.1;
+		ret = dlogg_stdval_fixed2common(signedValue, -1);
 		break;
 	case 3: // volume flow
-		ret.type = COMMON_TYPE_DOUBLE;
-		ret.data.doubleVal = signedValue * 4.0;
+		ret = dlogg_stdval_fixed2common(signedValue * 4, 0);
 		break;
 	case 6: // solar radiation
-		ret.type = COMMON_TYPE_DOUBLE;
-		ret.data.doubleVal = signedValue;
+		ret = dlogg_stdval_fixed2common(signedValue, 0);
 		break;
 	case 7: // room temperature
-		ret.type = COMMON_TYPE_DOUBLE;
-		ret.data.doubleVal = signedValue * 0.1;
+		ret = dlogg_stdval_fixed2common(signedValue, -1);
 		break;
 	default:
 		logging_adapter_info("Invalid input type identifier read: 0x%20x",
@@ -556,28 +673,52 @@ static common_type_t dlogg_stdval_input2common(dlogg_cd_input_t input) {
 	}
 	return ret;
 }
+
 /**
- * @brief Obtains the appropriate met-data structure and checks the range of the
- * internal values
- * @details The sensor number range depends on the internal sampleType
- * describing available data. Each range is present in a lookup-table containing
- * the maximum number of inputs
- * @param addr The address structure to check
+ * @brief Creates a fixed-point common type value
+ * @param mantissa The integer multiple of the decimal step
+ * @param exponent The decimal exponent of the step
+ * @return The common type value mantissa * 10^exponent
+ */
+static inline common_type_t dlogg_stdval_fixed2common(int32_t mantissa,
+		int32_t exponent) {
+	common_type_t ret;
+
+	ret.type = COMMON_TYPE_FIXED;
+	ret.data.fixedVal.mantissa = mantissa;
+	ret.data.fixedVal.exponent = exponent;
+
+	return ret;
+}
+
+/**
+ * @brief Obtains the sample of the addressed controller
+ * @details The line and the controller have to be present within the current
+ * data. The sample's content isn't checked.
+ * @param addr The address structure to look up
+ * @param sample Reference receiving the addressed sample on success
  * @return The status of the operation
  */
-static inline common_type_error_t dlogg_stdval_checkAddress(
-		dlogg_stdval_addr_t * addr) {
-	dlogg_cd_metadata_t * metadata = dlogg_cd_getMetadata(addr->lineID);
-	dlogg_cd_sample_t * addressedSample;
+static inline common_type_error_t dlogg_stdval_lookupSample(
+		const dlogg_stdval_addr_t * addr, const dlogg_cd_sample_t **sample) {
+	const dlogg_cd_metadata_t * metadata;
 
 	assert(addr != NULL);
+	assert(sample != NULL);
 
-	if (metadata == NULL ) {
+	if (addr->line == NULL ) {
 		logging_adapter_info("The line number %u is not known.",
 				(unsigned) addr->lineID);
 		return COMMON_TYPE_ERR_CONFIG;
 	}
 
+	metadata = dlogg_cd_getMetadata(addr->line);
+	if (metadata->sampleCount == 0) {
+		logging_adapter_info("No current data of line %u is available.",
+				(unsigned) addr->lineID);
+		return COMMON_TYPE_ERR_IO;
+	}
+
 	if (addr->controllerID >= metadata->sampleCount) {
 		logging_adapter_info("Only %u controller(s) are present at line %u. "
 				"Controller %u does not exist.", (unsigned) metadata->sampleCount,
@@ -585,7 +726,24 @@ static inline common_type_error_t dlogg_stdval_checkAddress(
 		return COMMON_TYPE_ERR_CONFIG;
 	}
 
-	addressedSample = dlogg_cd_getCurrentData(addr->controllerID, addr->lineID);
+	*sample = dlogg_cd_getCurrentData(addr->line, addr->controllerID);
+	assert(*sample != NULL);
+
+	return COMMON_TYPE_SUCCESS;
+}
+
+/**
+ * @brief Checks the channel range against the given sample's type
+ * @details Each range is present in a lookup-table containing the maximum
+ * number of inputs per sampleType.
+ * @param addr The address structure to check
+ * @param addressedSample The sample of the addressed controller
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_stdval_checkChannel(
+		const dlogg_stdval_addr_t * addr,
+		const dlogg_cd_sample_t *addressedSample) {
+	assert(addr != NULL);
 	assert(addressedSample != NULL);
 
 	assert(addressedSample->sampleType < sizeof(dlogg_stdval_capabilities) //
@@ -606,6 +764,35 @@ static inline common_type_error_t dlogg_stdval_checkAddress(
 	return COMMON_TYPE_SUCCESS;
 }
 
+/**
+ * @brief Checks the address ranges independent of the device's data
+ * @details The channel number has to be available on at least one of the
+ * supported sample types. The remaining checks are done by
+ * dlogg_stdval_checkChannel() after the device's data is known.
+ * @param addr The valid address structure to check
+ * @return The status of the operation
+ */
+static inline common_type_error_t dlogg_stdval_checkStaticAddress(
+		dlogg_stdval_addr_t * addr) {
+	unsigned int sampleType;
+
+	assert(addr != NULL);
+	assert(addr->prefixID < sizeof(dlogg_stdval_capabilities[0]) //
+	/ sizeof(dlogg_stdval_capabilities[0][0]));
+
+	for (sampleType = 0; sampleType < sizeof(dlogg_stdval_capabilities) //
+	/ sizeof(dlogg_stdval_capabilities[0]); sampleType++) {
+		if (addr->channelID
+				< dlogg_stdval_capabilities[sampleType][addr->prefixID]) {
+			return COMMON_TYPE_SUCCESS;
+		}
+	}
+
+	logging_adapter_info("No supported controller has a (prefix=%u) channel "
+			"nr. %u.", (unsigned) addr->prefixID, (unsigned) addr->channelID + 1);
+	return COMMON_TYPE_ERR_CONFIG;
+}
+
 /**
  * @brief Parses the given configuration structure
  * @details The parameters set will be stored into the address structure but
@@ -719,7 +906,18 @@ static inline common_type_error_t dlogg_stdval_getPrefixID(
 	return COMMON_TYPE_SUCCESS;
 }
 
-common_type_error_t fieldbus_application_free(void) {
-// Nothing to be done
+common_type_error_t fieldbus_application_freeContext(
+		fieldbus_application_context_t context) {
+	dlogg_stdval_context_t *stdval = context;
+	unsigned int i;
+
+	assert(stdval != NULL);
+
+	for (i = 0; i < stdval->compiledVectorLength; i++) {
+		free(stdval->compiledVector[i]);
+	}
+	free(stdval->compiledVector);
+	free(stdval);
+
 	return COMMON_TYPE_SUCCESS;
 }